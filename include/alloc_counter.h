@@ -0,0 +1,34 @@
+/**
+ * @file alloc_counter.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for alloc_counter.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstdint>
+
+/**
+ * @brief Number of heap allocations made so far
+ */
+struct alloc_counts {
+  uint64_t heap = 0; // calls to operator new, which covers the std containers in this program and in OpenCV
+  uint64_t mats = 0; // cv::Mat buffers allocated through the default allocator
+};
+
+/**
+ * @brief Function to start counting cv::Mat allocations. operator new is counted from the start
+ * in any program that links alloc_counter.cpp.
+ */
+void alloc_counter_install();
+
+/**
+ * @brief Function to read the allocation counts
+ *
+ * @return alloc_counts counts since the program started
+ */
+alloc_counts alloc_counter_read();
+
+#endif
@@ -13,6 +13,8 @@
 #include <fstream>
 #include <string>
 #include <opencv2/opencv.hpp>
+#include "luma_pyramid.h"
+#include "chessboard.h"
 
 /**
  * @brief Function to detect and extract chessboard
@@ -22,9 +24,26 @@
  * @param patsize size of the pattern
  * @param corner_set vector of the point location of each corner  
  * @param pattern_found bool passed by reference to determine if corners were found. 
+ * @param coarse_width width to find the board at before refining at full resolution, 0 to search at full resolution
  * @return int return non-zero value on failure. 
  */
-int detect_chessboard(const cv::Mat &src, cv::Size patsize, std::vector<cv::Point2f> &corner_set, bool &pattern_found);
+int detect_chessboard(const cv::Mat &src, cv::Size patsize, std::vector<cv::Point2f> &corner_set, bool &pattern_found, 
+                      int coarse_width = 0);
+
+/**
+ * @brief Function to detect and extract chessboard from a frame's shared pyramid, so the frame
+ * isn't converted to grayscale again
+ * 
+ * @param pyr pyramid of the frame
+ * @param patsize size of the pattern
+ * @param corner_set vector of the point location of each corner  
+ * @param pattern_found bool passed by reference to determine if corners were found. 
+ * @param coarse_width width to find the board at before refining at full resolution, 0 to search at full resolution. 
+ * The board is found on one of the pyramid's scale levels if they've already been built. 
+ * @return int return non-zero value on failure. 
+ */
+int detect_chessboard(luma_pyramid &pyr, cv::Size patsize, std::vector<cv::Point2f> &corner_set, bool &pattern_found, 
+                      int coarse_width = 0);
 
 /**
  * @brief Function to get the point set if there's a pattern
@@ -0,0 +1,118 @@
+/**
+ * @file cal_store.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for cal_store.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef CAL_STORE_H
+#define CAL_STORE_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#define CAL_STORE_NAME "calibration.bin" // store the programs read their calibration from
+#define CAL_STORE_MAGIC 0x4c414343 // "CCAL"
+#define CAL_STORE_VERSION 1
+#define CAL_STORE_ID_LEN 64 // longest camera identifier kept, with its terminator
+#define CAL_STORE_MAX_DIST 14 // most distortion coefficients kept
+#define CAL_STORE_ASPECT_TOL 0.01 // largest difference in aspect ratio a calibration is scaled across
+
+/**
+ * @brief Calibration of one camera at one resolution
+ */
+struct cal_profile {
+  std::string camera_id;
+  cv::Size resolution; // size of the images the camera was calibrated with
+  cv::Mat cam_mat; // 3x3 CV_64F
+  cv::Mat dist_coeffs; // Nx1 CV_64F
+  double proj_error = 0;
+  int64_t created = 0; // when it was saved, in seconds since the epoch
+};
+
+/**
+ * @brief Calibration profiles memory-mapped read-only from the store file, indexed by camera and resolution
+ */
+struct cal_store {
+  std::shared_ptr<void> mapping; // mapped file, unmapped once nothing uses it
+  const uchar *data = nullptr;
+  size_t size = 0;
+  std::unordered_map<std::string, int> entries; // camera and resolution -> record in the file
+  std::unordered_map<std::string, std::vector<int> > cameras; // camera -> its records at every resolution
+};
+
+/**
+ * @brief Function to get an identifier for a video device that stays the same when other cameras are plugged in.
+ * USB cameras are told apart by their serial number, or by the port they're plugged into when they don't report
+ * one, so two cameras of the same model keep their own calibration. The device's name from video4linux is
+ * only used alone when there's nothing more specific.
+ *
+ * @param index index of the device as VideoCapture opens it
+ * @return std::string identifier of the camera
+ */
+std::string camera_identifier(int index);
+
+/**
+ * @brief Function to map a store file written by save_cal_profile
+ *
+ * @param filename store file
+ * @param store output store
+ * @return int return non-zero value if the file is missing or corrupt
+ */
+int open_cal_store(const std::string &filename, cal_store &store);
+
+/**
+ * @brief Function to get the calibration of a camera at a resolution. A profile saved at that resolution is used
+ * as it is, otherwise the largest one with the same aspect ratio is scaled to it.
+ *
+ * @param store mapped store
+ * @param camera_id identifier of the camera
+ * @param resolution size of the frames it'll be used on
+ * @param profile output profile at the resolution
+ * @return bool true if the camera has a profile that fits
+ */
+bool find_cal_profile(const cal_store &store, const std::string &camera_id, cv::Size resolution, cal_profile &profile);
+
+/**
+ * @brief Function to scale a calibration to another resolution of the same camera. The focal lengths and
+ * principal point follow the image, the distortion coefficients work on normalized points and don't change.
+ *
+ * @param src calibration
+ * @param resolution size of the frames it'll be used on
+ * @param dst output calibration at the resolution, can be src
+ */
+void scale_cal_profile(const cal_profile &src, cv::Size resolution, cal_profile &dst);
+
+/**
+ * @brief Function to add a calibration to the store file, replacing the camera's profile at the same resolution.
+ * The file is written next to the old one and renamed over it, so processes that mapped the old one keep working.
+ *
+ * @param filename store file, created if it doesn't exist
+ * @param profile calibration to save
+ * @return int return non-zero value on failure
+ */
+int save_cal_profile(const std::string &filename, const cal_profile &profile);
+
+/**
+ * @brief Function to load the calibration of a camera at a resolution from the store, falling back to the
+ * csv file written by append_calibration_data_csv for cameras that aren't in it
+ *
+ * @param store_fn store file
+ * @param csv_fn csv file to fall back to
+ * @param camera_id identifier of the camera
+ * @param resolution size of the frames it'll be used on
+ * @param cam_mat output camera matrix
+ * @param dist_coeffs output distortion coefficients
+ * @return int return non-zero value if neither has a calibration
+ */
+int load_camera_calibration(const std::string &store_fn, const char *csv_fn, const std::string &camera_id, cv::Size resolution,
+                            cv::Mat &cam_mat, cv::Mat &dist_coeffs);
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * @file cal_worker.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for cal_worker.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef CAL_WORKER_H
+#define CAL_WORKER_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#define CAL_WORKER_MIN_VIEWS 5 // views needed before calibrating
+
+/**
+ * @brief Outcome of one calibration run
+ */
+struct cal_result {
+  cv::Mat cam_mat;
+  cv::Mat dist_coeffs;
+  cv::Mat rotations; // one rotation vector per view
+  cv::Mat translations; // one translation vector per view
+  double proj_error = 0; // rms reprojection error in pixels
+  int views = 0; // views the run used
+  int run = 0; // 1 for the first run, counting up
+  bool warm_started = false; // started from the previous run's intrinsics
+  double seconds = 0; // time the run took
+};
+
+/**
+ * @brief Calibrates the camera on a background thread so capture keeps running. Views are added as they're
+ * collected and each run starts from the intrinsics of the one before, so it converges in fewer iterations.
+ */
+struct cal_worker {
+  std::thread thread;
+  std::mutex mutex; // guards everything below except running_views
+  std::condition_variable wake;
+  cv::Size image_size;
+  int flags = 0; // calibrateCamera flags, CALIB_USE_INTRINSIC_GUESS is added once there's a previous run
+  std::vector<std::vector<cv::Vec3f> > point_list; // every view added so far
+  std::vector<std::vector<cv::Point2f> > corner_list;
+  bool requested = false; // a run is wanted with the views there are now
+  bool stop = false;
+  bool have_result = false; // a run finished that cal_worker_poll hasn't handed out yet
+  cal_result result; // last finished run, also the warm start of the next one
+  std::atomic<int> running_views{0}; // views in the run in progress, 0 when idle
+};
+
+/**
+ * @brief Function to start the worker thread
+ *
+ * @param worker worker to start
+ * @param image_size size of the calibration images
+ * @param flags calibrateCamera flags
+ */
+void cal_worker_start(cal_worker &worker, cv::Size image_size, int flags);
+
+/**
+ * @brief Function to add a view of the pattern
+ *
+ * @param worker worker
+ * @param point_set 3d position of each corner on the pattern
+ * @param corner_set corners found in the image
+ * @param calibrate also ask for a run with every view so far, once there are enough of them
+ */
+void cal_worker_add_view(cal_worker &worker, const std::vector<cv::Vec3f> &point_set, const std::vector<cv::Point2f> &corner_set,
+                         bool calibrate);
+
+/**
+ * @brief Function to ask for a run with every view added so far. If a run is in progress the new one
+ * starts when it's done.
+ *
+ * @param worker worker
+ * @return int return non-zero value if there aren't enough views yet
+ */
+int cal_worker_request(cal_worker &worker);
+
+/**
+ * @brief Function to get the result of a run that finished since the last call, without waiting
+ *
+ * @param worker worker
+ * @param result output result
+ * @return bool true if there's a new result
+ */
+bool cal_worker_poll(cal_worker &worker, cal_result &result);
+
+/**
+ * @brief Function to get the number of views added so far
+ *
+ * @param worker worker
+ * @return int views
+ */
+int cal_worker_views(cal_worker &worker);
+
+/**
+ * @brief Function to stop the worker thread, waiting for a run in progress to finish
+ *
+ * @param worker worker to stop
+ */
+void cal_worker_stop(cal_worker &worker);
+
+#endif
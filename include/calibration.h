@@ -13,15 +13,19 @@
 #include <fstream>
 #include <string>
 #include <opencv2/opencv.hpp>
+#include "chessboard.h"
 
 /**
  * @brief Function to detect and extract chessboard
  * 
  * @param src source image to find the corners in 
- * @param dst dst image that displays the the corners
+ * @param dst dst image that displays the the corners, empty to skip drawing
  * @param patsize size of the pattern
  * @param corner_set vector of the point location of each corner  
  * @param pattern_found bool passed by reference to determine if corners were found. 
+ * @param coarse_width width to find the board at before refining at full resolution, 0 to search at full resolution
+ * @param saddle saddle point detector to find the board with instead of findChessboardCorners, nullptr to use findChessboardCorners
  * @return int return non-zero value on failure. 
  */
-int det_ext_corners(const cv::Mat &src, cv::Mat &dst, cv::Size patsize, std::vector<cv::Point2f> &corner_set, bool &pattern_found); 
\ No newline at end of file
+int det_ext_corners(const cv::Mat &src, cv::Mat &dst, cv::Size patsize, std::vector<cv::Point2f> &corner_set, bool &pattern_found, 
+                    int coarse_width = 0, saddle_detector *saddle = nullptr); 
\ No newline at end of file
@@ -0,0 +1,61 @@
+/**
+ * @file camera_model.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for camera_model.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef CAMERA_MODEL_H
+#define CAMERA_MODEL_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#define CAMERA_MAP_TYPE CV_16SC2 // fixed-point remap tables, faster to remap with than float maps
+
+/**
+ * @brief Calibration of a camera with what's precomputed from it. The remap tables are built once for each
+ * frame size, and points are undistorted in batches, so the pose stages can run without distortion.
+ */
+struct camera_model {
+  cv::Mat cam_mat;
+  cv::Mat dist_coeffs;
+  bool distorted = false; // false when every coefficient is 0 and nothing needs undistorting
+  cv::Size map_size; // frame size the remap tables were built for
+  cv::Mat map1; // fixed-point source positions
+  cv::Mat map2; // interpolation weights
+};
+
+/**
+ * @brief Function to set up a camera model from a calibration
+ *
+ * @param cam camera model to set up
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @return int return non-zero value on failure
+ */
+int camera_model_init(camera_model &cam, const cv::Mat &cam_mat, const cv::Mat &dist_coeffs);
+
+/**
+ * @brief Function to remove the lens distortion from a frame with the cached remap tables, building them
+ * the first time a frame of its size is seen. Poses found on the result use no distortion coefficients.
+ *
+ * @param cam camera model
+ * @param src frame
+ * @param dst output undistorted frame, it shares src's data when the camera has no distortion
+ */
+void camera_model_rectify(camera_model &cam, const cv::Mat &src, cv::Mat &dst);
+
+/**
+ * @brief Function to undistort points in one batch, keeping them in pixels of the same camera matrix
+ *
+ * @param cam camera model
+ * @param src points in the distorted frame
+ * @param dst output undistorted points, can be src
+ */
+void camera_model_undistort_points(const camera_model &cam, const std::vector<cv::Point2f> &src, std::vector<cv::Point2f> &dst);
+
+#endif
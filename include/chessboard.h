@@ -0,0 +1,142 @@
+/**
+ * @file chessboard.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for chessboard.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef CHESSBOARD_H
+#define CHESSBOARD_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "luma_pyramid.h"
+
+#define CHESSBOARD_COARSE_WIDTH 640 // width the board is found at in coarse to fine mode
+#define CHESSBOARD_COARSE_MARGIN 1.25f // frames narrower than this times the coarse width are searched at full resolution
+#define CHESSBOARD_SUBPIX_WIN 11 // half window of cornerSubPix at full resolution
+#define CHESSBOARD_COARSE_SUBPIX_WIN 3 // half window of cornerSubPix on the downscaled image
+#define CHESSBOARD_FINE_MIN_WIN 3 // smallest half window when refining corners mapped up from the downscaled image
+#define SADDLE_WORK_WIDTH 640 // wider frames are searched for saddle points downscaled to this width, so every frame costs about the same
+#define SADDLE_BLUR_SIGMA 1.5 // smoothing before the second derivatives
+#define SADDLE_NMS_RADIUS 3 // a saddle point has to be the strongest within this many pixels
+#define SADDLE_REL_THRESHOLD 0.05f // weakest saddle response kept, as a fraction of the strongest in the frame
+#define SADDLE_MIN_RESPONSE 10.0f // weakest saddle response kept at all, so frames without a board give few candidates
+#define SADDLE_MAX_CANDIDATES 256 // strongest saddle points the grid is grown from
+#define SADDLE_MAX_SEEDS 8 // strongest saddle points tried as the start of the grid
+#define SADDLE_NEIGHBOURS 8 // nearest saddle points looked at to pick the grid's axes at a seed
+#define SADDLE_MIN_STEP 4.0f // shortest distance between neighbouring corners in pixels at the working width
+#define SADDLE_MATCH_RADIUS 0.3f // furthest a corner can be from where the grid predicts it, as a fraction of the step to it
+#define BOARD_TRACK_WIN_SIZE 21 // optical flow search window
+#define BOARD_TRACK_PYR_LEVELS 3 // optical flow pyramid levels
+#define BOARD_TRACK_SUBPIX_WIN 5 // half window of cornerSubPix on the tracked corners
+#define BOARD_TRACK_MAX_REPROJ_ERR 1.0f // largest mean reprojection error in pixels of tracked corners before searching again
+
+/**
+ * @brief Buffers of the saddle point board detector, kept so they aren't allocated every frame. One detector
+ * can't be used by two threads at once.
+ */
+struct saddle_detector {
+  cv::Mat small; // frame at the working width
+  cv::Mat blurred; // smoothed frame as floats
+  cv::Mat response; // saddle response, positive where the image curves up one way and down the other
+  cv::Mat dilated; // largest response around each pixel
+  std::vector<cv::Point2f> candidates; // saddle points at the working width
+  std::vector<float> strength; // response of each candidate
+  std::vector<int> order; // candidates from the strongest
+  std::vector<uchar> used; // candidates already in the grid
+  std::vector<int> grid; // candidate at each grid cell, -1 where there's none
+  std::vector<int> queue; // grid cells still to grow from
+};
+
+/**
+ * @brief Corners and pose of a chessboard followed from frame to frame with optical flow, so the full
+ * search only runs when the board is first seen or tracking fails
+ */
+struct board_tracker {
+  bool locked = false; // true while the corners are tracked
+  cv::Size patsize;
+  std::vector<cv::Vec3f> object_pts; // corners on the board, one unit apart
+  std::vector<cv::Point2f> corners; // corners in the previous frame
+  std::vector<cv::Mat> prev_flow; // optical flow levels of the previous frame
+  cv::Mat rotations; // pose in the previous frame
+  cv::Mat translations;
+  std::vector<cv::Point2f> next_pts; // buffers reused every frame
+  std::vector<uchar> status;
+  std::vector<float> err;
+  std::vector<cv::Point2f> projected;
+  saddle_detector *saddle = nullptr; // searches with find_saddle_board instead of find_chessboard when set
+};
+
+/**
+ * @brief Function to find the corners of a chessboard and refine them to sub-pixel accuracy. In coarse to fine
+ * mode the board is found on a downscaled image, the corners are mapped back up and only refined in small
+ * windows at full resolution, sized by how far the mapping can be off.
+ *
+ * @param gray grayscale image
+ * @param patsize size of the pattern
+ * @param corner_set output corners in full resolution coordinates
+ * @param coarse_width width to find the board at, 0 to search the full resolution image
+ * @param levels downscaled copies of gray to pick the coarse image from instead of resizing, nullptr to resize
+ * @return bool true if the board was found
+ */
+bool find_chessboard(const cv::Mat &gray, cv::Size patsize, std::vector<cv::Point2f> &corner_set, int coarse_width = 0,
+                     const std::vector<cv::Mat> *levels = nullptr);
+
+/**
+ * @brief Function to get the downscaled levels find_chessboard can take its coarse image from. They're only
+ * used when something else already built them, building them just for this costs more than one resize.
+ *
+ * @param pyr pyramid of the frame
+ * @param coarse_width width to find the board at, 0 to search at full resolution
+ * @return const std::vector<cv::Mat>* the pyramid's levels, nullptr to let find_chessboard resize
+ */
+const std::vector<cv::Mat> *chessboard_levels(const luma_pyramid &pyr, int coarse_width);
+
+/**
+ * @brief Function to find the inner corners of a chessboard without findChessboardCorners. Saddle points are
+ * found with a vectorized second derivative filter, the strongest are grown into a grid from a few seeds and
+ * the grid is accepted when it has exactly the pattern's rows and columns. The frame is searched at a fixed
+ * width and the number of candidates and seeds is capped, so the cost is about the same with or without a board.
+ * The corners are ordered along the rows starting from the left, with the next row below, and refined with
+ * cornerSubPix at full resolution.
+ *
+ * @param det buffers of the detector
+ * @param gray grayscale image
+ * @param patsize size of the pattern
+ * @param corner_set output corners in full resolution coordinates
+ * @return bool true if the board was found
+ */
+bool find_saddle_board(saddle_detector &det, const cv::Mat &gray, cv::Size patsize, std::vector<cv::Point2f> &corner_set);
+
+/**
+ * @brief Function to set up a board tracker
+ *
+ * @param tracker tracker to set up
+ * @param patsize size of the pattern
+ */
+void board_tracker_init(board_tracker &tracker, cv::Size patsize);
+
+/**
+ * @brief Function to find the board and its pose in a new frame. The last frame's corners are followed with
+ * optical flow, refined with a small sub-pixel search and accepted if the pose solved from them, starting
+ * from the last pose, reprojects onto them. Otherwise the board is searched for with find_chessboard.
+ *
+ * @param tracker board tracker
+ * @param pyr pyramid of the frame
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param coarse_width width find_chessboard searches at, 0 for full resolution
+ * @param corner_set output corners
+ * @param rotations output rotations
+ * @param translations output translations
+ * @param tracked output true if the corners came from tracking instead of a search
+ * @return bool true if the board was found
+ */
+bool board_tracker_update(board_tracker &tracker, luma_pyramid &pyr, cv::Mat cam_mat, cv::Mat dist_coeffs, int coarse_width,
+                          std::vector<cv::Point2f> &corner_set, cv::Mat &rotations, cv::Mat &translations, bool &tracked);
+
+#endif
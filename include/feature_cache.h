@@ -0,0 +1,69 @@
+/**
+ * @file feature_cache.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for feature_cache.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef FEATURE_CACHE_H
+#define FEATURE_CACHE_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "model_db.h"
+
+#define FEATURE_CACHE_NAME ".features.cache" // cache file kept in the model image directory
+#define FEATURE_CACHE_MAGIC 0x4843464d // "MFCH"
+#define FEATURE_CACHE_VERSION 2
+
+/**
+ * @brief Keypoints and descriptors of every model image, memory-mapped read-only from the cache file.
+ * The descriptors of targets read from the cache point straight into the mapping, so every process
+ * that maps the same file shares one copy of them in the page cache.
+ */
+struct feature_cache {
+  std::shared_ptr<void> mapping; // mapped file, unmapped once nothing uses it
+  const uchar *data = nullptr;
+  size_t size = 0;
+  std::unordered_map<std::string, int> entries; // name of the model image -> entry in the file
+};
+
+/**
+ * @brief Function to map a cache file written by save_feature_cache
+ *
+ * @param filename cache file
+ * @param detector ORB detector, the cache is only used if it was written with the same settings
+ * @param cache output cache
+ * @return int return non-zero value if the file is missing, corrupt or was written with other settings
+ */
+int open_feature_cache(const std::string &filename, cv::Ptr<cv::ORB> detector, feature_cache &cache);
+
+/**
+ * @brief Function to get the keypoints and descriptors of a target from the cache. The target's name,
+ * modification time and file size must already be set, and the entry is only used if they all match.
+ *
+ * @param cache mapped cache
+ * @param target target to fill in, its descriptors point into the mapping
+ * @return bool true if the target was found and is up to date
+ */
+bool read_cached_features(const feature_cache &cache, model_target &target);
+
+/**
+ * @brief Function to write the keypoints and descriptors of the targets to a cache file. The file is
+ * written next to the old one and renamed over it, so processes that mapped the old one keep working.
+ *
+ * @param filename cache file
+ * @param detector ORB detector the features were found with
+ * @param targets targets to save
+ * @return int return non-zero value on failure
+ */
+int save_feature_cache(const std::string &filename, cv::Ptr<cv::ORB> detector, const std::vector<model_target> &targets);
+
+#endif
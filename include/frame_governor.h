@@ -0,0 +1,81 @@
+/**
+ * @file frame_governor.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for frame_governor.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef FRAME_GOVERNOR_H
+#define FRAME_GOVERNOR_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "tiled_orb.h"
+
+#define GOVERNOR_DEFAULT_BUDGET_MS 33.0 // frame time to stay under, one frame of a 30 fps camera
+#define GOVERNOR_SMOOTHING 0.1 // weight of the newest frame in the average frame time
+#define GOVERNOR_HEADROOM 0.7 // quality goes back up once the average is under this fraction of the budget
+#define GOVERNOR_HOLD_FRAMES 15 // frames after lowering quality before the next change, so the average catches up
+#define GOVERNOR_RAISE_HOLD_FRAMES 60 // frames after raising quality before the next change, longer so it doesn't flip back and forth
+
+/**
+ * @brief Settings of the detector at one quality level
+ */
+struct governor_level {
+  int nfeatures = 500; // ORB features per frame
+  int nlevels = 8; // ORB pyramid levels
+  float scale = 1; // processing resolution as a fraction of the camera's
+};
+
+/**
+ * @brief Watches the time each frame takes and steps the detector's quality down when it's over the budget
+ * and back up when there's headroom again
+ */
+struct frame_governor {
+  double budget_ms = GOVERNOR_DEFAULT_BUDGET_MS;
+  std::vector<governor_level> levels; // best quality first
+  int level = 0; // index of the level in use
+  double avg_ms = 0; // moving average of the frame time
+  int frames = 0; // frames seen so far
+  int hold = 0; // frames left before the level can change again
+};
+
+/**
+ * @brief Function to set up a governor, the best quality level being the ORB detector's settings
+ *
+ * @param gov governor to set up
+ * @param budget_ms frame time to stay under in milliseconds
+ * @param orb ORB detector whose settings are the best quality level
+ */
+void governor_init(frame_governor &gov, double budget_ms, cv::Ptr<cv::ORB> orb);
+
+/**
+ * @brief Function to add the time a frame took and pick the level for the next one
+ *
+ * @param gov governor
+ * @param frame_ms time the frame took in milliseconds
+ * @return bool true if the level changed
+ */
+bool governor_update(frame_governor &gov, double frame_ms);
+
+/**
+ * @brief Function to get the settings of the level in use
+ *
+ * @param gov governor
+ * @return const governor_level& settings to process the next frame with
+ */
+const governor_level &governor_current(const frame_governor &gov);
+
+/**
+ * @brief Function to set the detectors to the level in use
+ *
+ * @param gov governor
+ * @param orb ORB detector
+ * @param tiled tiled extractor set up from the ORB detector, nullptr if there's none
+ */
+void governor_apply(const frame_governor &gov, cv::Ptr<cv::ORB> orb, tiled_orb *tiled = nullptr);
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @file frame_queue.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Bounded lock-free queue that passes frames between two pipeline stages
+ * @date 2026-10-17
+ */
+
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+/**
+ * @brief Bounded single-producer/single-consumer queue that drops the oldest item when it's full,
+ * so a slow consumer always gets the freshest frames and latency stays bounded.
+ *
+ * Each slot carries a sequence number (Vyukov's bounded queue). The consumer claims the oldest slot
+ * with a CAS on the read position, which lets the producer claim it the same way to drop it.
+ */
+template <typename T>
+struct frame_queue {
+  /**
+   * @brief Constructor
+   *
+   * @param capacity number of items the queue holds, rounded up to a power of two
+   */
+  explicit frame_queue(size_t capacity) {
+    size_t size = 1;
+    while(size < capacity) size <<= 1;
+    mask = size - 1;
+    slots.reset(new slot[size]);
+    for(size_t i = 0; i < size; i++) {
+      slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Function to add an item, dropping the oldest one if the queue is full. Producer only.
+   *
+   * @param item item to move into the queue
+   */
+  void push(T &item) {
+    for(;;) {
+      size_t pos = write_pos.load(std::memory_order_relaxed);
+      slot &s = slots[pos & mask];
+      size_t seq = s.seq.load(std::memory_order_acquire);
+      if(seq == pos) {
+        s.data = std::move(item);
+        s.seq.store(pos + 1, std::memory_order_release);
+        write_pos.store(pos + 1, std::memory_order_release);
+        return;
+      }
+
+      // Full, so drop the oldest item. If the consumer is still moving it out, wait for it to finish.
+      T oldest;
+      if(pop(oldest)) {
+        num_dropped.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  /**
+   * @brief Function to take the oldest item out of the queue. Consumer only (and the producer when it drops).
+   *
+   * @param item output item
+   * @return bool false if the queue is empty
+   */
+  bool pop(T &item) {
+    size_t pos = read_pos.load(std::memory_order_relaxed);
+    for(;;) {
+      slot &s = slots[pos & mask];
+      size_t seq = s.seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+      if(diff == 0) {
+        if(read_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          item = std::move(s.data);
+          s.seq.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if(diff < 0) {
+        return false;
+      } else {
+        pos = read_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @brief Function to get the number of items waiting in the queue
+   *
+   * @return size_t items in the queue, approximate while the other stage is running
+   */
+  size_t depth() const {
+    size_t w = write_pos.load(std::memory_order_acquire);
+    size_t r = read_pos.load(std::memory_order_acquire);
+    return w > r ? w - r : 0;
+  }
+
+  /**
+   * @brief Function to get the number of items dropped because the queue was full
+   *
+   * @return size_t items dropped so far
+   */
+  size_t dropped() const {
+    return num_dropped.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct slot {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  std::unique_ptr<slot[]> slots;
+  size_t mask = 0;
+  alignas(64) std::atomic<size_t> write_pos{0};
+  alignas(64) std::atomic<size_t> read_pos{0};
+  alignas(64) std::atomic<size_t> num_dropped{0};
+};
+
+#endif
@@ -0,0 +1,66 @@
+/**
+ * @file frame_source.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for frame_source.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <dirent.h>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief Frames read from a video file or from the images in a directory, in sorted order
+ */
+struct frame_source {
+  cv::VideoCapture cap; // used for video files
+  std::string path; // video file or directory the frames come from
+  std::vector<std::string> paths; // used for image directories
+  size_t next = 0; // next image to read
+  bool is_dir = false;
+};
+
+/**
+ * @brief Function to open a video file or an image directory
+ *
+ * @param path path of the video file or directory
+ * @param src output frame source
+ * @return int return non-zero value on failure
+ */
+int open_frame_source(const std::string &path, frame_source &src);
+
+/**
+ * @brief Function to read the next frame
+ *
+ * @param src frame source
+ * @param frame output color frame
+ * @return bool false once there are no frames left
+ */
+bool next_frame(frame_source &src, cv::Mat &frame);
+
+/**
+ * @brief Function to get the number of frames in the source
+ *
+ * @param src frame source
+ * @return int number of frames, 0 if the video doesn't say
+ */
+int frame_count(frame_source &src);
+
+/**
+ * @brief Function to move the source so next_frame reads the given frame. Videos that can't seek
+ * exactly are read from the start up to the frame instead.
+ *
+ * @param src frame source
+ * @param index index of the frame to read next
+ * @return int return non-zero value on failure
+ */
+int seek_frame(frame_source &src, int index);
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file hamming_match.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for hamming_match.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef HAMMING_MATCH_H
+#define HAMMING_MATCH_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#define HAMMING_LSH_MIN_SIZE 2000 // use the lsh index once there are at least this many descriptors
+#define HAMMING_LSH_TABLES 8 // number of hash tables
+#define HAMMING_LSH_KEY_BITS 12 // bits sampled from a descriptor for each key
+#define HAMMING_GUIDED_MAX_DIST 64 // largest distance of a guided match
+
+/**
+ * @brief Index over a set of binary descriptors. Small sets are scanned brute force,
+ * large sets are bucketed in a bit sampling lsh index that's probed with every key
+ * at hamming distance 0 and 1.
+ */
+struct hamming_index {
+  cv::Mat descriptors; // CV_8U descriptors that were indexed, one per row
+  bool use_lsh = false;
+  std::vector<std::vector<int> > key_bits; // bit positions sampled by each table
+  std::vector<std::vector<int> > bucket_start; // start of each bucket in bucket_items, per table
+  std::vector<std::vector<int> > bucket_items; // descriptor rows sorted by bucket, per table
+};
+
+/**
+ * @brief Uniform grid over a set of keypoints, so the ones near a position can be found without
+ * scanning all of them
+ */
+struct keypoint_grid {
+  float cell_size = 0; // side of a cell in pixels
+  cv::Point2f origin; // top left corner of the first cell
+  int cols = 0;
+  int rows = 0;
+  std::vector<cv::Point2f> pts; // position of every keypoint
+  std::vector<int> cell_start; // start of each cell in cell_items, row major
+  std::vector<int> cell_items; // keypoint indices sorted by cell
+  std::vector<int> cell_of; // cell of every keypoint
+};
+
+/**
+ * @brief Function to compute the hamming distance between two binary descriptors
+ *
+ * @param a first descriptor
+ * @param b second descriptor
+ * @param nbytes length of the descriptors in bytes
+ * @return int number of bits that differ
+ */
+int hamming_distance(const uchar *a, const uchar *b, int nbytes);
+
+/**
+ * @brief Function to build the index over a set of binary descriptors
+ *
+ * @param descriptors CV_8U descriptors to index, one per row
+ * @param index output index
+ * @param lsh_min_size number of descriptors at which to switch from brute force to lsh
+ * @return int return non-zero value on failure
+ */
+int build_hamming_index(const cv::Mat &descriptors, hamming_index &index, int lsh_min_size = HAMMING_LSH_MIN_SIZE);
+
+/**
+ * @brief Function to find the two nearest neighbours of every query descriptor and keep the
+ * ones that pass Lowe's ratio test. queryIdx is the row in desc_query and trainIdx the row in the index.
+ *
+ * @param index index over the train descriptors
+ * @param desc_query CV_8U query descriptors, one per row
+ * @param ratio ratio the best distance has to be under compared to the second best
+ * @param matches output vector of the matches that passed the ratio test
+ * @param visited scratch buffer to reuse for the lsh probes, nullptr to allocate one
+ */
+void hamming_knn2_ratio(const hamming_index &index, const cv::Mat &desc_query, float ratio, std::vector<cv::DMatch> &matches,
+                        std::vector<int> *visited = nullptr);
+
+/**
+ * @brief Function to put keypoints in a uniform grid. The buffers of the grid are reused.
+ *
+ * @param keypoints keypoints to put in the grid
+ * @param cell_size side of a cell in pixels, searches within this radius only visit the 3x3 cells around a position
+ * @param grid output grid
+ */
+void build_keypoint_grid(const std::vector<cv::KeyPoint> &keypoints, float cell_size, keypoint_grid &grid);
+
+/**
+ * @brief Function to match every query descriptor only against the train keypoints within a radius of
+ * where it's expected to be. Matches further than max_dist are dropped, and ones with a second
+ * neighbour in the radius also have to pass Lowe's ratio test. queryIdx is the row in desc_query and
+ * trainIdx the row in desc_train.
+ *
+ * @param desc_query CV_8U query descriptors, one per row
+ * @param query_pts expected position of every query descriptor among the train keypoints
+ * @param desc_train CV_8U train descriptors, one per keypoint in the grid
+ * @param grid grid over the train keypoints
+ * @param radius distance in pixels from the expected position searched, at most the grid's cell size
+ * @param ratio ratio the best distance has to be under compared to the second best
+ * @param matches output vector of the matches that passed
+ * @param max_dist largest distance of a match that's kept
+ */
+void hamming_guided_ratio(const cv::Mat &desc_query, const std::vector<cv::Point2f> &query_pts, const cv::Mat &desc_train,
+                          const keypoint_grid &grid, float radius, float ratio, std::vector<cv::DMatch> &matches,
+                          int max_dist = HAMMING_GUIDED_MAX_DIST);
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * @file luma_pyramid.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for luma_pyramid.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef LUMA_PYRAMID_H
+#define LUMA_PYRAMID_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#define LUMA_PYRAMID_LEVELS 8 // same as ORB's default
+#define LUMA_PYRAMID_SCALE 1.2f // same as ORB's default
+#define LUMA_B 1868 // BGR to luma weights in 14 bit fixed point, the same ones cvtColor uses
+#define LUMA_G 9617
+#define LUMA_R 4899
+#define LUMA_SHIFT 14
+
+/**
+ * @brief Grayscale pyramid of one frame, built once and read by every stage that needs it. The scale
+ * levels and the optical flow levels are only built the first time someone asks for them.
+ */
+struct luma_pyramid {
+  int nlevels = LUMA_PYRAMID_LEVELS;
+  float scale_factor = LUMA_PYRAMID_SCALE;
+  cv::Mat gray; // luma at the processing resolution
+  cv::Mat full; // luma at the frame's resolution, only used when it's processed smaller
+  bool borrowed = false; // gray belongs to the caller, so it mustn't be written to
+  std::vector<cv::Mat> levels; // levels[0] is gray, each one scale_factor smaller than the one before
+  bool have_levels = false;
+  std::vector<cv::Mat> flow; // half the size each level with a border, the way calcOpticalFlowPyrLK reads them
+  bool have_flow = false;
+  cv::Size flow_win; // settings the flow levels were built with
+  int flow_max_level = 0;
+};
+
+/**
+ * @brief Function to set the scales of a pyramid
+ *
+ * @param pyr pyramid to set up
+ * @param nlevels number of scale levels
+ * @param scale_factor ratio between the size of one level and the next
+ */
+void luma_pyramid_init(luma_pyramid &pyr, int nlevels, float scale_factor);
+
+/**
+ * @brief Function to convert a BGR frame to luma in one vectorized pass, giving the same result as
+ * cv::cvtColor with COLOR_BGR2GRAY. Grayscale frames are copied and BGRA frames go through cvtColor.
+ *
+ * @param bgr color frame
+ * @param gray output grayscale frame
+ */
+void luma_from_bgr(const cv::Mat &bgr, cv::Mat &gray);
+
+/**
+ * @brief Function to start the pyramid of a new color frame
+ *
+ * @param pyr pyramid
+ * @param frame BGR frame
+ * @param scale processing resolution as a fraction of the frame's, gray is shrunk to it when it's under 1
+ */
+void luma_pyramid_build(luma_pyramid &pyr, const cv::Mat &frame, float scale = 1.0f);
+
+/**
+ * @brief Function to start the pyramid of a frame that's already grayscale, without copying it
+ *
+ * @param pyr pyramid
+ * @param gray grayscale frame, it has to stay unchanged while the pyramid is used
+ */
+void luma_pyramid_set_gray(luma_pyramid &pyr, const cv::Mat &gray);
+
+/**
+ * @brief Function to get the scale levels of the pyramid, building them if they haven't been yet
+ *
+ * @param pyr pyramid
+ * @return const std::vector<cv::Mat>& nlevels images, levels[0] is the full size luma
+ */
+const std::vector<cv::Mat> &luma_pyramid_levels(luma_pyramid &pyr);
+
+/**
+ * @brief Function to get the optical flow levels of the pyramid, building them if they haven't been yet
+ *
+ * @param pyr pyramid
+ * @param win_size optical flow search window, sets the border around each level
+ * @param max_level index of the smallest level
+ * @return const std::vector<cv::Mat>& levels to pass to calcOpticalFlowPyrLK
+ */
+const std::vector<cv::Mat> &luma_pyramid_flow(luma_pyramid &pyr, cv::Size win_size, int max_level);
+
+/**
+ * @brief Function to copy optical flow levels along with their borders, reusing the buffers of the copy
+ *
+ * @param src optical flow levels
+ * @param dst output copy
+ */
+void copy_flow_pyramid(const std::vector<cv::Mat> &src, std::vector<cv::Mat> &dst);
+
+#endif
@@ -5,6 +5,9 @@
  * @date 2022-04-27
  */
 
+#ifndef MARKERLESS_H
+#define MARKERLESS_H
+
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
@@ -14,16 +17,21 @@
 #include <string>
 #include <dirent.h>
 #include <opencv2/opencv.hpp>
+#include "hamming_match.h"
+#include "pose_filter.h"
+#include "planar_pose.h"
 
 /**
  * @brief Function to find the model's keypoints and descriptors for those keypoints
  * 
  * @param detector ORB detector 
- * @param model input array for model image
- * @param keypoints input array keypoints found on the image.
+ * @param path path of the model image to load
+ * @param model output array for model image
+ * @param keypoints output array keypoints found on the image.
  * @param descriptors descriptors for the keypoints found in the model. 
+ * @return int return non-zero value if the image could not be read.
  */
-void get_model_kp_desc(cv::Ptr<cv::ORB> detector, cv::Mat &model, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors); 
+int get_model_kp_desc(cv::Ptr<cv::ORB> detector, const std::string &path, cv::Mat &model, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors); 
 
 /**
  * @brief Function to match keypoints in the scene and the model
@@ -36,21 +44,101 @@ void get_model_kp_desc(cv::Ptr<cv::ORB> detector, cv::Mat &model, std::vector<cv
  */
 void match_kps(cv::Ptr<cv::DescriptorMatcher> matcher, cv::Mat &desc_scene, cv::Mat &desc_model, std::vector<cv::DMatch> &acceptable_matches, bool &enough); 
 
+/**
+ * @brief Function to match keypoints in the scene and the model by hamming distance
+ * 
+ * @param index_model hamming index over the descriptors of the model
+ * @param desc_scene input array of descriptors of keypoints in the scene
+ * @param acceptable_matches output vector of the top matches, queryIdx is the model and trainIdx the scene
+ * @param enough boolean that indicates whether or not there are sufficient keypoint matches between the scene and boolean 
+ * @param visited scratch buffer to reuse for the lsh probes, nullptr to allocate one
+ */
+void match_kps(const hamming_index &index_model, const cv::Mat &desc_scene, std::vector<cv::DMatch> &acceptable_matches, bool &enough, 
+               std::vector<int> *visited = nullptr); 
+
+/**
+ * @brief Function to match keypoints in the scene and the model when there's a prediction of where the
+ * model is. Each model keypoint is projected through the predicted homography and only compared against
+ * the scene keypoints within radius of where it lands, which also drops most outliers before the homography is found.
+ * 
+ * @param keypoints_model keypoints in the model
+ * @param desc_model descriptors of the keypoints in the model
+ * @param homography predicted homography from the model to the scene
+ * @param desc_scene input array of descriptors of keypoints in the scene
+ * @param grid grid over the keypoints in the scene
+ * @param radius pixels around each projected model keypoint that are searched
+ * @param acceptable_matches output vector of the top matches, queryIdx is the model and trainIdx the scene
+ * @param enough boolean that indicates whether or not there are sufficient keypoint matches between the scene and boolean 
+ * @param projected scratch buffer to reuse for the projected model keypoints, nullptr to allocate one
+ */
+void match_kps_guided(const std::vector<cv::KeyPoint> &keypoints_model, const cv::Mat &desc_model, const cv::Mat &homography, 
+                      const cv::Mat &desc_scene, const keypoint_grid &grid, float radius, std::vector<cv::DMatch> &acceptable_matches, 
+                      bool &enough, std::vector<cv::Point2f> *projected = nullptr); 
+
+/**
+ * @brief Function to find the homography that maps the model onto the scene
+ * 
+ * @param matches keypoint matches, queryIdx is the model and trainIdx the scene
+ * @param keypoints_model keypoints in the model
+ * @param keypoints_scene keypoints in the scene
+ * @param inliers output mask of the matches that agree with the homography
+ * @return cv::Mat 3x3 homography, empty if one couldn't be found
+ */
+cv::Mat get_homography(const std::vector<cv::DMatch> &matches, const std::vector<cv::KeyPoint> &keypoints_model, 
+                       const std::vector<cv::KeyPoint> &keypoints_scene, std::vector<uchar> &inliers); 
+
+/**
+ * @brief Function to get the rotations and translations of the model from its homography
+ * 
+ * @param homography homography from the model to the scene
+ * @param model_size size of the model image
+ * @param rotations output array of the rotations
+ * @param translations output array of the translations
+ * @param cam_mat camera matrix 
+ * @param dist_coeffs distortion coefficients
+ * @param scene_corners output array of the corners of the surface in the scene
+ */
+void pose_from_homography(const cv::Mat &homography, cv::Size model_size, cv::Mat &rotations, cv::Mat &translations, 
+                          cv::Mat cam_mat, cv::Mat dist_coeffs, std::vector<cv::Point2f> &scene_corners); 
+
 /**
  * @brief Function to get the rotations and translations from the solvePnP opencv function
  * 
  * @param matches keypoint matches
  * @param keypoints_model keypoints in the model
  * @param keypoints_scene keypoints in the scene
- * @param model the model image
+ * @param model_size size of the model image
  * @param rotations output array of the rotations
  * @param translations output array of the translations
  * @param cam_mat camera matrix 
  * @param dist_coeffs distortion coefficients
  * @param scene_corners output array of the corners of the surface in the scene
  */
-void get_rots_and_trans(std::vector<cv::DMatch> &matches, std::vector<cv::KeyPoint> &keypoints_model, std::vector<cv::KeyPoint> &keypoints_scene, 
-                        cv::Mat &model, cv::Mat &rotations, cv::Mat &translations, cv::Mat cam_mat, cv::Mat dist_coeffs, std::vector<cv::Point2f> &scene_corners); 
+void get_rots_and_trans(const std::vector<cv::DMatch> &matches, const std::vector<cv::KeyPoint> &keypoints_model, const std::vector<cv::KeyPoint> &keypoints_scene, 
+                        cv::Size model_size, cv::Mat &rotations, cv::Mat &translations, cv::Mat cam_mat, cv::Mat dist_coeffs, std::vector<cv::Point2f> &scene_corners); 
+
+/**
+ * @brief Function to get the rotations and translations from the solvePnP opencv function,
+ * also returning the homography and which matches agreed with it. The homography is found with 
+ * PROSAC and the pose with IPPE, see solve_planar_pose. 
+ * 
+ * @param matches keypoint matches
+ * @param keypoints_model keypoints in the model
+ * @param keypoints_scene keypoints in the scene
+ * @param model_size size of the model image
+ * @param rotations output array of the rotations
+ * @param translations output array of the translations
+ * @param cam_mat camera matrix 
+ * @param dist_coeffs distortion coefficients
+ * @param scene_corners output array of the corners of the surface in the scene, empty if there's no pose
+ * @param homography output homography from the model to the scene
+ * @param inliers output mask of the matches that agree with the homography
+ * @param filter filter that smooths the homography over time, nullptr to use the raw homography
+ * @param ws buffers to reuse, nullptr to allocate them
+ */
+void get_rots_and_trans(const std::vector<cv::DMatch> &matches, const std::vector<cv::KeyPoint> &keypoints_model, const std::vector<cv::KeyPoint> &keypoints_scene, 
+                        cv::Size model_size, cv::Mat &rotations, cv::Mat &translations, cv::Mat cam_mat, cv::Mat dist_coeffs, std::vector<cv::Point2f> &scene_corners, 
+                        cv::Mat &homography, std::vector<uchar> &inliers, pose_filter *filter = nullptr, pose_workspace *ws = nullptr); 
 
 /**
  * @brief Function to draw the axes
@@ -61,4 +149,19 @@ void get_rots_and_trans(std::vector<cv::DMatch> &matches, std::vector<cv::KeyPoi
  * @param color color of the axes
  * @return int 
  */
-int axes_points(std::vector<cv::Vec3f> &points, cv::Vec3f origin, float scale); 
\ No newline at end of file
+int axes_points(std::vector<cv::Vec3f> &points, cv::Vec3f origin, float scale);
+
+/**
+ * @brief Function to draw the outline of the target and its axes
+ * 
+ * @param dst image to draw on
+ * @param scene_corners corners of the surface in the scene
+ * @param rotations rotations of the target
+ * @param translations translations of the target
+ * @param cam_mat camera matrix 
+ * @param dist_coeffs distortion coefficients
+ */
+void draw_pose(cv::Mat &dst, const std::vector<cv::Point2f> &scene_corners, const cv::Mat &rotations, const cv::Mat &translations, 
+               cv::Mat cam_mat, cv::Mat dist_coeffs); 
+
+#endif
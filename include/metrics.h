@@ -0,0 +1,111 @@
+/**
+ * @file metrics.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for metrics.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#define METRICS_BUCKETS 40 // power of two buckets of each histogram, the last one also holds everything bigger
+#define METRICS_TRACE_MAX_EVENTS 1000000 // events kept for the trace, later ones are dropped
+#define METRICS_FLUSH_FRAMES 300 // frames between writes of the metrics file
+
+/**
+ * @brief Stages of the frame loop that are timed
+ */
+enum metric_stage {
+  STAGE_CAPTURE,
+  STAGE_GRAYSCALE,
+  STAGE_DETECT, // detectAndCompute
+  STAGE_MATCH, // match_kps
+  STAGE_HOMOGRAPHY,
+  STAGE_PNP, // solvePnP
+  STAGE_FLOW, // optical flow tracking
+  STAGE_DRAW,
+  STAGE_FRAME, // the whole frame
+  METRIC_STAGES
+};
+
+/**
+ * @brief Quantities counted in each frame
+ */
+enum metric_count {
+  COUNT_KEYPOINTS, // scene keypoints detected
+  COUNT_MATCHES, // matches that passed the ratio test
+  COUNT_INLIERS, // matches that agree with the homography
+  METRIC_COUNTS
+};
+
+/**
+ * @brief Function to start collecting metrics. Until this is called the timers and counters do nothing.
+ *
+ * @param trace_events also keep every timed span and count for a trace timeline
+ */
+void metrics_enable(bool trace_events);
+
+/**
+ * @brief Function to check whether metrics are being collected
+ *
+ * @return bool true once metrics_enable has been called
+ */
+bool metrics_enabled();
+
+/**
+ * @brief Function to add one timed span of a stage
+ *
+ * @param stage stage that was timed
+ * @param start cv::getTickCount at the start
+ * @param end cv::getTickCount at the end
+ */
+void metrics_record(metric_stage stage, int64 start, int64 end);
+
+/**
+ * @brief Function to add one count, for example the keypoints found in a frame
+ *
+ * @param counter what was counted
+ * @param value count
+ */
+void metrics_count(metric_count counter, int64_t value);
+
+/**
+ * @brief Function to append the histograms since the last flush to a file and start new ones. Files
+ * ending in .json get one JSON object per line, anything else gets CSV rows.
+ *
+ * @param path file to append to
+ * @return int return non-zero value if the file couldn't be written
+ */
+int metrics_flush(const std::string &path);
+
+/**
+ * @brief Function to write the trace timeline in the Chrome trace event format, for chrome://tracing or Perfetto
+ *
+ * @param path file to write
+ * @return int return non-zero value if the file couldn't be written
+ */
+int metrics_write_trace(const std::string &path);
+
+/**
+ * @brief Times a stage from where it's declared to the end of its scope, or to stop() if that comes
+ * first. Costs one check when metrics are off.
+ */
+struct scoped_timer {
+  metric_stage stage;
+  int64 start; // 0 when there's nothing to record
+  explicit scoped_timer(metric_stage s) : stage(s), start(metrics_enabled() ? cv::getTickCount() : 0) {}
+  ~scoped_timer() { stop(); }
+  void stop() {
+    if(start != 0) metrics_record(stage, start, cv::getTickCount());
+    start = 0;
+  }
+};
+
+#endif
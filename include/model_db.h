@@ -0,0 +1,157 @@
+/**
+ * @file model_db.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for model_db.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef MODEL_DB_H
+#define MODEL_DB_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <dirent.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <memory>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "hamming_match.h"
+
+#define VOCAB_BRANCHING 8 // children per node of the vocabulary tree
+#define VOCAB_DEPTH 4 // levels of the vocabulary tree, so up to 8^4 words
+
+/**
+ * @brief A vocabulary tree over binary descriptors. Node 0 is the root and the
+ * children of a node are stored next to each other in the node arrays.
+ */
+struct vocab_tree {
+  cv::Mat centers; // one CV_8U row per node, the cluster center of that node
+  std::vector<int> first_child; // index of the node's first child, -1 for leaves
+  std::vector<int> num_children; // number of children of the node
+  std::vector<int> word_id; // word of the node if it's a leaf, -1 otherwise
+  std::vector<float> idf; // inverse document frequency weight of each word
+  int num_words = 0;
+};
+
+/**
+ * @brief Entry of the inverted index, a target that contains a word and its weight
+ */
+struct inverted_entry {
+  int target;
+  float weight;
+};
+
+/**
+ * @brief A single planar target that can be tracked
+ */
+struct model_target {
+  std::string name; // file name of the model image
+  cv::Mat model; // model image that's been resized, empty if the features came from the cache
+  cv::Size size; // size of the resized model image
+  int64_t mtime = 0; // modification time of the model image file in nanoseconds
+  int64_t file_size = 0; // size of the model image file
+  std::vector<cv::KeyPoint> keypoints; // keypoints found on the model
+  cv::Mat descriptors; // descriptors of the keypoints
+  hamming_index index; // matcher index over the descriptors
+  std::vector<std::pair<int, float> > bow; // tf-idf bag of words sorted by word id
+};
+
+/**
+ * @brief Database of every planar target with an inverted index to find which target is in view
+ */
+struct model_db {
+  std::vector<model_target> targets;
+  vocab_tree vocab;
+  std::vector<std::vector<inverted_entry> > inverted_index; // list of targets for each word
+  std::shared_ptr<void> feature_mapping; // mapped feature cache that cached descriptors point into
+};
+
+/**
+ * @brief Buffers query_model_db reuses from one frame to the next so it doesn't allocate once they've grown
+ */
+struct query_workspace {
+  std::vector<float> word_weight; // weight of every word in the current bag, zero for words not in it
+  std::vector<int> words; // words in the current bag
+  std::vector<std::pair<int, float> > bow;
+  std::vector<float> score; // score of every target, zero for targets not touched
+  std::vector<int> touched; // targets that share a word with the scene
+};
+
+/**
+ * @brief Function to load every model image in a directory into the database and build the inverted index.
+ * Keypoints and descriptors come from the feature cache in the directory for images that haven't changed.
+ * The trained index is loaded from index_path when it's up to date, otherwise it's rebuilt and saved there.
+ *
+ * @param detector ORB detector
+ * @param dirname directory that holds the model images
+ * @param db output database of targets
+ * @param index_path file to load the trained index from and save it to, empty to always rebuild it
+ * @return int return non-zero value on failure
+ */
+int load_model_db(cv::Ptr<cv::ORB> detector, const std::string &dirname, model_db &db, const std::string &index_path = "");
+
+/**
+ * @brief Function to get the resized model image of a target, reading it again if its features came from the cache
+ *
+ * @param dirname directory that holds the model images
+ * @param target target
+ * @param model output model image
+ * @return int return non-zero value if the image could not be read
+ */
+int get_model_image(const std::string &dirname, const model_target &target, cv::Mat &model);
+
+/**
+ * @brief Function to save the trained vocabulary, bags of words and matcher indices to a binary file
+ *
+ * @param db database with a built index
+ * @param filename file to write
+ * @return int return non-zero value on failure
+ */
+int save_model_db_index(const model_db &db, const std::string &filename);
+
+/**
+ * @brief Function to load the trained index saved by save_model_db_index. The targets must already
+ * be loaded and match the ones the index was trained on.
+ *
+ * @param db database whose targets have been loaded
+ * @param filename file to read
+ * @return int return non-zero value if the file is missing, corrupt or out of date
+ */
+int load_model_db_index(model_db &db, const std::string &filename);
+
+/**
+ * @brief Function to train the vocabulary tree on the descriptors of every target and fill the inverted index
+ *
+ * @param db database whose targets have already been loaded
+ * @return int return non-zero value on failure
+ */
+int build_model_db_index(model_db &db);
+
+/**
+ * @brief Function to turn a set of descriptors into a normalized tf-idf bag of words
+ *
+ * @param vocab trained vocabulary tree
+ * @param descriptors input array of descriptors
+ * @param bow output bag of words sorted by word id
+ * @param ws buffers to reuse, nullptr to allocate them
+ */
+void compute_bow(const vocab_tree &vocab, const cv::Mat &descriptors, std::vector<std::pair<int, float> > &bow,
+                 query_workspace *ws = nullptr);
+
+/**
+ * @brief Function to find the targets that are most likely in the scene
+ *
+ * @param db database of targets
+ * @param desc_scene input array of descriptors of keypoints in the scene
+ * @param max_candidates maximum number of candidates to return
+ * @param candidates output vector of (target index, score) sorted by best score first
+ * @param ws buffers to reuse, nullptr to allocate them
+ */
+void query_model_db(const model_db &db, const cv::Mat &desc_scene, int max_candidates, std::vector<std::pair<int, float> > &candidates,
+                    query_workspace *ws = nullptr);
+
+#endif
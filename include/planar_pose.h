@@ -0,0 +1,96 @@
+/**
+ * @file planar_pose.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for planar_pose.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef PLANAR_POSE_H
+#define PLANAR_POSE_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#define PROSAC_MAX_ITERS 2000 // most hypotheses to try
+#define PROSAC_CONFIDENCE 0.995 // stop once we're this sure the best hypothesis is right
+#define PROSAC_REPROJ_THRESH 3.0f // largest distance in pixels for a match to be an inlier
+
+/**
+ * @brief Pose of a planar target and how well the matches agree with it
+ */
+struct planar_pose {
+  cv::Mat homography; // 3x3 homography from the model to the scene
+  std::vector<uchar> inliers; // mask of the matches that agree with the homography, in the order of the matches
+  int num_inliers = 0;
+  int iterations = 0; // hypotheses PROSAC tried before stopping
+  float reproj_err = 0; // mean distance in pixels between the inliers and the model points projected with the pose
+  cv::Mat rotations;
+  cv::Mat translations;
+  std::vector<cv::Point2f> scene_corners; // corners of the model in the scene
+};
+
+/**
+ * @brief Buffers solve_planar_pose reuses from one frame to the next so it doesn't allocate once they've grown
+ */
+struct pose_workspace {
+  std::vector<int> order; // matches sorted by distance
+  std::vector<cv::Point2f> model_pts;
+  std::vector<cv::Point2f> scene_pts;
+  std::vector<uchar> sorted_inliers;
+  std::vector<uchar> mask; // inliers of the current hypothesis
+  std::vector<cv::Point3f> object_pts;
+  std::vector<cv::Point2f> image_pts;
+  std::vector<cv::Point2f> projected;
+  std::vector<cv::Point2f> model_corners;
+  planar_pose pose; // pose found by get_rots_and_trans
+  cv::Mat smoothed; // homography after the pose filter
+};
+
+/**
+ * @brief Function to get the point on the target's plane for a pixel of the model image. The model's
+ * corners land on (0,0), (0,-1), (-1,-1) and (-1,0) so the pose matches the one from pose_from_homography.
+ *
+ * @param pt pixel in the model image
+ * @param model_size size of the model image
+ * @return cv::Point3f point on the target's plane, z is 0
+ */
+cv::Point3f model_to_object(const cv::Point2f &pt, cv::Size model_size);
+
+/**
+ * @brief Function to find a homography with PROSAC. Samples are drawn from the best matches first and the
+ * pool grows towards the rest, so a good hypothesis is usually found in the first few tries.
+ *
+ * @param model_pts points in the model, sorted best match first
+ * @param scene_pts matching points in the scene
+ * @param thresh largest distance in pixels for a point to be an inlier
+ * @param homography output 3x3 homography refined on the inliers
+ * @param inliers output mask of the points that agree with the homography
+ * @param iterations output number of hypotheses tried
+ * @param ws buffers to reuse, nullptr to allocate them
+ * @return bool true if a homography was found
+ */
+bool find_homography_prosac(const std::vector<cv::Point2f> &model_pts, const std::vector<cv::Point2f> &scene_pts, float thresh,
+                            cv::Mat &homography, std::vector<uchar> &inliers, int &iterations, pose_workspace *ws = nullptr);
+
+/**
+ * @brief Function to get the pose of a planar target from its matches. The homography comes from PROSAC
+ * ordered by match distance, then the pose is solved in closed form with IPPE on the inliers.
+ *
+ * @param matches keypoint matches, queryIdx is the model and trainIdx the scene
+ * @param keypoints_model keypoints in the model
+ * @param keypoints_scene keypoints in the scene
+ * @param model_size size of the model image
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param pose output pose
+ * @param ws buffers to reuse, nullptr to allocate them
+ * @return bool true if a pose was found
+ */
+bool solve_planar_pose(const std::vector<cv::DMatch> &matches, const std::vector<cv::KeyPoint> &keypoints_model,
+                       const std::vector<cv::KeyPoint> &keypoints_scene, cv::Size model_size,
+                       cv::Mat cam_mat, cv::Mat dist_coeffs, planar_pose &pose, pose_workspace *ws = nullptr);
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file pose_filter.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for pose_filter.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef POSE_FILTER_H
+#define POSE_FILTER_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <opencv2/opencv.hpp>
+
+#define POSE_FILTER_MAX_WINDOW 32 // most homographies a filter can average
+#define POSE_FILTER_DEFAULT_WINDOW 10 // homographies averaged unless configured otherwise
+
+/**
+ * @brief Moving average of the last few homographies. The history is a fixed ring buffer
+ * with a running sum, so an update costs the same no matter how long the session runs.
+ */
+struct pose_filter {
+  int window = POSE_FILTER_DEFAULT_WINDOW; // homographies averaged, 1 turns smoothing off
+  int count = 0; // homographies in the history
+  int next = 0; // slot the next homography goes into
+  double history[POSE_FILTER_MAX_WINDOW][9]; // normalized homographies, oldest is overwritten first
+  double sum[9] = { 0 }; // running sum of the history
+};
+
+/**
+ * @brief Function to set how many homographies the filter averages and clear its history
+ *
+ * @param filter filter to configure
+ * @param window number of homographies to average, clamped to [1, POSE_FILTER_MAX_WINDOW]
+ */
+void pose_filter_init(pose_filter &filter, int window);
+
+/**
+ * @brief Function to add a homography to the filter and get the smoothed homography
+ *
+ * @param filter filter to update
+ * @param homography newest 3x3 homography
+ * @param smoothed output 3x3 CV_64F average of the homographies in the window
+ */
+void pose_filter_update(pose_filter &filter, const cv::Mat &homography, cv::Mat &smoothed);
+
+/**
+ * @brief Function to clear the history of the filter, e.g. when the target changes
+ *
+ * @param filter filter to reset
+ */
+void pose_filter_reset(pose_filter &filter);
+
+#endif
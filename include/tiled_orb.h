@@ -0,0 +1,99 @@
+/**
+ * @file tiled_orb.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for tiled_orb.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef TILED_ORB_H
+#define TILED_ORB_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "luma_pyramid.h"
+
+#define TILED_ORB_CELL_FEATURES 5 // keypoints kept in each cell of the grid
+#define TILED_ORB_MIN_CELL 16 // smallest cell side in pixels
+#define TILED_ORB_MIN_FAST_THRESHOLD 7 // FAST threshold for cells that find too few corners with the normal one
+#define TILED_ORB_BAND_HEIGHT 96 // rows of a pyramid level described by one task
+#define TILED_ORB_FAST_BORDER 4 // pixels FAST needs around a cell to score and suppress corners on its edge
+
+/**
+ * @brief One cell of the grid a pyramid level is detected in
+ */
+struct tiled_orb_cell {
+  int level = 0;
+  cv::Rect rect; // area of the level the cell's keypoints come from
+  int quota = 0; // most keypoints kept in the cell
+  int band = 0; // band whose task describes the cell's keypoints
+  std::vector<cv::KeyPoint> keypoints; // in the coordinates of the level
+};
+
+/**
+ * @brief Rows of a pyramid level whose keypoints are described together
+ */
+struct tiled_orb_band {
+  int level = 0;
+  int top = 0; // rows of the level handed to ORB, with a margin so descriptors near the edge see their whole patch
+  int bottom = 0;
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat descriptors;
+};
+
+/**
+ * @brief ORB that detects on a grid so keypoints spread over the whole frame, with the cells and the
+ * descriptors computed in parallel. The settings are taken from an ORB detector and the descriptors
+ * match the ones it computes, so they can be matched against the model database.
+ */
+struct tiled_orb {
+  int max_features = 500;
+  int nlevels = 8;
+  float scale_factor = 1.2f;
+  int edge_threshold = 31;
+  int patch_size = 31;
+  int fast_threshold = 20;
+  int min_fast_threshold = TILED_ORB_MIN_FAST_THRESHOLD;
+  int wta_k = 2;
+  cv::ORB::ScoreType score_type = cv::ORB::HARRIS_SCORE;
+  std::vector<int> umax; // half width of each row of the circular patch, for the orientation
+  cv::Size frame_size; // size the grid was laid out for
+  luma_pyramid pyramid; // used when the caller only has a grayscale image
+  std::vector<tiled_orb_cell> cells;
+  std::vector<tiled_orb_band> bands;
+  std::vector<cv::Ptr<cv::ORB> > orbs; // one per band so they can run at the same time, kept when the grid changes
+};
+
+/**
+ * @brief Function to set up a tiled extractor with the settings of an ORB detector
+ *
+ * @param tiled extractor to set up
+ * @param orb ORB detector whose settings are used
+ */
+void tiled_orb_init(tiled_orb &tiled, cv::Ptr<cv::ORB> orb);
+
+/**
+ * @brief Function to detect keypoints and compute their descriptors. Each pyramid level is split into
+ * grid cells that keep their best corners, with a lower FAST threshold where the texture is weak.
+ *
+ * @param tiled extractor
+ * @param gray grayscale image
+ * @param keypoints output keypoints in image coordinates
+ * @param descriptors output descriptors, one row per keypoint
+ */
+void tiled_orb_detect_and_compute(tiled_orb &tiled, const cv::Mat &gray, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors);
+
+/**
+ * @brief Function to detect keypoints and compute their descriptors on the scale levels of a frame's
+ * shared pyramid, so they aren't built again. The pyramid takes the extractor's scales.
+ *
+ * @param tiled extractor
+ * @param pyr pyramid of the frame
+ * @param keypoints output keypoints in image coordinates
+ * @param descriptors output descriptors, one row per keypoint
+ */
+void tiled_orb_detect_and_compute(tiled_orb &tiled, luma_pyramid &pyr, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors);
+
+#endif
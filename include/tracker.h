@@ -0,0 +1,278 @@
+/**
+ * @file tracker.h
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Header file for tracker.cpp
+ * @date 2026-10-17
+ */
+
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "pose_filter.h"
+#include "markerless.h"
+#include "model_db.h"
+#include "planar_pose.h"
+#include "tiled_orb.h"
+#include "luma_pyramid.h"
+
+#define TRACK_MIN_POINTS 20 // fewest tracked points before we detect again
+#define TRACK_MAX_REPROJ_ERR 3.0f // largest mean reprojection error in pixels before we detect again
+#define TRACK_WIN_SIZE 21 // optical flow search window
+#define TRACK_PYR_LEVELS 3 // optical flow pyramid levels
+#define ROI_MARGIN 0.25f // fraction of the target's size added around it for motion between frames
+#define ROI_BORDER 32 // pixels added around the region since ORB doesn't detect near the edges
+#define ROI_MAX_AREA 0.5f // search the whole frame once the region covers more than this fraction of it
+#define GUIDED_RADIUS 24.0f // pixels around where the prediction puts a model keypoint that are searched for its match
+#define MULTI_MAX_TARGETS 4 // most targets found in one frame
+#define MULTI_EXTRA_CANDIDATES 2 // candidates matched beyond the targets still missing, in case the best scores are wrong
+
+/**
+ * @brief Buffers a tracker reuses from one frame to the next so the steady-state loop doesn't allocate once they've grown
+ */
+struct tracker_workspace {
+  query_workspace query; // database query
+  std::vector<int> visited; // lsh probes of the matcher
+  pose_workspace pose; // homography and pose
+  std::vector<std::pair<int, float> > candidates;
+  std::vector<uchar> inliers;
+  std::vector<cv::Point2f> next_pts; // optical flow
+  std::vector<uchar> status;
+  std::vector<float> err;
+  std::vector<cv::Point2f> projected;
+  cv::Mat homography;
+  cv::Mat smoothed;
+  luma_pyramid pyramid; // wraps the frame when the caller only has it in grayscale
+};
+
+/**
+ * @brief State of a target that's being followed with optical flow between detections
+ */
+struct planar_tracker {
+  bool locked = false; // true while the target is being tracked
+  int target = -1; // index of the target in the model database
+  std::vector<cv::Mat> prev_flow; // optical flow levels of the previous frame
+  std::vector<cv::Point2f> model_pts; // model coordinates of the tracked points
+  std::vector<cv::Point2f> scene_pts; // positions of the tracked points in the previous frame
+  cv::Mat homography; // last homography from the model to the scene
+  float reproj_err = 0; // mean reprojection error of the last homography
+  int min_points = TRACK_MIN_POINTS;
+  float max_reproj_err = TRACK_MAX_REPROJ_ERR;
+  pose_filter filter; // smooths the homography of this tracker's target
+  int filter_target = -1; // target whose homographies are in the filter
+  bool use_roi = false; // only detect around the target's last position until it's lost
+  std::vector<cv::Point2f> roi_corners; // corners of the target in the last frame, empty once it's lost
+  tiled_orb *tiled = nullptr; // detect on a grid with this instead of the ORB detector, if it's set
+  bool guided = false; // match around where the last homography puts the model while there is one
+  int predicted_target = -1; // target found in the last frame, -1 once it's lost
+  cv::Mat predicted; // homography of predicted_target in the last frame
+  tracker_workspace ws; // buffers reused every frame
+};
+
+/**
+ * @brief Everything found in one frame, from the scene features to the pose of the target
+ */
+struct frame_result {
+  bool have_features = false; // keypoints_scene and descriptors_scene are filled in
+  std::vector<cv::KeyPoint> keypoints_scene;
+  cv::Mat descriptors_scene;
+  cv::Rect roi; // region of the frame the features were detected in
+  bool have_grid = false; // grid is built over keypoints_scene
+  keypoint_grid grid; // scene keypoints by position, for guided matching
+  std::vector<cv::DMatch> matches; // acceptable matches, queryIdx is the model and trainIdx the scene
+  bool sufficient_matches = false;
+  bool have_pose = false;
+  bool tracked = false; // the pose came from optical flow instead of a detection
+  int target = 0; // index of the target in the model database
+  int num_inliers = 0; // matches or tracked points that agree with the homography
+  cv::Mat homography;
+  cv::Mat rotations;
+  cv::Mat translations;
+  std::vector<cv::Point2f> scene_corners;
+};
+
+/**
+ * @brief Pose of one target in a frame found by locate_targets
+ */
+struct target_result {
+  bool have_pose = false;
+  bool tracked = false; // the pose came from optical flow instead of a detection
+  int num_inliers = 0; // matches or tracked points that agree with the homography
+  std::vector<cv::DMatch> matches; // acceptable matches, queryIdx is the model and trainIdx the scene
+  cv::Mat homography;
+  cv::Mat rotations;
+  cv::Mat translations;
+  std::vector<cv::Point2f> scene_corners;
+};
+
+/**
+ * @brief Trackers for every target in the database, so several can be followed in the same frame
+ */
+struct multi_tracker {
+  std::vector<planar_tracker> trackers; // one per target, in the order of the database
+  int max_targets = MULTI_MAX_TARGETS; // stop detecting once this many targets have a pose
+  tiled_orb *tiled = nullptr; // detect on a grid with this instead of the ORB detector, if it's set
+  bool guided = false; // match each target around where it was in the last frame while there's a prediction
+  query_workspace query; // buffers of the database query
+  std::vector<std::pair<int, float> > candidates;
+  std::vector<int> jobs; // targets whose pose is estimated this frame
+};
+
+/**
+ * @brief Function to start tracking a target from the inliers of a detection
+ *
+ * @param tracker tracker to lock
+ * @param target index of the target in the model database
+ * @param pyr pyramid of the frame the detection ran on
+ * @param matches keypoint matches, queryIdx is the model and trainIdx the scene
+ * @param keypoints_model keypoints in the model
+ * @param keypoints_scene keypoints in the scene
+ * @param inliers mask of the matches that agree with the homography
+ * @param homography homography from the model to the scene
+ * @return bool true if there were enough inliers to lock on
+ */
+bool tracker_lock(planar_tracker &tracker, int target, luma_pyramid &pyr, const std::vector<cv::DMatch> &matches,
+                  const std::vector<cv::KeyPoint> &keypoints_model, const std::vector<cv::KeyPoint> &keypoints_scene,
+                  const std::vector<uchar> &inliers, const cv::Mat &homography);
+
+/**
+ * @brief Function to follow the tracked points into a new frame with pyramidal Lucas-Kanade
+ *
+ * @param tracker locked tracker
+ * @param pyr pyramid of the new frame
+ * @param homography output homography from the model to the new frame
+ * @return bool true if the target is still tracked, false if it needs to be detected again
+ */
+bool tracker_update(planar_tracker &tracker, luma_pyramid &pyr, cv::Mat &homography);
+
+/**
+ * @brief Function to drop the tracked target
+ *
+ * @param tracker tracker to reset
+ */
+void tracker_reset(planar_tracker &tracker);
+
+/**
+ * @brief Function to drop everything the tracker remembers in frame coordinates, for when the
+ * processing resolution changes
+ *
+ * @param tracker tracker to clear
+ */
+void tracker_clear_history(planar_tracker &tracker);
+
+/**
+ * @brief Function to detect the keypoints and descriptors of a frame
+ *
+ * @param orb ORB detector
+ * @param gray grayscale frame
+ * @param result result whose scene features are filled in
+ * @param tiled tiled extractor to use instead of the ORB detector, nullptr to use ORB
+ */
+void extract_features(cv::Ptr<cv::ORB> orb, const cv::Mat &gray, frame_result &result, tiled_orb *tiled = nullptr);
+
+/**
+ * @brief Function to detect the keypoints and descriptors of a frame from its shared pyramid. The tiled
+ * extractor reads the pyramid's scale levels, ORB builds its own from the full size level.
+ *
+ * @param orb ORB detector
+ * @param pyr pyramid of the frame
+ * @param result result whose scene features are filled in
+ * @param tiled tiled extractor to use instead of the ORB detector, nullptr to use ORB
+ */
+void extract_features(cv::Ptr<cv::ORB> orb, luma_pyramid &pyr, frame_result &result, tiled_orb *tiled = nullptr);
+
+/**
+ * @brief Function to detect the keypoints and descriptors in one region of a frame. ORB only runs
+ * on the region, and the keypoints are moved back into frame coordinates.
+ *
+ * @param orb ORB detector
+ * @param gray grayscale frame
+ * @param roi region of the frame to detect in
+ * @param result result whose scene features are filled in
+ * @param tiled tiled extractor to use instead of the ORB detector, nullptr to use ORB
+ */
+void extract_features(cv::Ptr<cv::ORB> orb, const cv::Mat &gray, const cv::Rect &roi, frame_result &result,
+                      tiled_orb *tiled = nullptr);
+
+/**
+ * @brief Function to get the region to detect a target in from where it was in the last frame
+ *
+ * @param corners corners of the target in the last frame
+ * @param frame_size size of the frame
+ * @param roi output region, the target's bounding box grown by ROI_MARGIN and clipped to the frame
+ * @return bool false if the region isn't worth using, because the corners are missing or it covers most of the frame
+ */
+bool predict_roi(const std::vector<cv::Point2f> &corners, cv::Size frame_size, cv::Rect &roi);
+
+/**
+ * @brief Function to find a target and its pose in a frame. A locked tracker is followed with
+ * optical flow, otherwise the frame's features are matched against the database. With use_roi set,
+ * features are only detected around where the target was in the last frame until it's lost, and with
+ * guided set the target from the last frame is matched first, only around where its homography predicts.
+ *
+ * @param tracker tracker of the target, also owns the pose filter
+ * @param db database of targets
+ * @param orb ORB detector, used if result doesn't have features yet and detection is needed
+ * @param gray grayscale frame
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param tracking whether to track between detections
+ * @param result output result of the frame
+ * @return bool true if a pose was found
+ */
+bool locate_target(planar_tracker &tracker, const model_db &db, cv::Ptr<cv::ORB> orb, const cv::Mat &gray,
+                   cv::Mat cam_mat, cv::Mat dist_coeffs, bool tracking, frame_result &result);
+
+/**
+ * @brief Function to find a target and its pose in a frame from the frame's shared pyramid, so
+ * detection and optical flow don't build their own
+ *
+ * @param tracker tracker of the target, also owns the pose filter
+ * @param db database of targets
+ * @param orb ORB detector, used if result doesn't have features yet and detection is needed
+ * @param pyr pyramid of the frame
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param tracking whether to track between detections
+ * @param result output result of the frame
+ * @return bool true if a pose was found
+ */
+bool locate_target(planar_tracker &tracker, const model_db &db, cv::Ptr<cv::ORB> orb, luma_pyramid &pyr,
+                   cv::Mat cam_mat, cv::Mat dist_coeffs, bool tracking, frame_result &result);
+
+/**
+ * @brief Function to set up a tracker for every target in the database
+ *
+ * @param tracker trackers to set up
+ * @param db database of targets
+ * @param smoothing frames the pose of each target is averaged over
+ * @param max_targets most targets to find in one frame
+ */
+void multi_tracker_init(multi_tracker &tracker, const model_db &db, int smoothing, int max_targets);
+
+/**
+ * @brief Function to find several targets and their poses in a frame. Locked targets are followed with
+ * optical flow, then if fewer than max_targets were found the frame's features are extracted once and
+ * matched against the best candidates from the database. The pose of each target is estimated in parallel.
+ *
+ * @param tracker trackers of the targets
+ * @param db database of targets
+ * @param orb ORB detector, used if features doesn't have them yet and detection is needed
+ * @param pyr pyramid of the frame
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param tracking whether to track between detections
+ * @param features scene features of the frame, extracted if they're needed and missing
+ * @param results output poses, one per target in the order of the database
+ * @return int number of targets with a pose
+ */
+int locate_targets(multi_tracker &tracker, const model_db &db, cv::Ptr<cv::ORB> orb, luma_pyramid &pyr,
+                   cv::Mat cam_mat, cv::Mat dist_coeffs, bool tracking, frame_result &features,
+                   std::vector<target_result> &results);
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file alloc_counter.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Counts heap allocations so we can check the frame loop doesn't make any once it's warmed up
+ * @date 2026-10-17
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <opencv2/opencv.hpp>
+#include "../include/alloc_counter.h"
+
+static std::atomic<uint64_t> heap_count(0);
+static std::atomic<uint64_t> mat_count(0);
+
+/**
+ * @brief Replacements for the global operator new and delete that count every allocation
+ */
+void *operator new(std::size_t size) {
+  heap_count.fetch_add(1, std::memory_order_relaxed);
+  void *p = std::malloc(size == 0 ? 1 : size);
+  if(p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](std::size_t size) {
+  return ::operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+/**
+ * @brief Mat allocator that counts allocations and hands them to OpenCV's standard allocator
+ */
+struct counting_mat_allocator : cv::MatAllocator {
+  cv::MatAllocator *std_allocator = cv::Mat::getStdAllocator();
+
+  cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                         cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+    // Headers over data that's already allocated don't count
+    if(data == nullptr) mat_count.fetch_add(1, std::memory_order_relaxed);
+    return std_allocator->allocate(dims, sizes, type, data, step, flags, usage);
+  }
+
+  bool allocate(cv::UMatData *u, cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+    return std_allocator->allocate(u, flags, usage);
+  }
+
+  void deallocate(cv::UMatData *u) const override {
+    std_allocator->deallocate(u);
+  }
+};
+
+/**
+ * @brief Function to start counting cv::Mat allocations. operator new is counted from the start
+ * in any program that links alloc_counter.cpp.
+ */
+void alloc_counter_install() {
+  static counting_mat_allocator allocator;
+  cv::Mat::setDefaultAllocator(&allocator);
+}
+
+/**
+ * @brief Function to read the allocation counts
+ *
+ * @return alloc_counts counts since the program started
+ */
+alloc_counts alloc_counter_read() {
+  alloc_counts counts;
+  counts.heap = heap_count.load(std::memory_order_relaxed);
+  counts.mats = mat_count.load(std::memory_order_relaxed);
+  return counts;
+}
@@ -14,16 +14,32 @@
  * @param patsize size of the pattern
  * @param corner_set vector of the point location of each corner  
  * @param pattern_found bool passed by reference to determine if corners were found. 
+ * @param coarse_width width to find the board at before refining at full resolution, 0 to search at full resolution
  * @return int return non-zero value on failure. 
  */
-int detect_chessboard(const cv::Mat &src, cv::Size patsize, std::vector<cv::Point2f> &corner_set, bool &pattern_found) { 
-  pattern_found = cv::findChessboardCorners(src, patsize, corner_set, cv::CALIB_CB_FAST_CHECK); 
+int detect_chessboard(const cv::Mat &src, cv::Size patsize, std::vector<cv::Point2f> &corner_set, bool &pattern_found, 
+                      int coarse_width) { 
+  luma_pyramid pyr; 
+  luma_pyramid_build(pyr, src); 
+  return detect_chessboard(pyr, patsize, corner_set, pattern_found, coarse_width); 
+} 
 
-  if(pattern_found) {
-    cv::Mat gray; 
-    cv::cvtColor(src, gray, cv::COLOR_RGB2GRAY); 
-    cv::cornerSubPix(gray, corner_set, cv::Size(11, 11), cv::Size(-1, -1), cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.1));
-  }   
+/**
+ * @brief Function to detect and extract chessboard from a frame's shared pyramid, so the frame
+ * isn't converted to grayscale again
+ * 
+ * @param pyr pyramid of the frame
+ * @param patsize size of the pattern
+ * @param corner_set vector of the point location of each corner  
+ * @param pattern_found bool passed by reference to determine if corners were found. 
+ * @param coarse_width width to find the board at before refining at full resolution, 0 to search at full resolution. 
+ * The board is found on one of the pyramid's scale levels if they've already been built. 
+ * @return int return non-zero value on failure. 
+ */
+int detect_chessboard(luma_pyramid &pyr, cv::Size patsize, std::vector<cv::Point2f> &corner_set, bool &pattern_found, 
+                      int coarse_width) { 
+  // Both steps read the same grayscale frame
+  pattern_found = find_chessboard(pyr.gray, patsize, corner_set, coarse_width, chessboard_levels(pyr, coarse_width)); 
   return 0; 
 } 
 
@@ -15,10 +15,43 @@
 #include <opencv2/opencv.hpp>
 #include "../include/csv_util.h"
 #include "../include/ar.h"
+#include "../include/camera_model.h"
+#include "../include/cal_store.h"
 
 int main(int argc, char *argv[]) {
   cv::VideoCapture *capdev;
 
+  // With -c the board is found on a downscaled frame and only refined at full resolution
+  int coarse_width = 0; 
+  // With -t the corners are followed from the last frame and the board is only searched for when that fails
+  bool track = false; 
+  // With -s the board is found by the saddle point detector instead of findChessboardCorners
+  bool use_saddle = false; 
+  // With -u the frame is shown with the lens distortion removed
+  bool rectify = false; 
+  std::string camera_id; // camera the calibration is looked up under, the first video device unless set with -i
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "-c") == 0) {
+      printf("In Coarse to Fine Detection Mode\n"); 
+      coarse_width = CHESSBOARD_COARSE_WIDTH; 
+    } else if(strcmp(argv[i], "-t") == 0) {
+      printf("In Tracking Mode\n"); 
+      track = true; 
+    } else if(strcmp(argv[i], "-s") == 0) {
+      printf("In Saddle Point Detection Mode\n"); 
+      use_saddle = true; 
+    } else if(strcmp(argv[i], "-u") == 0) {
+      printf("In Undistorted Display Mode\n"); 
+      rectify = true; 
+    } else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      camera_id = argv[++i]; 
+    } else {
+      printf("error :: usage : use the flag -c to find the board on a downscaled frame, -t to track its corners between frames, "
+             "-s to find it with the saddle point detector, -u to show the frame undistorted and -i ID to use the calibration stored for camera ID\n"); 
+      exit(-1); 
+    }
+  }
+
   // open the video device
   capdev = new cv::VideoCapture(0);
   if( !capdev->isOpened() ) {
@@ -34,12 +67,14 @@ int main(int argc, char *argv[]) {
   cv::namedWindow("Cal/AR", 1); 
   cv::Mat frame;
   cv::Mat dst; 
+  luma_pyramid pyr; // grayscale frame, converted once per frame
 
   // declare calibration data
   cv::Mat cam_mat(3, 3, CV_64FC1); 
   cv::Mat distcoeff(5, 1, CV_64FC1); 
 
-  read_calibration_data_csv("calibration.csv", cam_mat, distcoeff, 0); 
+  // The calibration for this camera and resolution, from the csv if it isn't in the store
+  load_camera_calibration(CAL_STORE_NAME, "calibration.csv", camera_id.empty() ? camera_identifier(0) : camera_id, refS, cam_mat, distcoeff); 
 
   // Print the camera matrix
   printf("Camera Matrix\n"); 
@@ -59,12 +94,23 @@ int main(int argc, char *argv[]) {
   }
   printf("\n\n"); 
 
+  // The corners are undistorted in one batch so the pose is solved without distortion, and the undistortion
+  // tables for the display are only built once
+  camera_model cam; 
+  camera_model_init(cam, cam_mat, distcoeff); 
+  std::vector<cv::Point2f> undistorted; 
+
   // Declare the size of the pattern
   cv::Size patternsize(9, 6); 
 
   // Flags to display various virtual objects I created. 
   bool show_vo = false;
   bool show_ext = false;  
+
+  board_tracker board; 
+  board_tracker_init(board, patternsize); 
+  saddle_detector saddle; 
+  if(use_saddle) board.saddle = &saddle; 
   
   for(;;) {
     *capdev >> frame; // get a new frame from the camera, treat as a stream
@@ -81,20 +127,36 @@ int main(int argc, char *argv[]) {
     cv::Mat translations; // Translational vector
     std::vector<cv::Point2f> image_points; // Image points to project onto the scene
 
-    detect_chessboard(frame, patternsize, corner_set, patternfound); 
+    luma_pyramid_build(pyr, frame); 
+    bool tracked = false; 
+    if(track) {
+      patternfound = board_tracker_update(board, pyr, cam_mat, distcoeff, coarse_width, corner_set, rotations, translations, tracked); 
+    } else if(use_saddle) {
+      patternfound = find_saddle_board(saddle, pyr.gray, patternsize, corner_set); 
+    } else {
+      detect_chessboard(pyr, patternsize, corner_set, patternfound, coarse_width); 
+    }
 
-    frame.copyTo(dst); 
+    if(rectify) {
+      camera_model_rectify(cam, frame, dst); 
+    } else {
+      frame.copyTo(dst); 
+    }
 
     if(patternfound) {
-      printf("pattern found\n"); 
-      get_point_set(patternsize, point_set); // Get the point set for the panner
-      cv::solvePnP(point_set, corner_set, cam_mat, distcoeff, rotations, translations);
+      printf(tracked ? "pattern tracked\n" : "pattern found\n"); 
+      if(!track) {
+        get_point_set(patternsize, point_set); // Get the point set for the panner
+        camera_model_undistort_points(cam, corner_set, undistorted); 
+        cv::solvePnP(point_set, undistorted, cam.cam_mat, cv::Mat(), rotations, translations);
+      }
 
       std::vector<cv::Vec3f> drawpoints;
       draw_axes(drawpoints, cv::Vec3f(0, 0, 0), 1);
       
       // project the points and get the image points  
-      cv::projectPoints(drawpoints, rotations, translations, cam_mat, distcoeff, image_points);  
+      // The undistorted frame needs no distortion applied to the projection either
+      cv::projectPoints(drawpoints, rotations, translations, cam_mat, rectify ? cv::Mat() : distcoeff, image_points);  
       
     std::vector<cv::Vec3f> point_set;  
       // Draw the lines between the points
@@ -0,0 +1,345 @@
+/**
+ * @file batch_main.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Program to extract the pose of the target in every frame of a recorded video, with chunks of the video on every core
+ * @date 2026-10-17
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <dirent.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <opencv2/opencv.hpp>
+#include "../include/csv_util.h"
+#include "../include/markerless.h"
+#include "../include/model_db.h"
+#include "../include/tracker.h"
+#include "../include/frame_source.h"
+#include "../include/cal_store.h"
+
+#define BATCH_CHUNK_FRAMES 300 // frames in one chunk of work
+#define BATCH_WARMUP_FRAMES 15 // frames before a chunk that are run but not written, so tracking and smoothing have settled
+#define BATCH_MAGIC 0x534f5042 // "BPOS"
+#define BATCH_VERSION 1
+
+/**
+ * @brief Pose of the target in one frame
+ */
+struct pose_row {
+  bool read = false; // the frame could be read
+  int target = -1; // index of the target in the model database, -1 if there's no pose
+  bool tracked = false; // the pose came from optical flow instead of a detection
+  int num_inliers = 0;
+  double rvec[3] = { 0, 0, 0 };
+  double tvec[3] = { 0, 0, 0 };
+  float corners[8] = { 0, 0, 0, 0, 0, 0, 0, 0 }; // x and y of the four corners of the target in the frame
+};
+
+/**
+ * @brief Start of the binary output file, followed by one binary_row per frame
+ */
+struct binary_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_rows;
+  uint32_t reserved;
+};
+
+/**
+ * @brief A pose_row as it's stored in the binary output file
+ */
+struct binary_row {
+  int32_t frame;
+  int32_t target;
+  int32_t num_inliers;
+  int32_t tracked;
+  double rvec[3];
+  double tvec[3];
+  float corners[8];
+};
+
+/**
+ * @brief Settings shared by every chunk
+ */
+struct batch_settings {
+  std::string source_path;
+  cv::Mat cam_mat;
+  cv::Mat dist_coef;
+  bool calibrated = false; // otherwise a pinhole camera is guessed from the frame size
+  bool tracking = false;
+  bool guided = false; // match around the last pose before matching every keypoint
+  int smoothing = POSE_FILTER_DEFAULT_WINDOW;
+  int warmup = BATCH_WARMUP_FRAMES;
+};
+
+/**
+ * @brief Function to find the pose of the target in a range of frames. The chunk starts a few frames
+ * early so the tracker and the pose filter are in the same state they'd be in from a sequential run.
+ *
+ * @param settings settings shared by every chunk
+ * @param db database of targets
+ * @param start first frame to write
+ * @param end one past the last frame to write
+ * @param rows poses of every frame, this chunk only writes its own
+ * @param tail poses of the frames past the end of rows, only the last chunk reads that far
+ * @return int return non-zero value on failure
+ */
+static int run_chunk(const batch_settings &settings, const model_db &db, int start, int end, std::vector<pose_row> &rows,
+                     std::vector<pose_row> &tail) {
+  frame_source src;
+  if(open_frame_source(settings.source_path, src) != 0) return -1;
+  int first = std::max(0, start - settings.warmup);
+  if(seek_frame(src, first) != 0) return -1;
+
+  // Each chunk has its own detector and tracker so nothing is shared between threads
+  cv::Ptr<cv::ORB> orb = cv::ORB::create();
+  planar_tracker tracker;
+  pose_filter_init(tracker.filter, settings.smoothing);
+  tracker.guided = settings.guided;
+  cv::Mat cam_mat = settings.cam_mat.clone();
+  cv::Mat dist_coef = settings.dist_coef.clone();
+
+  cv::Mat frame;
+  luma_pyramid pyr;
+  frame_result result;
+  int index = first;
+  while(index < end && next_frame(src, frame)) {
+    // Files in a directory that aren't images are skipped, so number frames by the path they came from
+    if(src.is_dir) index = (int) src.next - 1;
+    if(index >= end) break;
+
+    if(!settings.calibrated) {
+      cam_mat = (cv::Mat_<double>(3, 3) << frame.cols, 0, frame.cols / 2.0, 0, frame.cols, frame.rows / 2.0, 0, 0, 1);
+      dist_coef = cv::Mat::zeros(5, 1, CV_64FC1);
+    }
+
+    luma_pyramid_build(pyr, frame);
+    result.have_features = false;
+    locate_target(tracker, db, orb, pyr, cam_mat, dist_coef, settings.tracking, result);
+
+    if(index >= start) {
+      // Videos don't always know their length exactly, the last chunk keeps reading past it
+      if(index >= rows.size() && index - rows.size() >= tail.size()) tail.resize(index - rows.size() + 1);
+      pose_row &row = index < rows.size() ? rows[index] : tail[index - rows.size()];
+      row = pose_row();
+      row.read = true;
+      if(result.have_pose && result.scene_corners.size() == 4) {
+        row.target = result.target;
+        row.tracked = result.tracked;
+        row.num_inliers = result.num_inliers;
+        for(int i = 0; i < 3; i++) {
+          row.rvec[i] = result.rotations.at<double>(i);
+          row.tvec[i] = result.translations.at<double>(i);
+        }
+        for(int i = 0; i < 4; i++) {
+          row.corners[2 * i] = result.scene_corners[i].x;
+          row.corners[2 * i + 1] = result.scene_corners[i].y;
+        }
+      }
+    }
+    index++;
+  }
+  return 0;
+}
+
+/**
+ * @brief Function to write the poses as CSV, one line per frame that could be read
+ *
+ * @param filename output file, stdout if empty
+ * @param db database of targets
+ * @param rows poses in frame order
+ * @return int return non-zero value on failure
+ */
+static int write_csv(const std::string &filename, const model_db &db, const std::vector<pose_row> &rows) {
+  FILE *fp = stdout;
+  if(!filename.empty()) {
+    fp = fopen(filename.c_str(), "w");
+    if(!fp) {
+      printf("Unable to open output file %s\n", filename.c_str());
+      return -1;
+    }
+  }
+
+  fprintf(fp, "frame,target,name,tracked,inliers,rx,ry,rz,tx,ty,tz,c0x,c0y,c1x,c1y,c2x,c2y,c3x,c3y\n");
+  for(int f = 0; f < rows.size(); f++) {
+    const pose_row &row = rows[f];
+    if(!row.read) continue;
+    fprintf(fp, "%d,%d,%s,%d,%d", f, row.target, row.target >= 0 ? db.targets[row.target].name.c_str() : "",
+            row.tracked ? 1 : 0, row.num_inliers);
+    for(int i = 0; i < 3; i++) fprintf(fp, ",%.6f", row.rvec[i]);
+    for(int i = 0; i < 3; i++) fprintf(fp, ",%.6f", row.tvec[i]);
+    for(int i = 0; i < 8; i++) fprintf(fp, ",%.3f", row.corners[i]);
+    fprintf(fp, "\n");
+  }
+
+  if(fp != stdout) fclose(fp);
+  return 0;
+}
+
+/**
+ * @brief Function to write the poses as a binary_header followed by one binary_row per frame that could be read
+ *
+ * @param filename output file
+ * @param rows poses in frame order
+ * @return int return non-zero value on failure
+ */
+static int write_binary(const std::string &filename, const std::vector<pose_row> &rows) {
+  FILE *fp = fopen(filename.c_str(), "wb");
+  if(!fp) {
+    printf("Unable to open output file %s\n", filename.c_str());
+    return -1;
+  }
+
+  binary_header header;
+  header.magic = BATCH_MAGIC;
+  header.version = BATCH_VERSION;
+  header.num_rows = 0;
+  header.reserved = 0;
+  for(int f = 0; f < rows.size(); f++) {
+    if(rows[f].read) header.num_rows++;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, fp) == 1;
+
+  for(int f = 0; f < rows.size() && ok; f++) {
+    const pose_row &row = rows[f];
+    if(!row.read) continue;
+    binary_row out;
+    out.frame = f;
+    out.target = row.target;
+    out.num_inliers = row.num_inliers;
+    out.tracked = row.tracked ? 1 : 0;
+    memcpy(out.rvec, row.rvec, sizeof(out.rvec));
+    memcpy(out.tvec, row.tvec, sizeof(out.tvec));
+    memcpy(out.corners, row.corners, sizeof(out.corners));
+    ok = std::fwrite(&out, sizeof(out), 1, fp) == 1;
+  }
+
+  if(fclose(fp) != 0 || !ok) {
+    printf("Unable to write output file %s\n", filename.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  batch_settings settings;
+  std::string model_dir = "./model_images/";
+  std::string out_path;
+  int threads = (int) std::thread::hardware_concurrency();
+  int chunk_frames = BATCH_CHUNK_FRAMES;
+  std::string camera_id; // camera the calibration is looked up under, the first video device unless set with -i
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      model_dir = argv[++i];
+      if(model_dir.back() != '/') model_dir += "/";
+    } else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if(strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      chunk_frames = std::max(1, atoi(argv[++i]));
+    } else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+      settings.warmup = std::max(0, atoi(argv[++i]));
+    } else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      settings.smoothing = atoi(argv[++i]);
+    } else if(strcmp(argv[i], "-t") == 0) {
+      settings.tracking = true;
+    } else if(strcmp(argv[i], "-u") == 0) {
+      settings.guided = true;
+    } else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      camera_id = argv[++i];
+    } else if(argv[i][0] != '-' && settings.source_path.empty()) {
+      settings.source_path = argv[i];
+    } else {
+      printf("error :: usage : %s video_or_image_dir [-m model_dir] [-o out.csv|out.bin] [-j threads] [-c chunk_frames] [-w warmup_frames] [-s N] [-t] [-u] [-i camera_id]\n", argv[0]);
+      exit(-1);
+    }
+  }
+  if(settings.source_path.empty()) {
+    printf("error :: usage : %s video_or_image_dir [-m model_dir] [-o out.csv|out.bin] [-j threads] [-c chunk_frames] [-w warmup_frames] [-s N] [-t] [-u] [-i camera_id]\n", argv[0]);
+    exit(-1);
+  }
+  threads = std::max(1, threads);
+
+  cv::Ptr<cv::ORB> orb = cv::ORB::create();
+  model_db db;
+  if(load_model_db(orb, model_dir, db) != 0) {
+    exit(-1);
+  }
+  const model_db &models = db; // read only from here on, shared by every chunk
+
+  // Split the video into chunks, a video that doesn't know its length is run as one chunk
+  frame_source src;
+  if(open_frame_source(settings.source_path, src) != 0) {
+    printf("Unable to open frame source %s\n", settings.source_path.c_str());
+    exit(-1);
+  }
+  int frames = frame_count(src);
+
+  // The calibration is looked up at the size of the recording, so one made at another resolution is scaled to it
+  cv::Mat first_frame;
+  if(!next_frame(src, first_frame)) {
+    printf("No frames in %s\n", settings.source_path.c_str());
+    exit(-1);
+  }
+  settings.calibrated = load_camera_calibration(CAL_STORE_NAME, "calibration.csv", camera_id.empty() ? camera_identifier(0) : camera_id,
+                                                first_frame.size(), settings.cam_mat, settings.dist_coef) == 0;
+
+  int num_chunks = frames > 0 ? (frames + chunk_frames - 1) / chunk_frames : 1;
+  threads = std::min(threads, num_chunks);
+  std::vector<pose_row> rows(frames);
+  std::vector<pose_row> tail;
+  fprintf(stderr, "%d frames in %d chunks on %d threads\n", frames, num_chunks, threads);
+
+  // The chunks already use every core, so OpenCV shouldn't start threads of its own in each one
+  if(threads > 1) cv::setNumThreads(1);
+
+  double tick_ms = 1000.0 / cv::getTickFrequency();
+  int64 start_tick = cv::getTickCount();
+  std::atomic<int> next_chunk(0);
+  std::atomic<int> done(0);
+  std::atomic<bool> failed(false);
+  std::vector<std::thread> workers;
+  for(int w = 0; w < threads; w++) {
+    workers.push_back(std::thread([&]() {
+      for(int c = next_chunk++; c < num_chunks; c = next_chunk++) {
+        int start = c * chunk_frames;
+        int end = c + 1 < num_chunks ? start + chunk_frames : INT32_MAX;
+        if(run_chunk(settings, models, start, end, rows, tail) != 0) {
+          fprintf(stderr, "Unable to read frames from %d\n", start);
+          failed = true;
+        }
+        fprintf(stderr, "chunk %d of %d done\n", ++done, num_chunks);
+      }
+    }));
+  }
+  for(int w = 0; w < workers.size(); w++) {
+    workers[w].join();
+  }
+  double wall_ms = (cv::getTickCount() - start_tick) * tick_ms;
+  rows.insert(rows.end(), tail.begin(), tail.end());
+
+  int read = 0, posed = 0;
+  for(int f = 0; f < rows.size(); f++) {
+    if(rows[f].read) read++;
+    if(rows[f].target >= 0) posed++;
+  }
+  fprintf(stderr, "%d frames read, %d with a pose, %.1f frames per second\n", read, posed, read * 1000.0 / wall_ms);
+
+  // Chunks write into their own frames, so the rows are already in frame order
+  int status = 0;
+  if(out_path.size() > 4 && out_path.compare(out_path.size() - 4, 4, ".bin") == 0) {
+    status = write_binary(out_path, rows);
+  } else {
+    status = write_csv(out_path, models, rows);
+  }
+
+  return status != 0 || failed ? -1 : 0;
+}
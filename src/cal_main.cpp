@@ -15,6 +15,198 @@
 #include <opencv2/opencv.hpp>
 #include "../include/calibration.h"
 #include "../include/csv_util.h"
+#include "../include/cal_worker.h"
+#include "../include/frame_source.h"
+#include "../include/cal_store.h"
+
+/**
+ * @brief Function to get the 3d position of every corner of the pattern, one unit apart on the z = 0 plane
+ * 
+ * @param patsize size of the pattern
+ * @param point_set output points, in the order findChessboardCorners finds the corners
+ */
+static void pattern_points(cv::Size patsize, std::vector<cv::Vec3f> &point_set) {
+  point_set.clear(); 
+  for(int i = 0; i < patsize.height; i++) {
+    for(int j = 0; j < patsize.width; j++) {
+      point_set.push_back( cv::Vec3f(j, -i, 0) );  
+    }
+  }
+}
+
+/**
+ * @brief Function to save a calibration to the binary store under the camera and resolution it's for
+ * 
+ * @param camera_id identifier of the camera
+ * @param image_size size of the calibration images
+ * @param cam_mat camera matrix
+ * @param distcoeff distortion coefficients
+ * @param proj_error reprojection error of the calibration
+ * @return int return non-zero value on failure
+ */
+static int store_calibration(const std::string &camera_id, cv::Size image_size, const cv::Mat &cam_mat, const cv::Mat &distcoeff, 
+                             double proj_error) {
+  cal_profile profile; 
+  profile.camera_id = camera_id; 
+  profile.resolution = image_size; 
+  profile.cam_mat = cam_mat; 
+  profile.dist_coeffs = distcoeff; 
+  profile.proj_error = proj_error; 
+  if(save_cal_profile(CAL_STORE_NAME, profile) != 0) return -1; 
+  printf("Stored as %s at %dx%d in %s\n", camera_id.c_str(), image_size.width, image_size.height, CAL_STORE_NAME); 
+  return 0; 
+}
+
+/**
+ * @brief Function to calibrate from a directory of chessboard images without a camera or a window. 
+ * The corners of every image are found in parallel, then the camera is calibrated once on all of them. 
+ * 
+ * @param dir directory of images
+ * @param patsize size of the pattern
+ * @param cal_fn csv file the calibration is written to
+ * @param coarse_width width to find the board at before refining at full resolution, 0 to search at full resolution
+ * @param use_saddle find the board with the saddle point detector instead of findChessboardCorners
+ * @param camera_id identifier of the camera the images are from, for the calibration store
+ * @return int return non-zero value on failure
+ */
+static int calibrate_dir(const std::string &dir, cv::Size patsize, char *cal_fn, int coarse_width, bool use_saddle, 
+                         const std::string &camera_id) {
+  frame_source src; 
+  if(open_frame_source(dir, src) != 0 || !src.is_dir) {
+    printf("Unable to read images from %s\n", dir.c_str()); 
+    return -1; 
+  }
+
+  // Every image is independent, so spread them over the cores. Files that aren't images are skipped.
+  int64 start = cv::getTickCount(); 
+  int n = (int) src.paths.size(); 
+  std::vector<std::vector<cv::Point2f> > corners(n); 
+  std::vector<cv::Size> sizes(n); 
+  std::vector<uchar> found(n, 0); 
+  cv::parallel_for_(cv::Range(0, n), [&](const cv::Range &range) {
+    cv::Mat none; 
+    saddle_detector saddle; // one per thread
+    for(int i = range.start; i < range.end; i++) {
+      cv::Mat img = cv::imread(src.paths[i], cv::IMREAD_GRAYSCALE); 
+      if(img.empty()) continue; 
+      sizes[i] = img.size(); 
+      bool pattern_found = false; 
+      det_ext_corners(img, none, patsize, corners[i], pattern_found, coarse_width, use_saddle ? &saddle : nullptr); 
+      found[i] = pattern_found && corners[i].size() == patsize.area(); 
+    }
+  }); 
+  double detect_s = (cv::getTickCount() - start) / cv::getTickFrequency(); 
+
+  // Only views the same size as the first one can go into the same calibration
+  std::vector<cv::Vec3f> point_set; 
+  pattern_points(patsize, point_set); 
+  std::vector<std::vector<cv::Vec3f> > point_list; 
+  std::vector<std::vector<cv::Point2f> > corner_list; 
+  cv::Size image_size; 
+  int images = 0; 
+  for(int i = 0; i < n; i++) {
+    if(sizes[i].area() > 0) images++; 
+    if(!found[i]) continue; 
+    if(image_size.area() == 0) image_size = sizes[i]; 
+    if(sizes[i] != image_size) {
+      printf("Skipping %s, it isn't %dx%d\n", src.paths[i].c_str(), image_size.width, image_size.height); 
+      continue; 
+    }
+    point_list.push_back(point_set); 
+    corner_list.push_back(corners[i]); 
+  }
+  printf("Found the pattern in %d of %d images in %.2f s\n", (int) corner_list.size(), images, detect_s); 
+  if(corner_list.size() < CAL_WORKER_MIN_VIEWS) {
+    printf("Not enough images to calibrate\n"); 
+    return -1; 
+  }
+
+  start = cv::getTickCount(); 
+  cv::Mat cam_mat = cv::Mat::eye(3, 3, CV_64FC1); 
+  cv::Mat distcoeff = cv::Mat::zeros(5, 1, CV_64FC1); 
+  cv::Mat rotations; 
+  cv::Mat translations; 
+  double proj_error = cv::calibrateCamera(point_list, corner_list, image_size, cam_mat, distcoeff, rotations, translations, cv::CALIB_FIX_ASPECT_RATIO); 
+  printf("Calibrated on %d views in %.2f s, PROJECTION ERROR: %.4f\n", (int) corner_list.size(), 
+          (cv::getTickCount() - start) / cv::getTickFrequency(), proj_error); 
+
+  printf("Camera Matrix:\n"); 
+  for(int i = 0; i < cam_mat.rows; i++) {
+    for(int j = 0; j < cam_mat.cols; j++) {
+      printf("%.4f ", cam_mat.at<double>(i, j)); 
+    }
+    printf("\n"); 
+  }
+  printf("Distortion Coefficients (%d)\n", distcoeff.rows); 
+  for(int i = 0; i < distcoeff.rows; i++){
+    printf("%.4f ", distcoeff.at<double>(i, 0));
+  }
+  printf("\n"); 
+
+  if(append_calibration_data_csv(cal_fn, cam_mat, distcoeff, 1) != 0) {
+    printf("Unable to write %s\n", cal_fn); 
+    return -1; 
+  }
+  printf("Written to %s\n", cal_fn); 
+  return store_calibration(camera_id, image_size, cam_mat, distcoeff, proj_error); 
+}
+
+/**
+ * @brief Function to print the outcome of a calibration run
+ * 
+ * @param before camera matrix before the run
+ * @param result result of the run
+ */
+static void print_calibration(const cv::Mat &before, const cal_result &result) {
+  printf("Calibration run %d on %d views took %.2f s%s\n\n", result.run, result.views, result.seconds, 
+          result.warm_started ? ", started from the last run" : ""); 
+
+  printf("Camera Matrix (before):\n"); 
+  for(int i = 0; i < before.rows; i++) {
+    for(int j = 0; j < before.cols; j++) {
+      printf("%.4f ", before.at<double>(i, j)); 
+    }
+    printf("\n"); 
+  }
+  printf("\n"); 
+
+  // print camera matrix
+  printf("Camera Matrix (after):\n"); 
+  for(int i = 0; i < result.cam_mat.rows; i++) {
+    for(int j = 0; j < result.cam_mat.cols; j++) {
+      printf("%.4f ", result.cam_mat.at<double>(i, j)); 
+    }
+    printf("\n"); 
+  }
+  printf("\n"); 
+
+  printf("PROJECTION ERROR: %.4f\n\n", result.proj_error); 
+
+  // print distortion coefficients
+  printf("Distortion Coefficients (%d)\n", result.dist_coeffs.rows); 
+  for(int i = 0; i < result.dist_coeffs.rows; i++){
+    printf("%.4f ", result.dist_coeffs.at<double>(i, 0));
+  }
+  printf("\n");
+
+  printf("Rotations:\n"); 
+  for(int i = 0; i < result.rotations.rows; i++) {
+    for(int j = 0; j < result.rotations.cols; j++){
+      printf("%d: %.4f ", i, result.rotations.at<double>(i, j)); 
+    }
+    printf("\n"); 
+  }
+  printf("\n\n"); 
+
+  printf("Translations:\n"); 
+  for(int i = 0; i < result.translations.rows; i++) {
+    for(int j = 0; j < result.translations.cols; j++){
+      printf("%d: %.4f ", i, result.translations.at<double>(i, j)); 
+    }
+    printf("\n"); 
+  }
+  printf("\n\n"); 
+}
 
 int main(int argc, char *argv[]) {
   cv::VideoCapture *capdev;
@@ -22,6 +214,37 @@ int main(int argc, char *argv[]) {
   char cal_fn[256] = "calibration.csv"; 
   char rot_fn[256] = "rots.csv"; 
   char tran_fn[256] = "trans.csv"; 
+  cv::Size patternsize(9, 6); 
+
+  // With -d the images of a directory are calibrated without a camera
+  std::string image_dir; 
+  int threads = -1; 
+  int coarse_width = 0; // find the board on a downscaled image in -c mode
+  bool use_saddle = false; // find the board with the saddle point detector in -s mode
+  std::string camera_id; // camera the calibration is stored under, the first video device's name unless set with -i
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      image_dir = argv[++i]; 
+    } else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      snprintf(cal_fn, sizeof(cal_fn), "%s", argv[++i]); 
+    } else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]); 
+    } else if(strcmp(argv[i], "-c") == 0) {
+      coarse_width = CHESSBOARD_COARSE_WIDTH; 
+    } else if(strcmp(argv[i], "-s") == 0) {
+      use_saddle = true; 
+    } else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      camera_id = argv[++i]; 
+    } else {
+      printf("error :: usage : %s [-d image_dir] [-o calibration.csv] [-j threads] [-c] [-s] [-i camera_id]\n", argv[0]); 
+      exit(-1); 
+    }
+  }
+  if(camera_id.empty()) camera_id = camera_identifier(0); 
+  if(!image_dir.empty()) {
+    if(threads > 0) cv::setNumThreads(threads); 
+    return calibrate_dir(image_dir, patternsize, cal_fn, coarse_width, use_saddle, camera_id) == 0 ? 0 : -1; 
+  }
 
   // open the video device
   capdev = new cv::VideoCapture(0);
@@ -38,10 +261,6 @@ int main(int argc, char *argv[]) {
   cv::namedWindow("Cal/AR", 1); 
   cv::Mat frame;
 
-  // init point_list and corner_list
-  std::vector<std::vector<cv::Vec3f> > point_list; 
-  std::vector<std::vector<cv::Point2f> > corner_list;  
-  cv::Size patternsize(9, 6); 
 
   // Init various things that go into the Calibrate Camera function
   cv::Mat rotations; 
@@ -51,7 +270,13 @@ int main(int argc, char *argv[]) {
   cam_mat.at<double>(1, 0) = 0.0; cam_mat.at<double>(1, 1) = 1.0; cam_mat.at<double>(1, 2) = (double) frame.rows / 2.0; 
   cam_mat.at<double>(2, 0) = 0.0; cam_mat.at<double>(2, 1) = 0.0; cam_mat.at<double>(2, 2) = 1.0; 
   cv::Mat distcoeff = cv::Mat::zeros(5, 1, CV_64FC1); 
-  uchar cal_img_cntr = 0; 
+  int cal_img_cntr = 0; 
+
+  // Calibration runs in the background, again every time a view is added, so capture never waits for it. 
+  // The worker keeps every view, it's started once the first frame gives the image size.
+  cal_worker worker; 
+  cal_result cal; 
+  saddle_detector saddle; 
   
   for(;;) {
     *capdev >> frame; // get a new frame from the camera, treat as a stream
@@ -59,6 +284,7 @@ int main(int argc, char *argv[]) {
       printf("frame is empty\n");
       break;
     }                 
+    if(!worker.thread.joinable()) cal_worker_start(worker, frame.size(), cv::CALIB_FIX_ASPECT_RATIO); 
     std::string cal_img_path = "./cal_imgs/"; 
     cv::Mat dst; 
     frame.copyTo(dst); 
@@ -67,7 +293,23 @@ int main(int argc, char *argv[]) {
     std::vector<cv::Vec3f> point_set; 
     bool cornersfound = false;
 
-    det_ext_corners(frame, dst, patternsize, corner_set, cornersfound);
+    det_ext_corners(frame, dst, patternsize, corner_set, cornersfound, coarse_width, use_saddle ? &saddle : nullptr);
+
+    // Pick up a run that finished since the last frame
+    if(cal_worker_poll(worker, cal)) {
+      print_calibration(cam_mat, cal); 
+      cal.cam_mat.copyTo(cam_mat); 
+      cal.dist_coeffs.copyTo(distcoeff); 
+      cal.rotations.copyTo(rotations); 
+      cal.translations.copyTo(translations); 
+    }
+
+    // Show how the calibration is going
+    int running = worker.running_views; 
+    std::string status = std::to_string(cal_worker_views(worker)) + " views"; 
+    if(running > 0) status += ", calibrating on " + std::to_string(running); 
+    else if(cal.run > 0) status += ", error " + std::to_string(cal.proj_error).substr(0, 5) + " px from " + std::to_string(cal.views); 
+    cv::putText(dst, status, cv::Point(10, 25), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 255, 0), 2); 
 
     cv::imshow("Cal/AR", dst);
 
@@ -86,94 +328,35 @@ int main(int argc, char *argv[]) {
       }
       printf("\n\n"); 
       
-      // add last corners to corner_list
-      corner_list.push_back( std::vector<cv::Point2f>( corner_set )); 
-      
-      // generate a list of 3d points and add to point_list
-      for(int i = 0; i < patternsize.height; i++) {
-        for(int j = 0; j < patternsize.width; j++) {
-          cv::Vec3f point3d; 
-          point3d[0] = j; 
-          point3d[1] = -i; 
-          point3d[2] = 0;
-          point_set.push_back( point3d );  
-        }
-      }
+      // generate a list of 3d points
+      pattern_points(patternsize, point_set); 
       
       if(point_set.size() != corner_set.size()) {
         printf("point_set and corner_set not equal\n"); 
         continue; 
       }
-      point_list.push_back(std::vector<cv::Vec3f>(point_set));
+      cal_worker_add_view(worker, point_set, corner_set, true); 
 
-      // save image 
+      // save the frame without the corners and status drawn on it, so it can be calibrated from again with -d
       std::string name = "cal_img" + std::to_string(cal_img_cntr) + ".png"; 
       std::string fullpath = cal_img_path + name;
-      cv::imwrite(fullpath, dst);
+      cv::imwrite(fullpath, frame);
       cal_img_cntr++;  
 
     } else if (keyEx == 'c') {
 
-      if(cal_img_cntr < 5) {
+      // The worker already calibrates when views are added, this runs it again now
+      if(cal_worker_request(worker) != 0) {
         printf("Not enough images to calibrate\n"); 
         continue; 
       }
-      
-      printf("Calibrating camera...\n"); 
-
-      printf("Camera Matrix (before):\n"); 
-      for(int i = 0; i < cam_mat.rows; i++) {
-        for(int j = 0; j < cam_mat.cols; j++) {
-          printf("%.4f ", cam_mat.at<double>(i, j)); 
-        }
-        printf("\n"); 
-      }
-      printf("\n"); 
-
-      // Calibrate
-      double proj_error = cv::calibrateCamera(point_list, corner_list, frame.size(), cam_mat, distcoeff, rotations, translations, cv::CALIB_FIX_ASPECT_RATIO);  
-      
-      // print camera matrix
-      printf("Camera Matrix (after):\n"); 
-      for(int i = 0; i < cam_mat.rows; i++) {
-        for(int j = 0; j < cam_mat.cols; j++) {
-          printf("%.4f ", cam_mat.at<double>(i, j)); 
-        }
-        printf("\n"); 
-      }
-      printf("\n"); 
-
-      printf("PROJECTION ERROR: %.4f\n\n", proj_error); 
-
-      // print distortion coefficients
-      printf("Distortion Coefficients (%d)\n", distcoeff.rows); 
-      for(int i = 0; i < distcoeff.rows; i++){
-        printf("%.4f ", distcoeff.at<double>(i, 0));
-      }
-      printf("\n");
-
-      printf("Rotations:\n"); 
-      for(int i = 0; i < rotations.rows; i++) {
-        for(int j = 0; j < rotations.cols; j++){
-          printf("%d: %.4f ", i, rotations.at<double>(i, j)); 
-        }
-        printf("\n"); 
-      }
-      printf("\n\n"); 
-
-      printf("Translations:\n"); 
-      for(int i = 0; i < translations.rows; i++) {
-        for(int j = 0; j < translations.cols; j++){
-          printf("%d: %.4f ", i, translations.at<double>(i, j)); 
-        }
-        printf("\n"); 
-      }
-      printf("\n\n"); 
+      printf("Calibrating camera in the background...\n");  
 
     } else if(keyEx == 'w') {
       printf("Writing to csv...\n"); 
       append_calibration_data_csv(cal_fn, cam_mat, distcoeff, 1);
       printf("Written to csv\n");  
+      if(cal.run > 0) store_calibration(camera_id, frame.size(), cam_mat, distcoeff, cal.proj_error); 
     } else if(keyEx == 'i') {
       int num = -1; 
       printf("Enter the number for the image id\n"); 
@@ -183,6 +366,7 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  cal_worker_stop(worker); 
   printf("Bye!\n"); 
 
   delete capdev;
@@ -0,0 +1,336 @@
+/**
+ * @file cal_store.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Binary store of camera calibrations keyed by camera and resolution, memory-mapped so startup doesn't parse text
+ * @date 2026-10-17
+ */
+
+#include <cmath>
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/cal_store.h"
+#include "../include/csv_util.h"
+
+/**
+ * @brief Start of the store file. It's followed by the records.
+ */
+struct store_header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t file_size; // size of the whole file, to catch a truncated one
+  uint32_t num_records;
+  uint32_t record_size; // bytes in one record, to catch a file written with another layout
+};
+
+/**
+ * @brief One calibration as it's stored in the file
+ */
+struct store_record {
+  char camera_id[CAL_STORE_ID_LEN]; // zero padded
+  int32_t width;
+  int32_t height;
+  double cam_mat[9]; // row major
+  int32_t num_dist;
+  int32_t reserved;
+  double dist_coeffs[CAL_STORE_MAX_DIST];
+  double proj_error;
+  int64_t created;
+};
+
+/**
+ * @brief Function to get the key of a camera at a resolution
+ *
+ * @param camera_id identifier of the camera
+ * @param width width of the frames
+ * @param height height of the frames
+ * @return std::string key into the store's index
+ */
+static std::string profile_key(const std::string &camera_id, int width, int height) {
+  return camera_id + "@" + std::to_string(width) + "x" + std::to_string(height);
+}
+
+/**
+ * @brief Function to get a profile from its record
+ *
+ * @param rec record in the file
+ * @param profile output profile, copied out of the mapping
+ */
+static void read_record(const store_record &rec, cal_profile &profile) {
+  profile.camera_id = std::string(rec.camera_id, strnlen(rec.camera_id, CAL_STORE_ID_LEN));
+  profile.resolution = cv::Size(rec.width, rec.height);
+  profile.cam_mat = cv::Mat(3, 3, CV_64FC1, (void *) rec.cam_mat).clone();
+  profile.dist_coeffs = cv::Mat(rec.num_dist, 1, CV_64FC1, (void *) rec.dist_coeffs).clone();
+  profile.proj_error = rec.proj_error;
+  profile.created = rec.created;
+}
+
+/**
+ * @brief Function to read the first line of a small sysfs file
+ *
+ * @param path file to read
+ * @param value output line without its trailing whitespace
+ * @return bool true if the file had a non-empty line
+ */
+static bool read_sysfs_line(const std::string &path, std::string &value) {
+  FILE *fp = fopen(path.c_str(), "r");
+  if(!fp) return false;
+  char line[CAL_STORE_ID_LEN];
+  bool ok = fgets(line, sizeof(line), fp) != nullptr;
+  fclose(fp);
+  if(!ok) return false;
+  value = line;
+  while(!value.empty() && (value.back() == '\n' || value.back() == ' ')) value.pop_back();
+  return !value.empty();
+}
+
+/**
+ * @brief Function to get an identifier for a video device that stays the same when other cameras are plugged in.
+ * USB cameras are told apart by their serial number, or by the port they're plugged into when they don't report
+ * one, so two cameras of the same model keep their own calibration. The device's name from video4linux is
+ * only used alone when there's nothing more specific.
+ *
+ * @param index index of the device as VideoCapture opens it
+ * @return std::string identifier of the camera
+ */
+std::string camera_identifier(int index) {
+  std::string dev = "/sys/class/video4linux/video" + std::to_string(index);
+  std::string name;
+  if(!read_sysfs_line(dev + "/name", name)) return "camera" + std::to_string(index);
+
+  // device is the USB interface, the USB device with the serial and port is its parent
+  std::string id = name;
+  char real[PATH_MAX];
+  if(realpath((dev + "/device").c_str(), real) != nullptr) {
+    std::string usb(real);
+    usb = usb.substr(0, usb.find_last_of('/'));
+    std::string serial, vendor, product;
+    if(read_sysfs_line(usb + "/idVendor", vendor) && read_sysfs_line(usb + "/idProduct", product)) {
+      if(!read_sysfs_line(usb + "/serial", serial)) {
+        serial = "usb-" + usb.substr(usb.find_last_of('/') + 1); // bus and port path, e.g. 1-2.3
+      }
+      id = name + " " + vendor + ":" + product + "-" + serial;
+    }
+  }
+  if(id.size() >= CAL_STORE_ID_LEN) id = id.substr(id.size() - (CAL_STORE_ID_LEN - 1)); // the unit specific part is at the end
+  return id;
+}
+
+/**
+ * @brief Function to map a store file written by save_cal_profile
+ *
+ * @param filename store file
+ * @param store output store
+ * @return int return non-zero value if the file is missing or corrupt
+ */
+int open_cal_store(const std::string &filename, cal_store &store) {
+  store = cal_store();
+  int fd = open(filename.c_str(), O_RDONLY);
+  if(fd < 0) return -1;
+
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(store_header)) {
+    close(fd);
+    return -1;
+  }
+
+  size_t size = (size_t) st.st_size;
+  void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(addr == MAP_FAILED) return -1;
+  store.mapping = std::shared_ptr<void>(addr, [size](void *p) { munmap(p, size); });
+  store.data = (const uchar *) addr;
+  store.size = size;
+
+  const store_header *header = (const store_header *) store.data;
+  if(header->magic != CAL_STORE_MAGIC || header->version != CAL_STORE_VERSION || header->file_size != size ||
+     header->record_size != sizeof(store_record) ||
+     sizeof(store_header) + (uint64_t) header->num_records * sizeof(store_record) > size) {
+    printf("Calibration store %s is corrupt or from another version\n", filename.c_str());
+    store = cal_store();
+    return -1;
+  }
+
+  // Index the records, a later record for the same camera and resolution wins
+  const store_record *records = (const store_record *) (store.data + sizeof(store_header));
+  for(int i = 0; i < header->num_records; i++) {
+    const store_record &rec = records[i];
+    if(rec.num_dist < 0 || rec.num_dist > CAL_STORE_MAX_DIST || rec.width <= 0 || rec.height <= 0) continue;
+    std::string id(rec.camera_id, strnlen(rec.camera_id, CAL_STORE_ID_LEN));
+    store.entries[profile_key(id, rec.width, rec.height)] = i;
+    store.cameras[id].push_back(i);
+  }
+  return 0;
+}
+
+/**
+ * @brief Function to scale a calibration to another resolution of the same camera. The focal lengths and
+ * principal point follow the image, the distortion coefficients work on normalized points and don't change.
+ *
+ * @param src calibration
+ * @param resolution size of the frames it'll be used on
+ * @param dst output calibration at the resolution, can be src
+ */
+void scale_cal_profile(const cal_profile &src, cv::Size resolution, cal_profile &dst) {
+  double sx = (double) resolution.width / src.resolution.width;
+  double sy = (double) resolution.height / src.resolution.height;
+  cv::Mat cam_mat = src.cam_mat.clone();
+  cam_mat.at<double>(0, 0) *= sx;
+  cam_mat.at<double>(0, 1) *= sx;
+  cam_mat.at<double>(1, 1) *= sy;
+  // Pixel centers, not edges, are what scale
+  cam_mat.at<double>(0, 2) = (cam_mat.at<double>(0, 2) + 0.5) * sx - 0.5;
+  cam_mat.at<double>(1, 2) = (cam_mat.at<double>(1, 2) + 0.5) * sy - 0.5;
+
+  if(&dst != &src) {
+    dst.camera_id = src.camera_id;
+    dst.dist_coeffs = src.dist_coeffs.clone();
+    dst.proj_error = src.proj_error;
+    dst.created = src.created;
+  }
+  dst.proj_error *= std::sqrt(sx * sy); // in pixels of the new resolution
+  dst.cam_mat = cam_mat;
+  dst.resolution = resolution;
+}
+
+/**
+ * @brief Function to get the calibration of a camera at a resolution. A profile saved at that resolution is used
+ * as it is, otherwise the largest one with the same aspect ratio is scaled to it.
+ *
+ * @param store mapped store
+ * @param camera_id identifier of the camera
+ * @param resolution size of the frames it'll be used on
+ * @param profile output profile at the resolution
+ * @return bool true if the camera has a profile that fits
+ */
+bool find_cal_profile(const cal_store &store, const std::string &camera_id, cv::Size resolution, cal_profile &profile) {
+  if(store.data == nullptr || resolution.area() <= 0) return false;
+  const store_record *records = (const store_record *) (store.data + sizeof(store_header));
+
+  auto it = store.entries.find(profile_key(camera_id, resolution.width, resolution.height));
+  if(it != store.entries.end()) {
+    read_record(records[it->second], profile);
+    return true;
+  }
+
+  // Scaling down loses less than scaling up, and a different aspect ratio means the sensor is cropped differently
+  auto cam = store.cameras.find(camera_id);
+  if(cam == store.cameras.end()) return false;
+  double aspect = (double) resolution.width / resolution.height;
+  int best = -1;
+  for(int i = 0; i < cam->second.size(); i++) {
+    const store_record &rec = records[cam->second[i]];
+    if(std::fabs((double) rec.width / rec.height - aspect) > CAL_STORE_ASPECT_TOL * aspect) continue;
+    if(best < 0 || rec.width > records[best].width) best = cam->second[i];
+  }
+  if(best < 0) return false;
+
+  read_record(records[best], profile);
+  printf("Scaling the calibration of %s from %dx%d to %dx%d\n", camera_id.c_str(), profile.resolution.width,
+          profile.resolution.height, resolution.width, resolution.height);
+  scale_cal_profile(profile, resolution, profile);
+  return true;
+}
+
+/**
+ * @brief Function to add a calibration to the store file, replacing the camera's profile at the same resolution.
+ * The file is written next to the old one and renamed over it, so processes that mapped the old one keep working.
+ *
+ * @param filename store file, created if it doesn't exist
+ * @param profile calibration to save
+ * @return int return non-zero value on failure
+ */
+int save_cal_profile(const std::string &filename, const cal_profile &profile) {
+  if(profile.camera_id.empty() || profile.camera_id.size() >= CAL_STORE_ID_LEN || profile.resolution.area() <= 0 ||
+     profile.cam_mat.rows != 3 || profile.cam_mat.cols != 3 || profile.dist_coeffs.total() > CAL_STORE_MAX_DIST) {
+    printf("Unable to store the calibration of %s\n", profile.camera_id.c_str());
+    return -1;
+  }
+
+  store_record rec;
+  memset(&rec, 0, sizeof(rec));
+  memcpy(rec.camera_id, profile.camera_id.data(), profile.camera_id.size());
+  rec.width = profile.resolution.width;
+  rec.height = profile.resolution.height;
+  cv::Mat cam_mat, dist;
+  profile.cam_mat.convertTo(cam_mat, CV_64F);
+  profile.dist_coeffs.reshape(1, (int) profile.dist_coeffs.total()).convertTo(dist, CV_64F);
+  for(int i = 0; i < 9; i++) rec.cam_mat[i] = cam_mat.at<double>(i / 3, i % 3);
+  rec.num_dist = dist.rows;
+  for(int i = 0; i < dist.rows; i++) rec.dist_coeffs[i] = dist.at<double>(i, 0);
+  rec.proj_error = profile.proj_error;
+  rec.created = profile.created != 0 ? profile.created : (int64_t) time(nullptr);
+
+  // Keep every other profile, only the latest one of each camera and resolution
+  std::vector<store_record> records;
+  cal_store old;
+  if(open_cal_store(filename, old) == 0) {
+    const store_record *old_records = (const store_record *) (old.data + sizeof(store_header));
+    for(auto it = old.entries.begin(); it != old.entries.end(); it++) {
+      if(it->first != profile_key(profile.camera_id, rec.width, rec.height)) records.push_back(old_records[it->second]);
+    }
+  }
+  records.push_back(rec);
+
+  store_header header;
+  memset(&header, 0, sizeof(header));
+  header.magic = CAL_STORE_MAGIC;
+  header.version = CAL_STORE_VERSION;
+  header.num_records = (uint32_t) records.size();
+  header.record_size = sizeof(store_record);
+  header.file_size = sizeof(store_header) + records.size() * sizeof(store_record);
+
+  std::string tmp_name = filename + ".tmp." + std::to_string((long) getpid());
+  FILE *fp = fopen(tmp_name.c_str(), "wb");
+  if(!fp) {
+    printf("Unable to open output file %s\n", tmp_name.c_str());
+    return -1;
+  }
+  std::fwrite(&header, sizeof(header), 1, fp);
+  std::fwrite(records.data(), sizeof(store_record), records.size(), fp);
+
+  bool ok = std::ferror(fp) == 0;
+  ok = fclose(fp) == 0 && ok;
+  if(!ok || rename(tmp_name.c_str(), filename.c_str()) != 0) {
+    printf("Unable to write calibration store %s\n", filename.c_str());
+    unlink(tmp_name.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Function to load the calibration of a camera at a resolution from the store, falling back to the
+ * csv file written by append_calibration_data_csv for cameras that aren't in it
+ *
+ * @param store_fn store file
+ * @param csv_fn csv file to fall back to
+ * @param camera_id identifier of the camera
+ * @param resolution size of the frames it'll be used on
+ * @param cam_mat output camera matrix
+ * @param dist_coeffs output distortion coefficients
+ * @return int return non-zero value if neither has a calibration
+ */
+int load_camera_calibration(const std::string &store_fn, const char *csv_fn, const std::string &camera_id, cv::Size resolution,
+                            cv::Mat &cam_mat, cv::Mat &dist_coeffs) {
+  cal_store store;
+  cal_profile profile;
+  if(open_cal_store(store_fn, store) == 0 && find_cal_profile(store, camera_id, resolution, profile)) {
+    printf("Calibration of %s at %dx%d from %s\n", camera_id.c_str(), resolution.width, resolution.height, store_fn.c_str());
+    cam_mat = profile.cam_mat;
+    dist_coeffs = profile.dist_coeffs;
+    return 0;
+  }
+
+  // The csv doesn't say which camera or resolution it's for, so it's used as it is
+  printf("No calibration of %s at %dx%d in %s, reading %s\n", camera_id.c_str(), resolution.width, resolution.height,
+          store_fn.c_str(), csv_fn);
+  char fn[256]; // read_calibration_data_csv takes a mutable name
+  snprintf(fn, sizeof(fn), "%s", csv_fn);
+  cam_mat.create(3, 3, CV_64FC1);
+  dist_coeffs.create(5, 1, CV_64FC1);
+  return read_calibration_data_csv(fn, cam_mat, dist_coeffs, 0);
+}
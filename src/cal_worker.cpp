@@ -0,0 +1,144 @@
+/**
+ * @file cal_worker.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Runs the camera calibration on a background thread, warm-started from the previous run
+ * @date 2026-10-17
+ */
+
+#include "../include/cal_worker.h"
+
+/**
+ * @brief Function the worker thread runs, calibrating whenever a run is requested
+ *
+ * @param worker worker
+ */
+static void cal_worker_loop(cal_worker &worker) {
+  std::vector<std::vector<cv::Vec3f> > point_list;
+  std::vector<std::vector<cv::Point2f> > corner_list;
+  for(;;) {
+    cal_result run;
+    int flags;
+    {
+      std::unique_lock<std::mutex> lock(worker.mutex);
+      worker.wake.wait(lock, [&]() { return worker.stop || worker.requested; });
+      if(worker.stop) return;
+      worker.requested = false;
+
+      // Copy the views so capture can keep adding them while this runs
+      point_list = worker.point_list;
+      corner_list = worker.corner_list;
+      flags = worker.flags;
+      run.run = worker.result.run + 1;
+      if(worker.result.run > 0) {
+        worker.result.cam_mat.copyTo(run.cam_mat);
+        worker.result.dist_coeffs.copyTo(run.dist_coeffs);
+        flags |= cv::CALIB_USE_INTRINSIC_GUESS;
+        run.warm_started = true;
+      } else {
+        // Only the aspect ratio is read without an intrinsic guess
+        run.cam_mat = cv::Mat::eye(3, 3, CV_64FC1);
+        run.dist_coeffs = cv::Mat::zeros(5, 1, CV_64FC1);
+      }
+    }
+
+    run.views = (int) point_list.size();
+    worker.running_views = run.views;
+    int64 start = cv::getTickCount();
+    run.proj_error = cv::calibrateCamera(point_list, corner_list, worker.image_size, run.cam_mat, run.dist_coeffs,
+                                         run.rotations, run.translations, flags);
+    run.seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+    worker.running_views = 0;
+
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.result = run;
+    worker.have_result = true;
+  }
+}
+
+/**
+ * @brief Function to start the worker thread
+ *
+ * @param worker worker to start
+ * @param image_size size of the calibration images
+ * @param flags calibrateCamera flags
+ */
+void cal_worker_start(cal_worker &worker, cv::Size image_size, int flags) {
+  worker.image_size = image_size;
+  worker.flags = flags;
+  worker.stop = false;
+  worker.thread = std::thread(cal_worker_loop, std::ref(worker));
+}
+
+/**
+ * @brief Function to add a view of the pattern
+ *
+ * @param worker worker
+ * @param point_set 3d position of each corner on the pattern
+ * @param corner_set corners found in the image
+ * @param calibrate also ask for a run with every view so far, once there are enough of them
+ */
+void cal_worker_add_view(cal_worker &worker, const std::vector<cv::Vec3f> &point_set, const std::vector<cv::Point2f> &corner_set,
+                         bool calibrate) {
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  worker.point_list.push_back(point_set);
+  worker.corner_list.push_back(corner_set);
+  if(calibrate && worker.point_list.size() >= CAL_WORKER_MIN_VIEWS) {
+    worker.requested = true;
+    worker.wake.notify_one();
+  }
+}
+
+/**
+ * @brief Function to ask for a run with every view added so far. If a run is in progress the new one
+ * starts when it's done.
+ *
+ * @param worker worker
+ * @return int return non-zero value if there aren't enough views yet
+ */
+int cal_worker_request(cal_worker &worker) {
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  if(worker.point_list.size() < CAL_WORKER_MIN_VIEWS) return -1;
+  worker.requested = true;
+  worker.wake.notify_one();
+  return 0;
+}
+
+/**
+ * @brief Function to get the result of a run that finished since the last call, without waiting
+ *
+ * @param worker worker
+ * @param result output result
+ * @return bool true if there's a new result
+ */
+bool cal_worker_poll(cal_worker &worker, cal_result &result) {
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  if(!worker.have_result) return false;
+  result = worker.result;
+  worker.have_result = false;
+  return true;
+}
+
+/**
+ * @brief Function to get the number of views added so far
+ *
+ * @param worker worker
+ * @return int views
+ */
+int cal_worker_views(cal_worker &worker) {
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  return (int) worker.point_list.size();
+}
+
+/**
+ * @brief Function to stop the worker thread, waiting for a run in progress to finish
+ *
+ * @param worker worker to stop
+ */
+void cal_worker_stop(cal_worker &worker) {
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.stop = true;
+    worker.wake.notify_one();
+  }
+  if(worker.thread.joinable()) worker.thread.join();
+}
@@ -6,29 +6,32 @@
  */
 
 #include "../include/calibration.h"
+#include "../include/luma_pyramid.h"
 
 /**
  * @brief Function to detect and extract chessboard
  * 
  * @param src source image to find the corners in 
- * @param dst dst image that displays the the corners
+ * @param dst dst image that displays the the corners, empty to skip drawing
  * @param patsize size of the pattern
  * @param corner_set vector of the point location of each corner  
  * @param pattern_found bool passed by reference to determine if corners were found. 
+ * @param coarse_width width to find the board at before refining at full resolution, 0 to search at full resolution
+ * @param saddle saddle point detector to find the board with instead of findChessboardCorners, nullptr to use findChessboardCorners
  * @return int return non-zero value on failure. 
  */
-int det_ext_corners(const cv::Mat &src, cv::Mat &dst, cv::Size patsize, std::vector<cv::Point2f> &corner_set, bool &pattern_found) { 
-  pattern_found = cv::findChessboardCorners(src, patsize, corner_set, cv::CALIB_CB_FAST_CHECK); 
-
-  if(pattern_found) {
-    cv::Mat gray; 
-    cv::cvtColor(src, gray, cv::COLOR_RGB2GRAY); 
-    cv::cornerSubPix(gray, corner_set, cv::Size(11, 11), cv::Size(-1, -1), cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.1));  
+int det_ext_corners(const cv::Mat &src, cv::Mat &dst, cv::Size patsize, std::vector<cv::Point2f> &corner_set, bool &pattern_found, 
+                    int coarse_width, saddle_detector *saddle) { 
+  // Convert once, grayscale images are used as they are
+  cv::Mat gray; 
+  luma_from_bgr(src, gray); 
+  if(saddle != nullptr) {
+    pattern_found = find_saddle_board(*saddle, gray, patsize, corner_set); 
+  } else {
+    pattern_found = find_chessboard(gray, patsize, corner_set, coarse_width); 
   }
 
-  cv::drawChessboardCorners(dst, patsize, corner_set, pattern_found);
-
-  
+  if(!dst.empty()) cv::drawChessboardCorners(dst, patsize, corner_set, pattern_found);
    
   return 0; 
 } 
@@ -0,0 +1,62 @@
+/**
+ * @file camera_model.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Camera calibration with cached undistortion tables and batched point undistortion
+ * @date 2026-10-17
+ */
+
+#include "../include/camera_model.h"
+
+/**
+ * @brief Function to set up a camera model from a calibration
+ *
+ * @param cam camera model to set up
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @return int return non-zero value on failure
+ */
+int camera_model_init(camera_model &cam, const cv::Mat &cam_mat, const cv::Mat &dist_coeffs) {
+  if(cam_mat.rows != 3 || cam_mat.cols != 3) return -1;
+  cam_mat.convertTo(cam.cam_mat, CV_64F);
+  dist_coeffs.convertTo(cam.dist_coeffs, CV_64F);
+  cam.distorted = !cam.dist_coeffs.empty() && cv::countNonZero(cam.dist_coeffs) > 0;
+  cam.map_size = cv::Size();
+  cam.map1.release();
+  cam.map2.release();
+  return 0;
+}
+
+/**
+ * @brief Function to remove the lens distortion from a frame with the cached remap tables, building them
+ * the first time a frame of its size is seen. Poses found on the result use no distortion coefficients.
+ *
+ * @param cam camera model
+ * @param src frame
+ * @param dst output undistorted frame, it shares src's data when the camera has no distortion
+ */
+void camera_model_rectify(camera_model &cam, const cv::Mat &src, cv::Mat &dst) {
+  if(!cam.distorted) {
+    dst = src;
+    return;
+  }
+  if(src.size() != cam.map_size) {
+    cv::initUndistortRectifyMap(cam.cam_mat, cam.dist_coeffs, cv::Mat(), cam.cam_mat, src.size(), CAMERA_MAP_TYPE, cam.map1, cam.map2);
+    cam.map_size = src.size();
+  }
+  cv::remap(src, dst, cam.map1, cam.map2, cv::INTER_LINEAR);
+}
+
+/**
+ * @brief Function to undistort points in one batch, keeping them in pixels of the same camera matrix
+ *
+ * @param cam camera model
+ * @param src points in the distorted frame
+ * @param dst output undistorted points, can be src
+ */
+void camera_model_undistort_points(const camera_model &cam, const std::vector<cv::Point2f> &src, std::vector<cv::Point2f> &dst) {
+  if(!cam.distorted || src.empty()) {
+    if(&dst != &src) dst = src;
+    return;
+  }
+  cv::undistortPoints(src, dst, cam.cam_mat, cam.dist_coeffs, cv::noArray(), cam.cam_mat);
+}
@@ -0,0 +1,511 @@
+/**
+ * @file chessboard.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Chessboard corner detection, optionally found on a downscaled image and refined at full resolution,
+ * with a saddle point detector for the known pattern and a tracker that follows the corners between frames
+ * @date 2026-10-17
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <opencv2/core/hal/intrin.hpp>
+#include "../include/chessboard.h"
+
+/**
+ * @brief Function to get the shortest distance between neighbouring corners of the board
+ *
+ * @param corners corners in the order findChessboardCorners returns them
+ * @param patsize size of the pattern
+ * @return float shortest distance in pixels
+ */
+static float min_corner_spacing(const std::vector<cv::Point2f> &corners, cv::Size patsize) {
+  float best = FLT_MAX;
+  for(int r = 0; r < patsize.height; r++) {
+    for(int c = 0; c < patsize.width; c++) {
+      const cv::Point2f &p = corners[r * patsize.width + c];
+      if(c + 1 < patsize.width) {
+        cv::Point2f d = corners[r * patsize.width + c + 1] - p;
+        best = std::min(best, std::sqrt(d.x * d.x + d.y * d.y));
+      }
+      if(r + 1 < patsize.height) {
+        cv::Point2f d = corners[(r + 1) * patsize.width + c] - p;
+        best = std::min(best, std::sqrt(d.x * d.x + d.y * d.y));
+      }
+    }
+  }
+  return best;
+}
+
+/**
+ * @brief Function to map corners found on a downscaled image back to full resolution and refine them there.
+ * The mapped corners are within about a small pixel of the true ones, so the window only has to cover that,
+ * and it must stay inside one square so it doesn't pull towards the next corner.
+ *
+ * @param gray full resolution grayscale image
+ * @param small_size size of the image the corners were found on
+ * @param patsize size of the pattern
+ * @param corner_set corners in small image coordinates, output in full resolution coordinates
+ */
+static void refine_upscaled_corners(const cv::Mat &gray, cv::Size small_size, cv::Size patsize, std::vector<cv::Point2f> &corner_set) {
+  // Map pixel centers back to full resolution
+  float sx = (float) gray.cols / small_size.width;
+  float sy = (float) gray.rows / small_size.height;
+  for(int i = 0; i < corner_set.size(); i++) {
+    corner_set[i].x = (corner_set[i].x + 0.5f) * sx - 0.5f;
+    corner_set[i].y = (corner_set[i].y + 0.5f) * sy - 0.5f;
+  }
+
+  int win = (int) std::ceil(1.5f * std::max(sx, sy)) + 1;
+  win = std::min(win, (int) (0.4f * min_corner_spacing(corner_set, patsize)));
+  win = std::max(CHESSBOARD_FINE_MIN_WIN, std::min(CHESSBOARD_SUBPIX_WIN, win));
+  cv::cornerSubPix(gray, corner_set, cv::Size(win, win), cv::Size(-1, -1),
+                   cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.1));
+}
+
+/**
+ * @brief Function to find the corners of a chessboard and refine them to sub-pixel accuracy. In coarse to fine
+ * mode the board is found on a downscaled image, the corners are mapped back up and only refined in small
+ * windows at full resolution, sized by how far the mapping can be off.
+ *
+ * @param gray grayscale image
+ * @param patsize size of the pattern
+ * @param corner_set output corners in full resolution coordinates
+ * @param coarse_width width to find the board at, 0 to search the full resolution image
+ * @param levels downscaled copies of gray to pick the coarse image from instead of resizing, nullptr to resize
+ * @return bool true if the board was found
+ */
+bool find_chessboard(const cv::Mat &gray, cv::Size patsize, std::vector<cv::Point2f> &corner_set, int coarse_width,
+                     const std::vector<cv::Mat> *levels) {
+  const cv::TermCriteria criteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.1);
+
+  // Small frames gain nothing from the coarse pass
+  if(coarse_width <= 0 || gray.cols <= CHESSBOARD_COARSE_MARGIN * coarse_width) {
+    if(!cv::findChessboardCorners(gray, patsize, corner_set, cv::CALIB_CB_FAST_CHECK)) return false;
+    cv::cornerSubPix(gray, corner_set, cv::Size(CHESSBOARD_SUBPIX_WIN, CHESSBOARD_SUBPIX_WIN), cv::Size(-1, -1), criteria);
+    return true;
+  }
+
+  // Use the smallest level that's still at least the coarse width, or resize to it
+  cv::Mat small;
+  if(levels != nullptr) {
+    for(int i = 0; i < levels->size(); i++) {
+      if((*levels)[i].cols >= coarse_width && (*levels)[i].cols < gray.cols) small = (*levels)[i];
+    }
+  }
+  if(small.empty()) {
+    cv::Size size(coarse_width, std::max(1, cvRound((double) gray.rows * coarse_width / gray.cols)));
+    cv::resize(gray, small, size, 0, 0, cv::INTER_AREA);
+  }
+
+  if(!cv::findChessboardCorners(small, patsize, corner_set, cv::CALIB_CB_FAST_CHECK)) return false;
+  cv::cornerSubPix(small, corner_set, cv::Size(CHESSBOARD_COARSE_SUBPIX_WIN, CHESSBOARD_COARSE_SUBPIX_WIN), cv::Size(-1, -1), criteria);
+
+  refine_upscaled_corners(gray, small.size(), patsize, corner_set);
+  return true;
+}
+
+/**
+ * @brief Function to get the downscaled levels find_chessboard can take its coarse image from. They're only
+ * used when something else already built them, building them just for this costs more than one resize.
+ *
+ * @param pyr pyramid of the frame
+ * @param coarse_width width to find the board at, 0 to search at full resolution
+ * @return const std::vector<cv::Mat>* the pyramid's levels, nullptr to let find_chessboard resize
+ */
+const std::vector<cv::Mat> *chessboard_levels(const luma_pyramid &pyr, int coarse_width) {
+  if(coarse_width <= 0 || !pyr.have_levels || pyr.gray.cols <= CHESSBOARD_COARSE_MARGIN * coarse_width) return nullptr;
+  return &pyr.levels;
+}
+
+/**
+ * @brief Function to compute the saddle response of one row, dxy^2 - dxx * dyy of the Hessian, which is
+ * positive at the crossing of a chessboard's squares and negative or zero on blobs and edges
+ *
+ * @param up row above
+ * @param row row the response is computed for
+ * @param down row below
+ * @param dst output response, the first and last pixels are set to 0
+ * @param cols pixels in the row
+ */
+static void saddle_row(const float *up, const float *row, const float *down, float *dst, int cols) {
+  dst[0] = 0;
+  int x = 1;
+#if CV_SIMD128
+  const cv::v_float32x4 two = cv::v_setall_f32(2.0f);
+  const cv::v_float32x4 quarter = cv::v_setall_f32(0.25f);
+  for(; x <= cols - 5; x += 4) {
+    cv::v_float32x4 c = cv::v_load(row + x);
+    cv::v_float32x4 dxx = cv::v_load(row + x + 1) + cv::v_load(row + x - 1) - two * c;
+    cv::v_float32x4 dyy = cv::v_load(up + x) + cv::v_load(down + x) - two * c;
+    cv::v_float32x4 dxy = quarter * (cv::v_load(down + x + 1) - cv::v_load(down + x - 1) - cv::v_load(up + x + 1) + cv::v_load(up + x - 1));
+    cv::v_store(dst + x, dxy * dxy - dxx * dyy);
+  }
+#endif
+  for(; x < cols - 1; x++) {
+    float dxx = row[x + 1] + row[x - 1] - 2.0f * row[x];
+    float dyy = up[x] + down[x] - 2.0f * row[x];
+    float dxy = 0.25f * (down[x + 1] - down[x - 1] - up[x + 1] + up[x - 1]);
+    dst[x] = dxy * dxy - dxx * dyy;
+  }
+  if(cols > 1) dst[cols - 1] = 0;
+}
+
+/**
+ * @brief Function to find the saddle points of an image, the strongest response in their neighbourhood
+ * above the threshold, keeping at most SADDLE_MAX_CANDIDATES of them
+ *
+ * @param det detector, the candidates, their strength and their order from the strongest are written to it
+ * @param gray grayscale image at the working width
+ */
+static void find_saddle_points(saddle_detector &det, const cv::Mat &gray) {
+  gray.convertTo(det.blurred, CV_32F);
+  cv::GaussianBlur(det.blurred, det.blurred, cv::Size(0, 0), SADDLE_BLUR_SIGMA);
+
+  det.response.create(gray.rows, gray.cols, CV_32FC1);
+  det.response.row(0).setTo(cv::Scalar(0));
+  det.response.row(gray.rows - 1).setTo(cv::Scalar(0));
+  cv::parallel_for_(cv::Range(1, gray.rows - 1), [&](const cv::Range &range) {
+    for(int y = range.start; y < range.end; y++) {
+      saddle_row(det.blurred.ptr<float>(y - 1), det.blurred.ptr<float>(y), det.blurred.ptr<float>(y + 1),
+                 det.response.ptr<float>(y), gray.cols);
+    }
+  });
+
+  // Non-maximum suppression, a 3x3 dilation repeated grows to the whole window
+  double max_response = 0;
+  cv::minMaxLoc(det.response, nullptr, &max_response);
+  float threshold = std::max(SADDLE_MIN_RESPONSE, SADDLE_REL_THRESHOLD * (float) max_response);
+  cv::dilate(det.response, det.dilated, cv::Mat(), cv::Point(-1, -1), SADDLE_NMS_RADIUS);
+
+  det.candidates.clear();
+  det.strength.clear();
+  for(int y = 1; y < gray.rows - 1; y++) {
+    const float *r = det.response.ptr<float>(y);
+    const float *d = det.dilated.ptr<float>(y);
+    for(int x = 1; x < gray.cols - 1; x++) {
+      if(r[x] < threshold || r[x] < d[x]) continue;
+
+      // Fit a parabola through the neighbours on each axis for the sub-pixel position
+      const float *up = det.response.ptr<float>(y - 1);
+      const float *down = det.response.ptr<float>(y + 1);
+      float ox = 2 * r[x] - r[x - 1] - r[x + 1];
+      float oy = 2 * r[x] - up[x] - down[x];
+      ox = ox > 0 ? 0.5f * (r[x + 1] - r[x - 1]) / ox : 0;
+      oy = oy > 0 ? 0.5f * (down[x] - up[x]) / oy : 0;
+      det.candidates.push_back(cv::Point2f(x + std::max(-0.5f, std::min(0.5f, ox)), y + std::max(-0.5f, std::min(0.5f, oy))));
+      det.strength.push_back(r[x]);
+    }
+  }
+
+  det.order.resize(det.candidates.size());
+  for(int i = 0; i < det.order.size(); i++) det.order[i] = i;
+  auto stronger = [&](int a, int b) { return det.strength[a] > det.strength[b]; };
+  if(det.order.size() > SADDLE_MAX_CANDIDATES) {
+    std::nth_element(det.order.begin(), det.order.begin() + SADDLE_MAX_CANDIDATES, det.order.end(), stronger);
+    det.order.resize(SADDLE_MAX_CANDIDATES);
+  }
+  std::sort(det.order.begin(), det.order.end(), stronger);
+}
+
+/**
+ * @brief Function to find the unused candidate closest to a point
+ *
+ * @param det detector
+ * @param p point
+ * @param radius furthest the candidate can be
+ * @return int candidate, -1 if there's none within the radius
+ */
+static int nearest_saddle(const saddle_detector &det, cv::Point2f p, float radius) {
+  int best = -1;
+  float best_dist = radius * radius;
+  for(int k = 0; k < det.order.size(); k++) {
+    int c = det.order[k];
+    if(det.used[c]) continue;
+    cv::Point2f d = det.candidates[c] - p;
+    float dist = d.x * d.x + d.y * d.y;
+    if(dist < best_dist) {
+      best_dist = dist;
+      best = c;
+    }
+  }
+  return best;
+}
+
+/**
+ * @brief Function to grow a grid of saddle points from a seed and check it's the board. Each new corner is
+ * predicted from the step to its neighbour on the same line, or failing that the step between the two
+ * corners beside it, so the prediction follows the perspective of the board.
+ *
+ * @param det detector with its candidates found
+ * @param seed candidate the grid starts from
+ * @param patsize size of the pattern
+ * @param corner_set output corners at the working width, in the order findChessboardCorners uses
+ * @return bool true if the grid has exactly the rows and columns of the pattern
+ */
+static bool grow_saddle_grid(saddle_detector &det, int seed, cv::Size patsize, std::vector<cv::Point2f> &corner_set) {
+  const std::vector<cv::Point2f> &pts = det.candidates;
+  cv::Point2f s = pts[seed];
+
+  // The grid's axes are the nearest neighbour and the next nearest that points another way
+  int neighbours[SADDLE_NEIGHBOURS];
+  float dists[SADDLE_NEIGHBOURS];
+  int found = 0;
+  for(int k = 0; k < det.order.size(); k++) {
+    int c = det.order[k];
+    cv::Point2f d = pts[c] - s;
+    float dist = std::sqrt(d.x * d.x + d.y * d.y);
+    if(c == seed || dist < SADDLE_MIN_STEP) continue;
+    int pos = found < SADDLE_NEIGHBOURS ? found++ : SADDLE_NEIGHBOURS;
+    if(pos == SADDLE_NEIGHBOURS && dist >= dists[SADDLE_NEIGHBOURS - 1]) continue;
+    if(pos == SADDLE_NEIGHBOURS) pos--;
+    for(; pos > 0 && dists[pos - 1] > dist; pos--) {
+      neighbours[pos] = neighbours[pos - 1];
+      dists[pos] = dists[pos - 1];
+    }
+    neighbours[pos] = c;
+    dists[pos] = dist;
+  }
+  if(found < 2) return false;
+  cv::Point2f u = pts[neighbours[0]] - s;
+  cv::Point2f v;
+  bool have_v = false;
+  for(int k = 1; k < found && !have_v; k++) {
+    cv::Point2f d = pts[neighbours[k]] - s;
+    float cosine = (u.x * d.x + u.y * d.y) / (dists[0] * dists[k]);
+    if(std::fabs(cosine) < 0.5f && dists[k] < 2 * dists[0]) {
+      v = d;
+      have_v = true;
+    }
+  }
+  if(!have_v) return false;
+
+  // Grid cells are (i, j) with i along u and j along v, the seed is in the middle so the grid can grow any way
+  const int span = std::max(patsize.width, patsize.height);
+  const int side = 2 * span - 1;
+  det.grid.assign(side * side, -1);
+  det.used.assign(pts.size(), 0);
+  det.queue.clear();
+  det.grid[(span - 1) * side + span - 1] = seed;
+  det.used[seed] = 1;
+  det.queue.push_back((span - 1) * side + span - 1);
+  int min_i = span - 1, max_i = span - 1, min_j = span - 1, max_j = span - 1;
+
+  const int di[4] = {1, -1, 0, 0};
+  const int dj[4] = {0, 0, 1, -1};
+  for(int q = 0; q < det.queue.size(); q++) {
+    int i = det.queue[q] / side;
+    int j = det.queue[q] % side;
+    cv::Point2f p = pts[det.grid[det.queue[q]]];
+    for(int d = 0; d < 4; d++) {
+      int ni = i + di[d];
+      int nj = j + dj[d];
+      if(ni < 0 || nj < 0 || ni >= side || nj >= side || det.grid[ni * side + nj] >= 0) continue;
+
+      int bi = i - di[d];
+      int bj = j - dj[d];
+      cv::Point2f step = di[d] != 0 ? (float) di[d] * u : (float) dj[d] * v;
+      if(bi >= 0 && bj >= 0 && bi < side && bj < side && det.grid[bi * side + bj] >= 0) {
+        step = p - pts[det.grid[bi * side + bj]];
+      } else {
+        // Same step as the corners beside this one on the next line
+        int ei = dj[d] != 0 ? 1 : 0;
+        int ej = di[d] != 0 ? 1 : 0;
+        for(int sgn = -1; sgn <= 1; sgn += 2) {
+          int ai = i + sgn * ei, aj = j + sgn * ej;
+          int ci = ni + sgn * ei, cj = nj + sgn * ej;
+          if(ai < 0 || aj < 0 || ai >= side || aj >= side || ci < 0 || cj < 0 || ci >= side || cj >= side) continue;
+          if(det.grid[ai * side + aj] >= 0 && det.grid[ci * side + cj] >= 0) {
+            step = pts[det.grid[ci * side + cj]] - pts[det.grid[ai * side + aj]];
+            break;
+          }
+        }
+      }
+
+      float step_len = std::sqrt(step.x * step.x + step.y * step.y);
+      if(step_len < SADDLE_MIN_STEP) continue;
+      int c = nearest_saddle(det, p + step, SADDLE_MATCH_RADIUS * step_len);
+      if(c < 0) continue;
+
+      det.grid[ni * side + nj] = c;
+      det.used[c] = 1;
+      det.queue.push_back(ni * side + nj);
+      min_i = std::min(min_i, ni);
+      max_i = std::max(max_i, ni);
+      min_j = std::min(min_j, nj);
+      max_j = std::max(max_j, nj);
+      if(max_i - min_i + 1 > span || max_j - min_j + 1 > span) return false; // bigger than the board
+    }
+  }
+
+  // Only the board's inner corners, all of them
+  int rows_i = max_i - min_i + 1;
+  int rows_j = max_j - min_j + 1;
+  if(det.queue.size() != patsize.area()) return false;
+  bool along_i = rows_i == patsize.width && rows_j == patsize.height;
+  if(!along_i && !(rows_j == patsize.width && rows_i == patsize.height)) return false;
+
+  // Rows run left to right and the next row is below, as far as the board's turn allows
+  auto corner = [&](int col, int row) {
+    int i = along_i ? min_i + col : min_i + row;
+    int j = along_i ? min_j + row : min_j + col;
+    return pts[det.grid[i * side + j]];
+  };
+  cv::Point2f row_dir = corner(patsize.width - 1, 0) - corner(0, 0);
+  cv::Point2f col_dir = corner(0, patsize.height - 1) - corner(0, 0);
+  bool flip_col = row_dir.x < 0 || (row_dir.x == 0 && row_dir.y < 0);
+  if(flip_col) row_dir = -row_dir;
+  bool flip_row = row_dir.x * col_dir.y - row_dir.y * col_dir.x < 0;
+
+  corner_set.resize(patsize.area());
+  for(int r = 0; r < patsize.height; r++) {
+    for(int c = 0; c < patsize.width; c++) {
+      corner_set[r * patsize.width + c] = corner(flip_col ? patsize.width - 1 - c : c, flip_row ? patsize.height - 1 - r : r);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Function to find the inner corners of a chessboard without findChessboardCorners. Saddle points are
+ * found with a vectorized second derivative filter, the strongest are grown into a grid from a few seeds and
+ * the grid is accepted when it has exactly the pattern's rows and columns. The frame is searched at a fixed
+ * width and the number of candidates and seeds is capped, so the cost is about the same with or without a board.
+ * The corners are ordered along the rows starting from the left, with the next row below, and refined with
+ * cornerSubPix at full resolution.
+ *
+ * @param det buffers of the detector
+ * @param gray grayscale image
+ * @param patsize size of the pattern
+ * @param corner_set output corners in full resolution coordinates
+ * @return bool true if the board was found
+ */
+bool find_saddle_board(saddle_detector &det, const cv::Mat &gray, cv::Size patsize, std::vector<cv::Point2f> &corner_set) {
+  if(gray.rows < 3 || gray.cols < 3) return false;
+  cv::Mat work = gray;
+  if(gray.cols > SADDLE_WORK_WIDTH) {
+    cv::Size size(SADDLE_WORK_WIDTH, std::max(3, cvRound((double) gray.rows * SADDLE_WORK_WIDTH / gray.cols)));
+    cv::resize(gray, det.small, size, 0, 0, cv::INTER_AREA);
+    work = det.small;
+  }
+
+  find_saddle_points(det, work);
+  if(det.order.size() < patsize.area()) return false;
+
+  bool found = false;
+  int seeds = std::min((int) det.order.size(), SADDLE_MAX_SEEDS);
+  for(int k = 0; k < seeds && !found; k++) {
+    found = grow_saddle_grid(det, det.order[k], patsize, corner_set);
+  }
+  if(!found) return false;
+
+  refine_upscaled_corners(gray, work.size(), patsize, corner_set);
+  return true;
+}
+
+/**
+ * @brief Function to set up a board tracker
+ *
+ * @param tracker tracker to set up
+ * @param patsize size of the pattern
+ */
+void board_tracker_init(board_tracker &tracker, cv::Size patsize) {
+  tracker.locked = false;
+  tracker.patsize = patsize;
+  tracker.object_pts.clear();
+  for(int i = 0; i < patsize.height; i++) {
+    for(int j = 0; j < patsize.width; j++) {
+      tracker.object_pts.push_back(cv::Vec3f(j, -i, 0));
+    }
+  }
+  tracker.corners.clear();
+  tracker.prev_flow.clear();
+}
+
+/**
+ * @brief Function to follow the last frame's corners into a new frame
+ *
+ * @param tracker locked board tracker
+ * @param pyr pyramid of the new frame
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param corner_set output corners
+ * @param rotations output rotations
+ * @param translations output translations
+ * @return bool true if every corner was followed and the pose agrees with them
+ */
+static bool track_board(board_tracker &tracker, luma_pyramid &pyr, cv::Mat cam_mat, cv::Mat dist_coeffs,
+                        std::vector<cv::Point2f> &corner_set, cv::Mat &rotations, cv::Mat &translations) {
+  if(!tracker.locked || tracker.prev_flow.empty() || tracker.prev_flow[0].size() != pyr.gray.size()) return false;
+
+  const std::vector<cv::Mat> &flow = luma_pyramid_flow(pyr, cv::Size(BOARD_TRACK_WIN_SIZE, BOARD_TRACK_WIN_SIZE), BOARD_TRACK_PYR_LEVELS);
+  cv::calcOpticalFlowPyrLK(tracker.prev_flow, flow, tracker.corners, tracker.next_pts, tracker.status, tracker.err,
+                           cv::Size(BOARD_TRACK_WIN_SIZE, BOARD_TRACK_WIN_SIZE), BOARD_TRACK_PYR_LEVELS,
+                           cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 20, 0.03));
+
+  // The pose needs the whole board, so one lost corner means searching again
+  cv::Rect frame_rect(0, 0, pyr.gray.cols, pyr.gray.rows);
+  for(int i = 0; i < tracker.next_pts.size(); i++) {
+    if(!tracker.status[i] || !frame_rect.contains(tracker.next_pts[i])) return false;
+  }
+
+  // Flow drifts a little, snap back onto the corners with a window smaller than a square
+  int win = (int) std::min((float) BOARD_TRACK_SUBPIX_WIN, 0.4f * min_corner_spacing(tracker.next_pts, tracker.patsize));
+  if(win < 2) return false;
+  cv::cornerSubPix(pyr.gray, tracker.next_pts, cv::Size(win, win), cv::Size(-1, -1),
+                   cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 20, 0.1));
+
+  // Start the pose from the last one, it's only moved a little, and check it reprojects onto the corners
+  tracker.rotations.copyTo(rotations);
+  tracker.translations.copyTo(translations);
+  if(!cv::solvePnP(tracker.object_pts, tracker.next_pts, cam_mat, dist_coeffs, rotations, translations, true)) return false;
+  cv::projectPoints(tracker.object_pts, rotations, translations, cam_mat, dist_coeffs, tracker.projected);
+  double total = 0;
+  for(int i = 0; i < tracker.projected.size(); i++) {
+    cv::Point2f d = tracker.projected[i] - tracker.next_pts[i];
+    total += std::sqrt(d.x * d.x + d.y * d.y);
+  }
+  if(total / tracker.projected.size() > BOARD_TRACK_MAX_REPROJ_ERR) return false;
+
+  corner_set = tracker.next_pts;
+  return true;
+}
+
+/**
+ * @brief Function to find the board and its pose in a new frame. The last frame's corners are followed with
+ * optical flow, refined with a small sub-pixel search and accepted if the pose solved from them, starting
+ * from the last pose, reprojects onto them. Otherwise the board is searched for with find_chessboard.
+ *
+ * @param tracker board tracker
+ * @param pyr pyramid of the frame
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param coarse_width width find_chessboard searches at, 0 for full resolution
+ * @param corner_set output corners
+ * @param rotations output rotations
+ * @param translations output translations
+ * @param tracked output true if the corners came from tracking instead of a search
+ * @return bool true if the board was found
+ */
+bool board_tracker_update(board_tracker &tracker, luma_pyramid &pyr, cv::Mat cam_mat, cv::Mat dist_coeffs, int coarse_width,
+                          std::vector<cv::Point2f> &corner_set, cv::Mat &rotations, cv::Mat &translations, bool &tracked) {
+  tracked = track_board(tracker, pyr, cam_mat, dist_coeffs, corner_set, rotations, translations);
+  if(!tracked) {
+    tracker.locked = false;
+    if(tracker.saddle != nullptr) {
+      if(!find_saddle_board(*tracker.saddle, pyr.gray, tracker.patsize, corner_set)) return false;
+    } else {
+      if(!find_chessboard(pyr.gray, tracker.patsize, corner_set, coarse_width, chessboard_levels(pyr, coarse_width))) return false;
+    }
+    if(!cv::solvePnP(tracker.object_pts, corner_set, cam_mat, dist_coeffs, rotations, translations)) return false;
+  }
+
+  // Keep this frame to follow the corners from next time
+  tracker.corners = corner_set;
+  rotations.copyTo(tracker.rotations);
+  translations.copyTo(tracker.translations);
+  copy_flow_pyramid(luma_pyramid_flow(pyr, cv::Size(BOARD_TRACK_WIN_SIZE, BOARD_TRACK_WIN_SIZE), BOARD_TRACK_PYR_LEVELS),
+                    tracker.prev_flow);
+  tracker.locked = true;
+  return true;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file chessboard_bench.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Program to benchmark full resolution chessboard detection against coarse to fine detection and the saddle point
+ * detector at several resolutions
+ * @date 2026-10-17
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <dirent.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include "../include/chessboard.h"
+#include "../include/frame_source.h"
+
+#define BENCH_REPEATS 10
+
+/**
+ * @brief Totals of one resolution over every image
+ */
+struct width_totals {
+  int images = 0;
+  int found_full = 0;
+  int found_coarse = 0;
+  int compared = 0; // images both found the board in
+  double full_ms = 0;
+  double coarse_ms = 0;
+  double mean_diff = 0; // mean distance between the corners of the two methods, over the compared images
+  double max_diff = 0;
+  int found_saddle = 0;
+  int saddle_compared = 0; // images findChessboardCorners and the saddle detector found the board in
+  double saddle_ms = 0;
+  double saddle_mean_diff = 0; // mean distance from the saddle detector's corners to findChessboardCorners'
+  double saddle_max_diff = 0;
+  double empty_full_ms = 0; // time on a frame without a board
+  double empty_saddle_ms = 0;
+};
+
+/**
+ * @brief Function to compare two sets of corners. Either detector may start from the opposite end of a board
+ * that looks the same turned half way round, so the closer of the two orders is used.
+ *
+ * @param a corners
+ * @param b corners in the same or the reverse order
+ * @param max_diff largest distance between matching corners, raised if this pair's is larger
+ * @return double mean distance between matching corners
+ */
+static double corner_diff(const std::vector<cv::Point2f> &a, const std::vector<cv::Point2f> &b, double &max_diff) {
+  double total[2] = {0, 0};
+  double worst[2] = {0, 0};
+  for(int i = 0; i < a.size(); i++) {
+    for(int o = 0; o < 2; o++) {
+      cv::Point2f d = a[i] - b[o == 0 ? i : b.size() - 1 - i];
+      double dist = std::sqrt(d.x * d.x + d.y * d.y);
+      total[o] += dist;
+      worst[o] = std::max(worst[o], dist);
+    }
+  }
+  int o = total[0] <= total[1] ? 0 : 1;
+  max_diff = std::max(max_diff, worst[o]);
+  return total[o] / a.size();
+}
+
+int main(int argc, char *argv[]) {
+  std::string image_dir = "./cal_imgs/";
+  cv::Size patternsize(9, 6);
+  std::vector<int> widths = {640, 1280, 1920, 2560};
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+      // comma separated widths
+      widths.clear();
+      for(char *tok = strtok(argv[++i], ","); tok != nullptr; tok = strtok(nullptr, ",")) {
+        if(atoi(tok) > 0) widths.push_back(atoi(tok));
+      }
+    } else if(argv[i][0] != '-') {
+      image_dir = argv[i];
+    } else {
+      printf("error :: usage : %s [image_dir] [-w 640,1280,1920]\n", argv[0]);
+      exit(-1);
+    }
+  }
+
+  frame_source src;
+  if(open_frame_source(image_dir, src) != 0 || !src.is_dir) {
+    printf("Unable to read images from %s\n", image_dir.c_str());
+    exit(-1);
+  }
+
+  // Every image is resized to each width, so the same boards are compared at every resolution
+  double tick_ms = 1000.0 / cv::getTickFrequency();
+  std::vector<width_totals> totals(widths.size());
+  saddle_detector saddle;
+  for(int p = 0; p < src.paths.size(); p++) {
+    cv::Mat img = cv::imread(src.paths[p], cv::IMREAD_GRAYSCALE);
+    if(img.empty()) continue;
+
+    for(int w = 0; w < widths.size(); w++) {
+      width_totals &t = totals[w];
+      cv::Mat gray;
+      cv::Size size(widths[w], std::max(1, cvRound((double) img.rows * widths[w] / img.cols)));
+      cv::resize(img, gray, size, 0, 0, widths[w] < img.cols ? cv::INTER_AREA : cv::INTER_CUBIC);
+      t.images++;
+
+      std::vector<cv::Point2f> full, coarse;
+      bool found_full = false, found_coarse = false;
+      int64 t0 = cv::getTickCount();
+      for(int r = 0; r < BENCH_REPEATS; r++) {
+        found_full = find_chessboard(gray, patternsize, full);
+      }
+      t.full_ms += (cv::getTickCount() - t0) * tick_ms / BENCH_REPEATS;
+
+      t0 = cv::getTickCount();
+      for(int r = 0; r < BENCH_REPEATS; r++) {
+        found_coarse = find_chessboard(gray, patternsize, coarse, CHESSBOARD_COARSE_WIDTH);
+      }
+      t.coarse_ms += (cv::getTickCount() - t0) * tick_ms / BENCH_REPEATS;
+
+      t.found_full += found_full ? 1 : 0;
+      t.found_coarse += found_coarse ? 1 : 0;
+      if(found_full && found_coarse && full.size() == coarse.size()) {
+        t.mean_diff += corner_diff(full, coarse, t.max_diff);
+        t.compared++;
+      }
+
+      std::vector<cv::Point2f> saddle_corners;
+      bool found_saddle = false;
+      t0 = cv::getTickCount();
+      for(int r = 0; r < BENCH_REPEATS; r++) {
+        found_saddle = find_saddle_board(saddle, gray, patternsize, saddle_corners);
+      }
+      t.saddle_ms += (cv::getTickCount() - t0) * tick_ms / BENCH_REPEATS;
+      t.found_saddle += found_saddle ? 1 : 0;
+      if(found_full && found_saddle && full.size() == saddle_corners.size()) {
+        t.saddle_mean_diff += corner_diff(full, saddle_corners, t.saddle_max_diff);
+        t.saddle_compared++;
+      }
+
+      // The same size of frame with texture but no board, where findChessboardCorners is slowest
+      cv::Mat empty(gray.size(), CV_8UC1);
+      cv::randu(empty, cv::Scalar(0), cv::Scalar(255));
+      cv::GaussianBlur(empty, empty, cv::Size(0, 0), 3.0);
+      t0 = cv::getTickCount();
+      for(int r = 0; r < BENCH_REPEATS; r++) {
+        find_chessboard(empty, patternsize, full);
+      }
+      t.empty_full_ms += (cv::getTickCount() - t0) * tick_ms / BENCH_REPEATS;
+      t0 = cv::getTickCount();
+      for(int r = 0; r < BENCH_REPEATS; r++) {
+        find_saddle_board(saddle, empty, patternsize, saddle_corners);
+      }
+      t.empty_saddle_ms += (cv::getTickCount() - t0) * tick_ms / BENCH_REPEATS;
+    }
+  }
+
+  printf("width,images,found_full,found_coarse,full_ms,coarse_ms,speedup,mean_corner_diff,max_corner_diff,"
+         "found_saddle,saddle_ms,saddle_speedup,saddle_mean_diff,saddle_max_diff,empty_full_ms,empty_saddle_ms\n");
+  for(int w = 0; w < widths.size(); w++) {
+    const width_totals &t = totals[w];
+    if(t.images == 0) continue;
+    double full_ms = t.full_ms / t.images;
+    double coarse_ms = t.coarse_ms / t.images;
+    double saddle_ms = t.saddle_ms / t.images;
+    printf("%d,%d,%d,%d,%.3f,%.3f,%.2f,%.4f,%.4f,", widths[w], t.images, t.found_full, t.found_coarse, full_ms, coarse_ms,
+            coarse_ms > 0 ? full_ms / coarse_ms : 0.0, t.compared > 0 ? t.mean_diff / t.compared : -1.0, t.compared > 0 ? t.max_diff : -1.0);
+    printf("%d,%.3f,%.2f,%.4f,%.4f,%.3f,%.3f\n", t.found_saddle, saddle_ms, saddle_ms > 0 ? full_ms / saddle_ms : 0.0,
+            t.saddle_compared > 0 ? t.saddle_mean_diff / t.saddle_compared : -1.0, t.saddle_compared > 0 ? t.saddle_max_diff : -1.0,
+            t.empty_full_ms / t.images, t.empty_saddle_ms / t.images);
+  }
+
+  return 0;
+}
@@ -0,0 +1,263 @@
+/**
+ * @file feature_cache.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Binary cache of the keypoints and descriptors of the model images so they don't have to be found again at startup
+ * @date 2026-10-17
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/feature_cache.h"
+
+/**
+ * @brief Start of the cache file. It's followed by the entry table, the names, the keypoints and the descriptors.
+ */
+struct cache_header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t detector_hash; // hash of the ORB settings the features were found with
+  uint64_t file_size; // size of the whole file, to catch a truncated one
+  uint32_t num_entries;
+  uint32_t desc_bytes; // bytes in one descriptor
+};
+
+/**
+ * @brief Where to find the features of one model image in the cache file
+ */
+struct cache_entry {
+  uint64_t name_offset;
+  uint32_t name_len;
+  uint32_t num_keypoints;
+  int64_t mtime; // modification time of the image in nanoseconds when its features were found
+  int64_t file_size; // size of the image when its features were found
+  int32_t width; // size of the resized model image
+  int32_t height;
+  uint64_t keypoint_offset;
+  uint64_t desc_offset;
+};
+
+/**
+ * @brief A keypoint as it's stored in the cache file
+ */
+struct cache_keypoint {
+  float x, y, size, angle, response;
+  int32_t octave, class_id;
+};
+
+/**
+ * @brief Function to hash the settings of the ORB detector
+ *
+ * @param detector ORB detector
+ * @return uint64_t FNV-1a hash of the settings
+ */
+static uint64_t hash_detector(cv::Ptr<cv::ORB> detector) {
+  double settings[] = { (double) detector->getMaxFeatures(), detector->getScaleFactor(), (double) detector->getNLevels(),
+                        (double) detector->getEdgeThreshold(), (double) detector->getFirstLevel(), (double) detector->getWTA_K(),
+                        (double) detector->getScoreType(), (double) detector->getPatchSize(), (double) detector->getFastThreshold() };
+  uint64_t hash = 14695981039346656037ULL;
+  const uchar *bytes = (const uchar *) settings;
+  for(int i = 0; i < sizeof(settings); i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * @brief Function to round an offset up to a multiple of 8 bytes
+ *
+ * @param offset offset in the file
+ * @return uint64_t aligned offset
+ */
+static uint64_t align8(uint64_t offset) {
+  return (offset + 7) & ~(uint64_t) 7;
+}
+
+/**
+ * @brief Function to map a cache file written by save_feature_cache
+ *
+ * @param filename cache file
+ * @param detector ORB detector, the cache is only used if it was written with the same settings
+ * @param cache output cache
+ * @return int return non-zero value if the file is missing, corrupt or was written with other settings
+ */
+int open_feature_cache(const std::string &filename, cv::Ptr<cv::ORB> detector, feature_cache &cache) {
+  cache = feature_cache();
+  int fd = open(filename.c_str(), O_RDONLY);
+  if(fd < 0) return -1;
+
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(cache_header)) {
+    close(fd);
+    return -1;
+  }
+
+  // Map it shared and read-only so every process using the cache shares the same pages
+  size_t size = (size_t) st.st_size;
+  void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(addr == MAP_FAILED) return -1;
+  cache.mapping = std::shared_ptr<void>(addr, [size](void *p) { munmap(p, size); });
+  cache.data = (const uchar *) addr;
+  cache.size = size;
+
+  const cache_header *header = (const cache_header *) cache.data;
+  uint64_t table_end = sizeof(cache_header) + (uint64_t) header->num_entries * sizeof(cache_entry);
+  if(header->magic != FEATURE_CACHE_MAGIC || header->version != FEATURE_CACHE_VERSION ||
+     header->file_size != size || table_end > size || header->detector_hash != hash_detector(detector)) {
+    printf("Feature cache %s is out of date, finding the features again\n", filename.c_str());
+    cache = feature_cache();
+    return -1;
+  }
+
+  // Index the entries by name, skipping any that point outside the file
+  const cache_entry *table = (const cache_entry *) (cache.data + sizeof(cache_header));
+  for(int i = 0; i < header->num_entries; i++) {
+    const cache_entry &entry = table[i];
+    uint64_t keypoints_end = entry.keypoint_offset + (uint64_t) entry.num_keypoints * sizeof(cache_keypoint);
+    uint64_t desc_end = entry.desc_offset + (uint64_t) entry.num_keypoints * header->desc_bytes;
+    if(entry.name_offset + entry.name_len > size || keypoints_end > size || desc_end > size ||
+       entry.keypoint_offset % alignof(cache_keypoint) != 0) continue;
+    cache.entries[std::string((const char *) cache.data + entry.name_offset, entry.name_len)] = i;
+  }
+  return 0;
+}
+
+/**
+ * @brief Function to get the keypoints and descriptors of a target from the cache. The target's name,
+ * modification time and file size must already be set, and the entry is only used if they all match.
+ *
+ * @param cache mapped cache
+ * @param target target to fill in, its descriptors point into the mapping
+ * @return bool true if the target was found and is up to date
+ */
+bool read_cached_features(const feature_cache &cache, model_target &target) {
+  auto it = cache.entries.find(target.name);
+  if(it == cache.entries.end()) return false;
+
+  const cache_header *header = (const cache_header *) cache.data;
+  const cache_entry &entry = ((const cache_entry *) (cache.data + sizeof(cache_header)))[it->second];
+  if(entry.mtime != target.mtime || entry.file_size != target.file_size || entry.num_keypoints == 0) return false;
+
+  const cache_keypoint *keypoints = (const cache_keypoint *) (cache.data + entry.keypoint_offset);
+  target.keypoints.resize(entry.num_keypoints);
+  for(int i = 0; i < entry.num_keypoints; i++) {
+    const cache_keypoint &kp = keypoints[i];
+    target.keypoints[i] = cv::KeyPoint(kp.x, kp.y, kp.size, kp.angle, kp.response, kp.octave, kp.class_id);
+  }
+
+  // The descriptors stay in the mapping, which is read-only
+  target.descriptors = cv::Mat((int) entry.num_keypoints, (int) header->desc_bytes, CV_8U,
+                               (void *) (cache.data + entry.desc_offset));
+  target.size = cv::Size(entry.width, entry.height);
+  return true;
+}
+
+/**
+ * @brief Function to write the keypoints and descriptors of the targets to a cache file. The file is
+ * written next to the old one and renamed over it, so processes that mapped the old one keep working.
+ *
+ * @param filename cache file
+ * @param detector ORB detector the features were found with
+ * @param targets targets to save
+ * @return int return non-zero value on failure
+ */
+int save_feature_cache(const std::string &filename, cv::Ptr<cv::ORB> detector, const std::vector<model_target> &targets) {
+  if(targets.empty()) return -1;
+
+  // Lay out the file before writing it
+  cache_header header;
+  memset(&header, 0, sizeof(header));
+  header.magic = FEATURE_CACHE_MAGIC;
+  header.version = FEATURE_CACHE_VERSION;
+  header.detector_hash = hash_detector(detector);
+  header.num_entries = (uint32_t) targets.size();
+  header.desc_bytes = (uint32_t) targets[0].descriptors.cols;
+
+  std::vector<cache_entry> table(targets.size());
+  uint64_t offset = sizeof(cache_header) + table.size() * sizeof(cache_entry);
+  for(int t = 0; t < targets.size(); t++) {
+    if(targets[t].descriptors.cols != header.desc_bytes || targets[t].descriptors.type() != CV_8U ||
+       targets[t].descriptors.rows != targets[t].keypoints.size()) return -1;
+    memset(&table[t], 0, sizeof(cache_entry));
+    table[t].name_offset = offset;
+    table[t].name_len = (uint32_t) targets[t].name.size();
+    offset += table[t].name_len;
+  }
+  for(int t = 0; t < targets.size(); t++) {
+    offset = align8(offset);
+    table[t].keypoint_offset = offset;
+    table[t].num_keypoints = (uint32_t) targets[t].keypoints.size();
+    offset += table[t].num_keypoints * sizeof(cache_keypoint);
+  }
+  for(int t = 0; t < targets.size(); t++) {
+    offset = align8(offset);
+    table[t].desc_offset = offset;
+    offset += (uint64_t) table[t].num_keypoints * header.desc_bytes;
+    table[t].mtime = targets[t].mtime;
+    table[t].file_size = targets[t].file_size;
+    table[t].width = targets[t].size.width;
+    table[t].height = targets[t].size.height;
+  }
+  header.file_size = offset;
+
+  std::string tmp_name = filename + ".tmp." + std::to_string((long) getpid());
+  FILE *fp = fopen(tmp_name.c_str(), "wb");
+  if(!fp) {
+    printf("Unable to open output file %s\n", tmp_name.c_str());
+    return -1;
+  }
+
+  // Pad up to each aligned offset with zeros
+  uint64_t written = 0;
+  const uchar zero[8] = { 0 };
+  auto pad_to = [&](uint64_t target_offset) {
+    if(target_offset > written) {
+      std::fwrite(zero, 1, target_offset - written, fp);
+      written = target_offset;
+    }
+  };
+
+  std::fwrite(&header, sizeof(header), 1, fp);
+  std::fwrite(table.data(), sizeof(cache_entry), table.size(), fp);
+  written = sizeof(header) + table.size() * sizeof(cache_entry);
+  for(int t = 0; t < targets.size(); t++) {
+    std::fwrite(targets[t].name.data(), 1, targets[t].name.size(), fp);
+    written += targets[t].name.size();
+  }
+  for(int t = 0; t < targets.size(); t++) {
+    pad_to(table[t].keypoint_offset);
+    std::vector<cache_keypoint> keypoints(targets[t].keypoints.size());
+    for(int i = 0; i < keypoints.size(); i++) {
+      const cv::KeyPoint &kp = targets[t].keypoints[i];
+      cache_keypoint &out = keypoints[i];
+      out.x = kp.pt.x;
+      out.y = kp.pt.y;
+      out.size = kp.size;
+      out.angle = kp.angle;
+      out.response = kp.response;
+      out.octave = kp.octave;
+      out.class_id = kp.class_id;
+    }
+    if(!keypoints.empty()) std::fwrite(keypoints.data(), sizeof(cache_keypoint), keypoints.size(), fp);
+    written += keypoints.size() * sizeof(cache_keypoint);
+  }
+  for(int t = 0; t < targets.size(); t++) {
+    pad_to(table[t].desc_offset);
+    const cv::Mat &desc = targets[t].descriptors;
+    for(int r = 0; r < desc.rows; r++) {
+      std::fwrite(desc.ptr<uchar>(r), 1, header.desc_bytes, fp);
+    }
+    written += (uint64_t) desc.rows * header.desc_bytes;
+  }
+
+  bool ok = std::ferror(fp) == 0;
+  ok = fclose(fp) == 0 && ok;
+  if(!ok || rename(tmp_name.c_str(), filename.c_str()) != 0) {
+    printf("Unable to write feature cache %s\n", filename.c_str());
+    unlink(tmp_name.c_str());
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file frame_governor.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Adapts the detector's feature count, pyramid and resolution to keep the frame time under a budget
+ * @date 2026-10-17
+ */
+
+#include <algorithm>
+#include "../include/frame_governor.h"
+
+/**
+ * @brief Quality levels relative to the detector's own settings, best first. Features and pyramid levels
+ * go first since they cost less accuracy than the resolution does.
+ */
+static const struct {
+  float features; // fraction of the detector's feature count
+  int nlevels; // most pyramid levels
+  float scale; // processing resolution
+} ladder[] = {
+  {1.0f, 8, 1.0f},
+  {0.8f, 8, 1.0f},
+  {0.6f, 6, 1.0f},
+  {0.6f, 6, 0.75f},
+  {0.5f, 5, 0.75f},
+  {0.4f, 4, 0.5f},
+};
+
+/**
+ * @brief Function to set up a governor, the best quality level being the ORB detector's settings
+ *
+ * @param gov governor to set up
+ * @param budget_ms frame time to stay under in milliseconds
+ * @param orb ORB detector whose settings are the best quality level
+ */
+void governor_init(frame_governor &gov, double budget_ms, cv::Ptr<cv::ORB> orb) {
+  gov.budget_ms = budget_ms > 0 ? budget_ms : GOVERNOR_DEFAULT_BUDGET_MS;
+  gov.levels.clear();
+  for(int i = 0; i < sizeof(ladder) / sizeof(ladder[0]); i++) {
+    governor_level level;
+    level.nfeatures = std::max(1, cvRound(orb->getMaxFeatures() * ladder[i].features));
+    level.nlevels = std::max(1, std::min(orb->getNLevels(), ladder[i].nlevels));
+    level.scale = ladder[i].scale;
+    gov.levels.push_back(level);
+  }
+  gov.level = 0;
+  gov.avg_ms = 0;
+  gov.frames = 0;
+  gov.hold = GOVERNOR_HOLD_FRAMES;
+}
+
+/**
+ * @brief Function to add the time a frame took and pick the level for the next one
+ *
+ * @param gov governor
+ * @param frame_ms time the frame took in milliseconds
+ * @return bool true if the level changed
+ */
+bool governor_update(frame_governor &gov, double frame_ms) {
+  gov.avg_ms = gov.frames == 0 ? frame_ms : (1 - GOVERNOR_SMOOTHING) * gov.avg_ms + GOVERNOR_SMOOTHING * frame_ms;
+  gov.frames++;
+  if(gov.hold > 0) {
+    gov.hold--;
+    return false;
+  }
+
+  // Over the budget, step down. Well under it, step back up, but wait longer after that so one slow
+  // frame right after doesn't send it straight back down.
+  if(gov.avg_ms > gov.budget_ms && gov.level + 1 < gov.levels.size()) {
+    gov.level++;
+    gov.hold = GOVERNOR_HOLD_FRAMES;
+    return true;
+  }
+  if(gov.avg_ms < GOVERNOR_HEADROOM * gov.budget_ms && gov.level > 0) {
+    gov.level--;
+    gov.hold = GOVERNOR_RAISE_HOLD_FRAMES;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Function to get the settings of the level in use
+ *
+ * @param gov governor
+ * @return const governor_level& settings to process the next frame with
+ */
+const governor_level &governor_current(const frame_governor &gov) {
+  static const governor_level full;
+  if(gov.levels.empty()) return full;
+  return gov.levels[gov.level];
+}
+
+/**
+ * @brief Function to set the detectors to the level in use
+ *
+ * @param gov governor
+ * @param orb ORB detector
+ * @param tiled tiled extractor set up from the ORB detector, nullptr if there's none
+ */
+void governor_apply(const frame_governor &gov, cv::Ptr<cv::ORB> orb, tiled_orb *tiled) {
+  const governor_level &level = governor_current(gov);
+  orb->setMaxFeatures(level.nfeatures);
+  orb->setNLevels(level.nlevels);
+  if(tiled != nullptr) tiled_orb_init(*tiled, orb);
+}
@@ -0,0 +1,108 @@
+/**
+ * @file frame_source.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Reads frames from a video file or an image directory so the tracker can run without a camera
+ * @date 2026-10-17
+ */
+
+#include <algorithm>
+#include "../include/frame_source.h"
+
+/**
+ * @brief Function to open a video file or an image directory
+ *
+ * @param path path of the video file or directory
+ * @param src output frame source
+ * @return int return non-zero value on failure
+ */
+int open_frame_source(const std::string &path, frame_source &src) {
+  src.paths.clear();
+  src.next = 0;
+  src.is_dir = false;
+  src.path = path;
+
+  DIR *dp = opendir(path.c_str());
+  if(dp != nullptr) {
+    std::string dirname = path;
+    if(dirname.back() != '/') dirname += "/";
+    struct dirent *entry = nullptr;
+    while ((entry = readdir(dp))) {
+      std::string name = entry->d_name;
+      if(name.empty() || name[0] == '.') continue; // skip . and .. and the feature cache
+      src.paths.push_back(dirname + name);
+    }
+    closedir(dp);
+    std::sort(src.paths.begin(), src.paths.end());
+    src.is_dir = true;
+    return src.paths.empty() ? -1 : 0;
+  }
+
+  if(!src.cap.open(path)) {
+    printf("Unable to open %s\n", path.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Function to read the next frame
+ *
+ * @param src frame source
+ * @param frame output color frame
+ * @return bool false once there are no frames left
+ */
+bool next_frame(frame_source &src, cv::Mat &frame) {
+  if(!src.is_dir) {
+    src.cap >> frame;
+    return !frame.empty();
+  }
+
+  // Skip anything in the directory that isn't an image
+  while(src.next < src.paths.size()) {
+    frame = cv::imread(src.paths[src.next++], cv::IMREAD_COLOR);
+    if(!frame.empty()) return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Function to get the number of frames in the source
+ *
+ * @param src frame source
+ * @return int number of frames, 0 if the video doesn't say
+ */
+int frame_count(frame_source &src) {
+  if(src.is_dir) return (int) src.paths.size();
+  double count = src.cap.get(cv::CAP_PROP_FRAME_COUNT);
+  return count > 0 ? (int) count : 0;
+}
+
+/**
+ * @brief Function to move the source so next_frame reads the given frame. Videos that can't seek
+ * exactly are read from the start up to the frame instead.
+ *
+ * @param src frame source
+ * @param index index of the frame to read next
+ * @return int return non-zero value on failure
+ */
+int seek_frame(frame_source &src, int index) {
+  if(index < 0) return -1;
+  if(src.is_dir) {
+    if(index > src.paths.size()) return -1;
+    src.next = index;
+    return 0;
+  }
+
+  // Seeking lands on a keyframe with some codecs, so check where it ended up
+  if(src.cap.set(cv::CAP_PROP_POS_FRAMES, index) && (int) src.cap.get(cv::CAP_PROP_POS_FRAMES) == index) {
+    return 0;
+  }
+  if(!src.cap.open(src.path)) {
+    printf("Unable to open %s\n", src.path.c_str());
+    return -1;
+  }
+  for(int i = 0; i < index; i++) {
+    if(!src.cap.grab()) return -1;
+  }
+  return 0;
+}
@@ -35,6 +35,8 @@ int main(int argc, char *argv[]) {
   cv::Mat dst; 
   cv::Mat gray; 
   cv::Mat prev_image; 
+  luma_pyramid pyr; // grayscale frame ORB runs on
+  cv::Ptr<cv::ORB> orb = cv::ORB::create(); 
   
   for(;;) {
     *capdev >> frame; // get a new frame from the camera, treat as a stream
@@ -45,13 +47,11 @@ int main(int argc, char *argv[]) {
 
     frame.copyTo(gray);
     
-    cv::Ptr<cv::ORB> orb = cv::ORB::create(); 
-    
-    // Convert to grayscale
-    //cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY); 
+    // Convert to grayscale once, ORB would otherwise convert the color frame itself
+    luma_pyramid_build(pyr, frame); 
     std::vector<cv::KeyPoint> keypoints; 
     cv::Mat descriptors; 
-    orb->detectAndCompute( frame, cv::noArray(), keypoints, descriptors );
+    orb->detectAndCompute( pyr.gray, cv::noArray(), keypoints, descriptors );
     cv::drawKeypoints(frame, keypoints, dst); 
     cv::imshow(winName, dst);
 
@@ -0,0 +1,333 @@
+/**
+ * @file hamming_match.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Brute force and lsh matching of binary descriptors by hamming distance
+ * @date 2026-10-17
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+#include "../include/hamming_match.h"
+
+/**
+ * @brief Function to compute the hamming distance between two 32 byte descriptors (ORB)
+ *
+ * @param a first descriptor
+ * @param b second descriptor
+ * @return int number of bits that differ
+ */
+static inline int hamming_32(const uchar *a, const uchar *b) {
+#if defined(__AVX2__)
+  // Nibble lookup popcount over the whole descriptor in one register
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) a), _mm256_loadu_si256((const __m256i *) b));
+  __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, low_mask));
+  __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask));
+  __m256i sad = _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+  __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sad), _mm256_extracti128_si256(sad, 1));
+  return _mm_cvtsi128_si32(sum) + _mm_extract_epi32(sum, 2);
+#elif defined(__aarch64__)
+  uint8x16_t x0 = veorq_u8(vld1q_u8(a), vld1q_u8(b));
+  uint8x16_t x1 = veorq_u8(vld1q_u8(a + 16), vld1q_u8(b + 16));
+  return vaddvq_u8(vcntq_u8(x0)) + vaddvq_u8(vcntq_u8(x1));
+#else
+  uint64_t wa[4], wb[4];
+  memcpy(wa, a, 32);
+  memcpy(wb, b, 32);
+  return __builtin_popcountll(wa[0] ^ wb[0]) + __builtin_popcountll(wa[1] ^ wb[1]) +
+         __builtin_popcountll(wa[2] ^ wb[2]) + __builtin_popcountll(wa[3] ^ wb[3]);
+#endif
+}
+
+/**
+ * @brief Function to compute the hamming distance between two binary descriptors
+ *
+ * @param a first descriptor
+ * @param b second descriptor
+ * @param nbytes length of the descriptors in bytes
+ * @return int number of bits that differ
+ */
+int hamming_distance(const uchar *a, const uchar *b, int nbytes) {
+  if(nbytes == 32) return hamming_32(a, b);
+
+  int dist = 0;
+  int i = 0;
+  for(; i + 8 <= nbytes; i += 8) {
+    uint64_t wa, wb;
+    memcpy(&wa, a + i, 8);
+    memcpy(&wb, b + i, 8);
+    dist += __builtin_popcountll(wa ^ wb);
+  }
+  for(; i < nbytes; i++) {
+    dist += __builtin_popcount((unsigned int) (a[i] ^ b[i]));
+  }
+  return dist;
+}
+
+/**
+ * @brief Function to compute the lsh key of a descriptor for one table
+ *
+ * @param desc descriptor
+ * @param bits bit positions sampled by the table
+ * @return int key of the descriptor
+ */
+static inline int lsh_key(const uchar *desc, const std::vector<int> &bits) {
+  int key = 0;
+  for(int i = 0; i < bits.size(); i++) {
+    int bit = bits[i];
+    key |= ((desc[bit >> 3] >> (bit & 7)) & 1) << i;
+  }
+  return key;
+}
+
+/**
+ * @brief Function to build the index over a set of binary descriptors
+ *
+ * @param descriptors CV_8U descriptors to index, one per row
+ * @param index output index
+ * @param lsh_min_size number of descriptors at which to switch from brute force to lsh
+ * @return int return non-zero value on failure
+ */
+int build_hamming_index(const cv::Mat &descriptors, hamming_index &index, int lsh_min_size) {
+  index = hamming_index();
+  if(descriptors.empty()) return -1;
+  if(descriptors.type() != CV_8U) {
+    printf("hamming index needs CV_8U descriptors\n");
+    return -1;
+  }
+
+  index.descriptors = descriptors.isContinuous() ? descriptors : descriptors.clone();
+  index.use_lsh = descriptors.rows >= lsh_min_size;
+  if(!index.use_lsh) return 0;
+
+  const int nbits = descriptors.cols * 8;
+  const int nbuckets = 1 << HAMMING_LSH_KEY_BITS;
+  cv::RNG rng(0x15f);
+
+  index.key_bits.resize(HAMMING_LSH_TABLES);
+  index.bucket_start.resize(HAMMING_LSH_TABLES);
+  index.bucket_items.resize(HAMMING_LSH_TABLES);
+  for(int t = 0; t < HAMMING_LSH_TABLES; t++) {
+    // Sample distinct bits for the key
+    std::vector<int> bits(nbits);
+    for(int i = 0; i < nbits; i++) bits[i] = i;
+    for(int i = 0; i < HAMMING_LSH_KEY_BITS; i++) {
+      std::swap(bits[i], bits[rng.uniform(i, nbits)]);
+    }
+    bits.resize(HAMMING_LSH_KEY_BITS);
+    index.key_bits[t] = bits;
+
+    // Counting sort the rows into buckets
+    std::vector<int> keys(descriptors.rows);
+    std::vector<int> &start = index.bucket_start[t];
+    start.assign(nbuckets + 1, 0);
+    for(int i = 0; i < descriptors.rows; i++) {
+      keys[i] = lsh_key(index.descriptors.ptr<uchar>(i), bits);
+      start[keys[i] + 1]++;
+    }
+    for(int b = 0; b < nbuckets; b++) start[b + 1] += start[b];
+
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    std::vector<int> &items = index.bucket_items[t];
+    items.resize(descriptors.rows);
+    for(int i = 0; i < descriptors.rows; i++) {
+      items[fill[keys[i]]++] = i;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Function to find the two nearest neighbours of every query descriptor and keep the
+ * ones that pass Lowe's ratio test. queryIdx is the row in desc_query and trainIdx the row in the index.
+ *
+ * @param index index over the train descriptors
+ * @param desc_query CV_8U query descriptors, one per row
+ * @param ratio ratio the best distance has to be under compared to the second best
+ * @param matches output vector of the matches that passed the ratio test
+ * @param visited scratch buffer to reuse for the lsh probes, nullptr to allocate one
+ */
+void hamming_knn2_ratio(const hamming_index &index, const cv::Mat &desc_query, float ratio, std::vector<cv::DMatch> &matches,
+                        std::vector<int> *visited) {
+  const cv::Mat &train = index.descriptors;
+  if(train.empty() || desc_query.empty() || desc_query.cols != train.cols || desc_query.type() != CV_8U) return;
+  const int nbytes = train.cols;
+
+  // rows already compared for the current query when probing lsh buckets
+  std::vector<int> local;
+  std::vector<int> &seen = visited != nullptr ? *visited : local;
+  if(index.use_lsh) seen.assign(train.rows, -1);
+
+  for(int q = 0; q < desc_query.rows; q++) {
+    const uchar *query = desc_query.ptr<uchar>(q);
+    int best = INT_MAX;
+    int second = INT_MAX;
+    int best_idx = -1;
+
+    if(!index.use_lsh) {
+      for(int i = 0; i < train.rows; i++) {
+        int d = hamming_distance(query, train.ptr<uchar>(i), nbytes);
+        if(d < best) {
+          second = best;
+          best = d;
+          best_idx = i;
+        } else if(d < second) {
+          second = d;
+        }
+      }
+    } else {
+      for(int t = 0; t < index.key_bits.size(); t++) {
+        const std::vector<int> &start = index.bucket_start[t];
+        const std::vector<int> &items = index.bucket_items[t];
+        int key = lsh_key(query, index.key_bits[t]);
+
+        // Probe the key itself and every key one bit flip away
+        for(int flip = -1; flip < HAMMING_LSH_KEY_BITS; flip++) {
+          int probe = flip < 0 ? key : key ^ (1 << flip);
+          for(int j = start[probe]; j < start[probe + 1]; j++) {
+            int i = items[j];
+            if(seen[i] == q) continue;
+            seen[i] = q;
+            int d = hamming_distance(query, train.ptr<uchar>(i), nbytes);
+            if(d < best) {
+              second = best;
+              best = d;
+              best_idx = i;
+            } else if(d < second) {
+              second = d;
+            }
+          }
+        }
+      }
+    }
+
+    // Lowe's ratio test, which needs a second neighbour to compare against
+    if(best_idx >= 0 && second != INT_MAX && best < ratio * second) {
+      matches.push_back(cv::DMatch(q, best_idx, (float) best));
+    }
+  }
+}
+
+/**
+ * @brief Function to put keypoints in a uniform grid. The buffers of the grid are reused.
+ *
+ * @param keypoints keypoints to put in the grid
+ * @param cell_size side of a cell in pixels, searches within this radius only visit the 3x3 cells around a position
+ * @param grid output grid
+ */
+void build_keypoint_grid(const std::vector<cv::KeyPoint> &keypoints, float cell_size, keypoint_grid &grid) {
+  grid.cell_size = std::max(1.0f, cell_size);
+  grid.pts.resize(keypoints.size());
+  grid.cell_of.resize(keypoints.size());
+  grid.cell_items.resize(keypoints.size());
+  if(keypoints.empty()) {
+    grid.cols = grid.rows = 0;
+    grid.cell_start.assign(1, 0);
+    return;
+  }
+
+  // The grid only covers the keypoints' bounding box, which is small when they came from a region of the frame
+  float min_x = keypoints[0].pt.x, max_x = min_x;
+  float min_y = keypoints[0].pt.y, max_y = min_y;
+  for(int i = 0; i < keypoints.size(); i++) {
+    grid.pts[i] = keypoints[i].pt;
+    min_x = std::min(min_x, keypoints[i].pt.x);
+    max_x = std::max(max_x, keypoints[i].pt.x);
+    min_y = std::min(min_y, keypoints[i].pt.y);
+    max_y = std::max(max_y, keypoints[i].pt.y);
+  }
+  grid.origin = cv::Point2f(min_x, min_y);
+  grid.cols = (int) ((max_x - min_x) / grid.cell_size) + 1;
+  grid.rows = (int) ((max_y - min_y) / grid.cell_size) + 1;
+
+  // Counting sort the keypoints into cells
+  std::vector<int> &start = grid.cell_start;
+  start.assign(grid.cols * grid.rows + 1, 0);
+  for(int i = 0; i < keypoints.size(); i++) {
+    int cx = (int) ((grid.pts[i].x - min_x) / grid.cell_size);
+    int cy = (int) ((grid.pts[i].y - min_y) / grid.cell_size);
+    grid.cell_of[i] = cy * grid.cols + cx;
+    start[grid.cell_of[i] + 1]++;
+  }
+  for(int c = 0; c < grid.cols * grid.rows; c++) start[c + 1] += start[c];
+
+  // Fill each cell from its end so no second offsets array is needed, afterwards start[c + 1] is where cell c begins
+  int ncells = grid.cols * grid.rows;
+  for(int i = (int) keypoints.size() - 1; i >= 0; i--) {
+    grid.cell_items[--start[grid.cell_of[i] + 1]] = i;
+  }
+  for(int c = 0; c < ncells; c++) start[c] = start[c + 1];
+  start[ncells] = (int) keypoints.size();
+}
+
+/**
+ * @brief Function to match every query descriptor only against the train keypoints within a radius of
+ * where it's expected to be. Matches further than max_dist are dropped, and ones with a second
+ * neighbour in the radius also have to pass Lowe's ratio test. queryIdx is the row in desc_query and
+ * trainIdx the row in desc_train.
+ *
+ * @param desc_query CV_8U query descriptors, one per row
+ * @param query_pts expected position of every query descriptor among the train keypoints
+ * @param desc_train CV_8U train descriptors, one per keypoint in the grid
+ * @param grid grid over the train keypoints
+ * @param radius distance in pixels from the expected position searched, at most the grid's cell size
+ * @param ratio ratio the best distance has to be under compared to the second best
+ * @param matches output vector of the matches that passed
+ * @param max_dist largest distance of a match that's kept
+ */
+void hamming_guided_ratio(const cv::Mat &desc_query, const std::vector<cv::Point2f> &query_pts, const cv::Mat &desc_train,
+                          const keypoint_grid &grid, float radius, float ratio, std::vector<cv::DMatch> &matches,
+                          int max_dist) {
+  if(desc_query.empty() || desc_train.empty() || grid.cols == 0) return;
+  if(desc_query.cols != desc_train.cols || desc_query.type() != CV_8U || desc_train.type() != CV_8U) return;
+  if(query_pts.size() != desc_query.rows || grid.pts.size() != desc_train.rows) return;
+  const int nbytes = desc_train.cols;
+  radius = std::min(radius, grid.cell_size);
+  const float radius2 = radius * radius;
+
+  for(int q = 0; q < desc_query.rows; q++) {
+    const cv::Point2f &p = query_pts[q];
+    if(!std::isfinite(p.x) || !std::isfinite(p.y)) continue;
+    int cx = cvFloor((p.x - grid.origin.x) / grid.cell_size);
+    int cy = cvFloor((p.y - grid.origin.y) / grid.cell_size);
+    if(cx < -1 || cy < -1 || cx > grid.cols || cy > grid.rows) continue;
+
+    const uchar *query = desc_query.ptr<uchar>(q);
+    int best = INT_MAX;
+    int second = INT_MAX;
+    int best_idx = -1;
+
+    // The radius is at most a cell, so the neighbours are all in the 3x3 cells around the position
+    for(int y = std::max(0, cy - 1); y <= std::min(grid.rows - 1, cy + 1); y++) {
+      for(int x = std::max(0, cx - 1); x <= std::min(grid.cols - 1, cx + 1); x++) {
+        int c = y * grid.cols + x;
+        for(int j = grid.cell_start[c]; j < grid.cell_start[c + 1]; j++) {
+          int i = grid.cell_items[j];
+          cv::Point2f d = grid.pts[i] - p;
+          if(d.x * d.x + d.y * d.y > radius2) continue;
+          int dist = hamming_distance(query, desc_train.ptr<uchar>(i), nbytes);
+          if(dist < best) {
+            second = best;
+            best = dist;
+            best_idx = i;
+          } else if(dist < second) {
+            second = dist;
+          }
+        }
+      }
+    }
+
+    if(best_idx < 0) continue;
+    if(best <= max_dist && (second == INT_MAX || best < ratio * second)) matches.push_back(cv::DMatch(q, best_idx, (float) best));
+  }
+}
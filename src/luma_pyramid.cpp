@@ -0,0 +1,197 @@
+/**
+ * @file luma_pyramid.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Converts each frame to grayscale once and keeps the pyramids that detection, tracking and calibration share
+ * @date 2026-10-17
+ */
+
+#include <algorithm>
+#include <opencv2/core/hal/intrin.hpp>
+#include "../include/luma_pyramid.h"
+#include "../include/metrics.h"
+
+/**
+ * @brief Function to set the scales of a pyramid
+ *
+ * @param pyr pyramid to set up
+ * @param nlevels number of scale levels
+ * @param scale_factor ratio between the size of one level and the next
+ */
+void luma_pyramid_init(luma_pyramid &pyr, int nlevels, float scale_factor) {
+  pyr.nlevels = std::max(1, nlevels);
+  pyr.scale_factor = scale_factor;
+  pyr.have_levels = false;
+}
+
+/**
+ * @brief Function to convert one row of a BGR frame to luma
+ *
+ * @param src row of BGR pixels
+ * @param dst output row of luma
+ * @param cols pixels in the row
+ */
+static void luma_row(const uchar *src, uchar *dst, int cols) {
+  int x = 0;
+#if CV_SIMD128
+  // Blue and green are paired in one multiply-add, red is paired with 1 to add the rounding
+  const cv::v_int16x8 bg_weights(LUMA_B, LUMA_G, LUMA_B, LUMA_G, LUMA_B, LUMA_G, LUMA_B, LUMA_G);
+  const cv::v_int16x8 r_weights(LUMA_R, 1 << (LUMA_SHIFT - 1), LUMA_R, 1 << (LUMA_SHIFT - 1),
+                                LUMA_R, 1 << (LUMA_SHIFT - 1), LUMA_R, 1 << (LUMA_SHIFT - 1));
+  const cv::v_int16x8 one = cv::v_setall_s16(1);
+  for(; x <= cols - 16; x += 16) {
+    cv::v_uint8x16 b, g, r;
+    cv::v_load_deinterleave(src + 3 * x, b, g, r);
+
+    cv::v_uint16x8 b0, b1, g0, g1, r0, r1;
+    cv::v_expand(b, b0, b1);
+    cv::v_expand(g, g0, g1);
+    cv::v_expand(r, r0, r1);
+
+    cv::v_int16x8 bg0, bg1, bg2, bg3, r1_0, r1_1, r1_2, r1_3;
+    cv::v_zip(cv::v_reinterpret_as_s16(b0), cv::v_reinterpret_as_s16(g0), bg0, bg1);
+    cv::v_zip(cv::v_reinterpret_as_s16(b1), cv::v_reinterpret_as_s16(g1), bg2, bg3);
+    cv::v_zip(cv::v_reinterpret_as_s16(r0), one, r1_0, r1_1);
+    cv::v_zip(cv::v_reinterpret_as_s16(r1), one, r1_2, r1_3);
+
+    cv::v_int32x4 y0 = cv::v_shr<LUMA_SHIFT>(cv::v_dotprod(bg0, bg_weights) + cv::v_dotprod(r1_0, r_weights));
+    cv::v_int32x4 y1 = cv::v_shr<LUMA_SHIFT>(cv::v_dotprod(bg1, bg_weights) + cv::v_dotprod(r1_1, r_weights));
+    cv::v_int32x4 y2 = cv::v_shr<LUMA_SHIFT>(cv::v_dotprod(bg2, bg_weights) + cv::v_dotprod(r1_2, r_weights));
+    cv::v_int32x4 y3 = cv::v_shr<LUMA_SHIFT>(cv::v_dotprod(bg3, bg_weights) + cv::v_dotprod(r1_3, r_weights));
+    cv::v_store(dst + x, cv::v_pack_u(cv::v_pack(y0, y1), cv::v_pack(y2, y3)));
+  }
+#endif
+  for(; x < cols; x++) {
+    const uchar *p = src + 3 * x;
+    dst[x] = (uchar) ((p[0] * LUMA_B + p[1] * LUMA_G + p[2] * LUMA_R + (1 << (LUMA_SHIFT - 1))) >> LUMA_SHIFT);
+  }
+}
+
+/**
+ * @brief Function to convert a BGR frame to luma in one vectorized pass, giving the same result as
+ * cv::cvtColor with COLOR_BGR2GRAY. Grayscale frames are copied and BGRA frames go through cvtColor.
+ *
+ * @param bgr color frame
+ * @param gray output grayscale frame
+ */
+void luma_from_bgr(const cv::Mat &bgr, cv::Mat &gray) {
+  if(bgr.type() == CV_8UC1) {
+    bgr.copyTo(gray);
+    return;
+  }
+  if(bgr.type() != CV_8UC3) {
+    cv::cvtColor(bgr, gray, cv::COLOR_BGRA2GRAY);
+    return;
+  }
+
+  gray.create(bgr.rows, bgr.cols, CV_8UC1);
+  cv::parallel_for_(cv::Range(0, bgr.rows), [&](const cv::Range &range) {
+    for(int y = range.start; y < range.end; y++) {
+      luma_row(bgr.ptr<uchar>(y), gray.ptr<uchar>(y), bgr.cols);
+    }
+  });
+}
+
+/**
+ * @brief Function to start the pyramid of a new color frame
+ *
+ * @param pyr pyramid
+ * @param frame BGR frame
+ * @param scale processing resolution as a fraction of the frame's, gray is shrunk to it when it's under 1
+ */
+void luma_pyramid_build(luma_pyramid &pyr, const cv::Mat &frame, float scale) {
+  scoped_timer timer(STAGE_GRAYSCALE);
+  if(pyr.borrowed) pyr.gray.release(); // don't write over the caller's frame
+  pyr.borrowed = false;
+  if(scale < 1) {
+    luma_from_bgr(frame, pyr.full);
+    cv::Size size(std::max(1, cvRound(frame.cols * scale)), std::max(1, cvRound(frame.rows * scale)));
+    cv::resize(pyr.full, pyr.gray, size, 0, 0, cv::INTER_AREA);
+  } else {
+    luma_from_bgr(frame, pyr.gray);
+  }
+  pyr.have_levels = false;
+  pyr.have_flow = false;
+}
+
+/**
+ * @brief Function to start the pyramid of a frame that's already grayscale, without copying it
+ *
+ * @param pyr pyramid
+ * @param gray grayscale frame, it has to stay unchanged while the pyramid is used
+ */
+void luma_pyramid_set_gray(luma_pyramid &pyr, const cv::Mat &gray) {
+  pyr.gray = gray;
+  pyr.borrowed = true;
+  pyr.have_levels = false;
+  pyr.have_flow = false;
+}
+
+/**
+ * @brief Function to get the scale levels of the pyramid, building them if they haven't been yet
+ *
+ * @param pyr pyramid
+ * @return const std::vector<cv::Mat>& nlevels images, levels[0] is the full size luma
+ */
+const std::vector<cv::Mat> &luma_pyramid_levels(luma_pyramid &pyr) {
+  if(pyr.have_levels) return pyr.levels;
+
+  // Each level is resized from the one before it, like ORB's own pyramid
+  pyr.levels.resize(pyr.nlevels);
+  pyr.levels[0] = pyr.gray;
+  float scale = 1;
+  for(int level = 1; level < pyr.nlevels; level++) {
+    scale *= pyr.scale_factor;
+    cv::Size size(cvRound(pyr.gray.cols / scale), cvRound(pyr.gray.rows / scale));
+    cv::resize(pyr.levels[level - 1], pyr.levels[level], size, 0, 0, cv::INTER_LINEAR);
+  }
+  pyr.have_levels = true;
+  return pyr.levels;
+}
+
+/**
+ * @brief Function to get the optical flow levels of the pyramid, building them if they haven't been yet
+ *
+ * @param pyr pyramid
+ * @param win_size optical flow search window, sets the border around each level
+ * @param max_level index of the smallest level
+ * @return const std::vector<cv::Mat>& levels to pass to calcOpticalFlowPyrLK
+ */
+const std::vector<cv::Mat> &luma_pyramid_flow(luma_pyramid &pyr, cv::Size win_size, int max_level) {
+  if(pyr.have_flow && pyr.flow_win == win_size && pyr.flow_max_level == max_level) return pyr.flow;
+
+  // Without the derivatives, calcOpticalFlowPyrLK computes them on the levels it actually visits
+  cv::buildOpticalFlowPyramid(pyr.gray, pyr.flow, win_size, max_level, false);
+  pyr.flow_win = win_size;
+  pyr.flow_max_level = max_level;
+  pyr.have_flow = true;
+  return pyr.flow;
+}
+
+/**
+ * @brief Function to copy optical flow levels along with their borders, reusing the buffers of the copy
+ *
+ * @param src optical flow levels
+ * @param dst output copy
+ */
+void copy_flow_pyramid(const std::vector<cv::Mat> &src, std::vector<cv::Mat> &dst) {
+  dst.resize(src.size());
+  for(int i = 0; i < src.size(); i++) {
+    // The levels are views into bigger buffers, the border around them is part of what's copied
+    cv::Size whole;
+    cv::Point ofs;
+    src[i].locateROI(whole, ofs);
+    cv::Mat src_whole = src[i];
+    src_whole.adjustROI(ofs.y, whole.height - src[i].rows - ofs.y, ofs.x, whole.width - src[i].cols - ofs.x);
+
+    cv::Mat dst_whole;
+    if(!dst[i].empty()) {
+      cv::Size dst_size;
+      cv::Point dst_ofs;
+      dst[i].locateROI(dst_size, dst_ofs);
+      dst_whole = dst[i];
+      dst_whole.adjustROI(dst_ofs.y, dst_size.height - dst[i].rows - dst_ofs.y, dst_ofs.x, dst_size.width - dst[i].cols - dst_ofs.x);
+    }
+    src_whole.copyTo(dst_whole);
+    dst[i] = dst_whole(cv::Rect(ofs.x, ofs.y, src[i].cols, src[i].rows));
+  }
+}
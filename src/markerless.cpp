@@ -6,40 +6,30 @@
  */
 
 #include "../include/markerless.h" 
-#define AVG_COUNT 10
-
-std::vector<cv::Mat> homography_avg; 
-int avg_counter = 0; 
+#include "../include/metrics.h" 
+#define RATIO_THRESH 0.75f // Lowe's ratio test threshold
+#define MIN_MATCHES 15 // matches needed to estimate a pose
 
 /**
  * @brief Function to find the model's keypoints and descriptors for those keypoints
  * 
  * @param detector ORB detector 
+ * @param path path of the model image to load
  * @param model output array for model image
  * @param keypoints output array keypoints found on the image.
  * @param descriptors descriptors for the keypoints found in the model. 
+ * @return int return non-zero value if the image could not be read.
  */
-void get_model_kp_desc(cv::Ptr<cv::ORB> detector, cv::Mat &model, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors) {
-  // Set up the variables to read the directory to find the reference image 
-  char dirname[] = "./model_images/"; // directory for the model
-  std::string dn_models = "./model_images/"; 
-  struct dirent *entry = nullptr; 
-  DIR *dp = nullptr;
-  dp = opendir(dirname); 
-  
-  if(dp != nullptr) {
-    while ((entry = readdir(dp))) {
-      std::string name = entry->d_name; 
-      if(name.compare(".") == 0 || name.compare("..") == 0) continue; 
-      std::string path = dn_models + name; 
-      cv::Mat model_raw = cv::imread(path, cv::IMREAD_GRAYSCALE);
-      cv::resize(model_raw, model, cv::Size(640, 480)); 
-      detector -> detectAndCompute( model, cv::noArray(), keypoints, descriptors); // get keypoints and descriptors from the model 
-    }
-  } else {
-    printf("Could not find directory\n"); 
-    exit(-1); 
+int get_model_kp_desc(cv::Ptr<cv::ORB> detector, const std::string &path, cv::Mat &model, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors) {
+  cv::Mat model_raw = cv::imread(path, cv::IMREAD_GRAYSCALE);
+  if(model_raw.empty()) {
+    printf("Could not read model image %s\n", path.c_str()); 
+    return -1; 
   }
+
+  cv::resize(model_raw, model, cv::Size(640, 480)); 
+  detector -> detectAndCompute( model, cv::noArray(), keypoints, descriptors); // get keypoints and descriptors from the model 
+  return 0; 
 }
 
 /**
@@ -52,6 +42,7 @@ void get_model_kp_desc(cv::Ptr<cv::ORB> detector, cv::Mat &model, std::vector<cv
  * @param enough boolean that indicates whether or not there are sufficient keypoint matches between the scene and boolean 
  */
 void match_kps(cv::Ptr<cv::DescriptorMatcher> matcher, cv::Mat &desc_scene, cv::Mat &desc_model, std::vector<cv::DMatch> &acceptable_matches, bool &enough) {
+  scoped_timer timer(STAGE_MATCH); 
   // Check if there are any descriptors in the model
   if(desc_model.empty()) {
     printf("no descriptors in model\n"); 
@@ -66,30 +57,33 @@ void match_kps(cv::Ptr<cv::DescriptorMatcher> matcher, cv::Mat &desc_scene, cv::
   } 
 
   // Help from: https://stackoverflow.com/questions/29694490/flann-error-in-opencv-3
-  // Convert to floats for the FLANN matcher
+  // Convert to floats for the FLANN matcher. Work on copies so the caller keeps the binary descriptors.
+  cv::Mat model_f = desc_model; 
+  cv::Mat scene_f = desc_scene; 
   if(desc_model.type() != CV_32F) {
-    desc_model.convertTo(desc_model, CV_32F);
+    desc_model.convertTo(model_f, CV_32F);
   }
 
   if(desc_scene.type() != CV_32F) {
-    desc_scene.convertTo(desc_scene, CV_32F);
+    desc_scene.convertTo(scene_f, CV_32F);
   }
 
   std::vector< std::vector<cv::DMatch> > knn_matches; 
 
-  matcher->knnMatch(desc_model, desc_scene, knn_matches, 2); // Match the keypoints
+  matcher->knnMatch(model_f, scene_f, knn_matches, 2); // Match the keypoints
 
   // Filter matches --> Lowe's ratio test
-  const float thresh = 0.75;  
   for(int i = 0; i < knn_matches.size(); i++) {
+    if(knn_matches[i].size() < 2) continue; 
     cv::DMatch cur_match_0 = knn_matches[i][0]; 
     cv::DMatch cur_match_1 = knn_matches[i][1]; 
-    if(cur_match_0.distance < thresh * cur_match_1.distance) {
+    if(cur_match_0.distance < RATIO_THRESH * cur_match_1.distance) {
       acceptable_matches.push_back(cur_match_0); 
     }
   }
+  metrics_count(COUNT_MATCHES, (int64_t) acceptable_matches.size()); 
 
-  if(acceptable_matches.size() < 15) {
+  if(acceptable_matches.size() < MIN_MATCHES) {
     enough = false; 
     return; 
   } 
@@ -98,21 +92,88 @@ void match_kps(cv::Ptr<cv::DescriptorMatcher> matcher, cv::Mat &desc_scene, cv::
 }
 
 /**
- * @brief Function to get the rotations and translations from the solvePnP opencv function
+ * @brief Function to match keypoints in the scene and the model by hamming distance
  * 
- * @param matches keypoint matches
+ * @param index_model hamming index over the descriptors of the model
+ * @param desc_scene input array of descriptors of keypoints in the scene
+ * @param acceptable_matches output vector of the top matches, queryIdx is the model and trainIdx the scene
+ * @param enough boolean that indicates whether or not there are sufficient keypoint matches between the scene and boolean 
+ * @param visited scratch buffer to reuse for the lsh probes, nullptr to allocate one
+ */
+void match_kps(const hamming_index &index_model, const cv::Mat &desc_scene, std::vector<cv::DMatch> &acceptable_matches, bool &enough, 
+               std::vector<int> *visited) {
+  scoped_timer timer(STAGE_MATCH); 
+  if(index_model.descriptors.empty()) {
+    printf("no descriptors in model\n"); 
+    enough = false; 
+    return; 
+  }
+
+  if(desc_scene.empty()) {
+    printf("no descriptors in scene\n"); 
+    enough = false; 
+    return; 
+  } 
+
+  // The scene is the query so the model index only has to be built once. 
+  // Swap the indices afterwards so queryIdx still points into the model.
+  size_t first = acceptable_matches.size(); 
+  hamming_knn2_ratio(index_model, desc_scene, RATIO_THRESH, acceptable_matches, visited); 
+  for(size_t i = first; i < acceptable_matches.size(); i++) {
+    std::swap(acceptable_matches[i].queryIdx, acceptable_matches[i].trainIdx); 
+  }
+  metrics_count(COUNT_MATCHES, (int64_t) (acceptable_matches.size() - first)); 
+
+  enough = acceptable_matches.size() - first >= MIN_MATCHES; 
+}
+
+/**
+ * @brief Function to match keypoints in the scene and the model when there's a prediction of where the
+ * model is. Each model keypoint is projected through the predicted homography and only compared against
+ * the scene keypoints within radius of where it lands, which also drops most outliers before the homography is found.
+ * 
+ * @param keypoints_model keypoints in the model
+ * @param desc_model descriptors of the keypoints in the model
+ * @param homography predicted homography from the model to the scene
+ * @param desc_scene input array of descriptors of keypoints in the scene
+ * @param grid grid over the keypoints in the scene
+ * @param radius pixels around each projected model keypoint that are searched
+ * @param acceptable_matches output vector of the top matches, queryIdx is the model and trainIdx the scene
+ * @param enough boolean that indicates whether or not there are sufficient keypoint matches between the scene and boolean 
+ * @param projected scratch buffer to reuse for the projected model keypoints, nullptr to allocate one
+ */
+void match_kps_guided(const std::vector<cv::KeyPoint> &keypoints_model, const cv::Mat &desc_model, const cv::Mat &homography, 
+                      const cv::Mat &desc_scene, const keypoint_grid &grid, float radius, std::vector<cv::DMatch> &acceptable_matches, 
+                      bool &enough, std::vector<cv::Point2f> *projected) {
+  scoped_timer timer(STAGE_MATCH); 
+  enough = false; 
+  if(keypoints_model.empty() || desc_model.rows != keypoints_model.size() || homography.empty() || desc_scene.empty()) return; 
+
+  std::vector<cv::Point2f> local; 
+  std::vector<cv::Point2f> &model_pts = projected != nullptr ? *projected : local; 
+  model_pts.resize(keypoints_model.size()); 
+  for(int i = 0; i < keypoints_model.size(); i++) {
+    model_pts[i] = keypoints_model[i].pt; 
+  }
+  cv::perspectiveTransform(model_pts, model_pts, homography); 
+
+  size_t first = acceptable_matches.size(); 
+  hamming_guided_ratio(desc_model, model_pts, desc_scene, grid, radius, RATIO_THRESH, acceptable_matches); 
+  metrics_count(COUNT_MATCHES, (int64_t) (acceptable_matches.size() - first)); 
+  enough = acceptable_matches.size() - first >= MIN_MATCHES; 
+}
+
+/**
+ * @brief Function to find the homography that maps the model onto the scene
+ * 
+ * @param matches keypoint matches, queryIdx is the model and trainIdx the scene
  * @param keypoints_model keypoints in the model
  * @param keypoints_scene keypoints in the scene
- * @param model the model image
- * @param rotations output array of the rotations
- * @param translations output array of the translations
- * @param cam_mat camera matrix 
- * @param dist_coeffs distortion coefficients
- * @param scene_corners output array of the corners of the surface in the scene
+ * @param inliers output mask of the matches that agree with the homography
+ * @return cv::Mat 3x3 homography, empty if one couldn't be found
  */
-void get_rots_and_trans(std::vector<cv::DMatch> &matches, std::vector<cv::KeyPoint> &keypoints_model, std::vector<cv::KeyPoint> &keypoints_scene, 
-                        cv::Mat &model, cv::Mat &rotations, cv::Mat &translations, cv::Mat cam_mat, cv::Mat dist_coeffs, std::vector<cv::Point2f> &scene_corners) {
-  
+cv::Mat get_homography(const std::vector<cv::DMatch> &matches, const std::vector<cv::KeyPoint> &keypoints_model, 
+                       const std::vector<cv::KeyPoint> &keypoints_scene, std::vector<uchar> &inliers) {
   std::vector<cv::Point2f> modelpts; 
   std::vector<cv::Point2f> scenepts; 
 
@@ -122,67 +183,117 @@ void get_rots_and_trans(std::vector<cv::DMatch> &matches, std::vector<cv::KeyPoi
     scenepts.push_back(keypoints_scene[matches[i].trainIdx].pt);
   }
 
-  cv::Mat homography = cv::findHomography(modelpts, scenepts, cv::LMEDS);
-  
-  homography_avg.push_back(homography);
-  cv::Mat true_homography(cv::Size(3, 3), CV_64F); 
-  cv::Mat homography_sums(cv::Size(3, 3), CV_64F);// potential seg fault here.  
-  if(homography_avg.size() < AVG_COUNT) {
-    for(int hom = 0; hom < homography_avg.size(); hom++) {
-      cv::Mat curHom = homography_avg[hom]; 
-      // Loop through the current homographies and add 
-      for(int i = 0; i < curHom.rows; i++) {
-        for(int j = 0; j < curHom.cols; j++) {
-          homography_sums.at<double>(i, j) += curHom.at<double>(i, j); 
-        }
-      }
-
-      // Okay, we have the sums, now get the actual avgs.
-      for(int i = 0; i < homography_sums.rows; i++) {
-        for(int j = 0; j< homography_sums.cols; j++) {
-          true_homography.at<double>(i, j) = (double) ( homography_sums.at<double>(i, j) / (double) homography_avg.size()); 
-        }
-      }      
-    }
-  }
-  else {
-    int start = homography_avg.size() - AVG_COUNT; 
-    for(int hom = start; hom < homography_avg.size(); hom++) {
-      cv::Mat curHom = homography_avg[hom]; 
-      // Loop through the current homographies and add 
-      for(int i = 0; i < curHom.rows; i++) {
-        for(int j = 0; j < curHom.cols; j++) {
-          homography_sums.at<double>(i, j) += curHom.at<double>(i, j); 
-        }
-      }
-
-      // Okay, we have the sums, now get the actual avgs.
-      for(int i = 0; i < homography_sums.rows; i++) {
-        for(int j = 0; j< homography_sums.cols; j++) {
-          true_homography.at<double>(i, j) = (double) ( homography_sums.at<double>(i, j) / (double) homography_avg.size()); 
-        }
-      }      
-    }
+  inliers.clear(); 
+  if(modelpts.size() < 4) {
+    return cv::Mat(); 
   }
-    
-  // Get the corners from the model
-  std::vector<cv::Point2f> model_corners(4); 
-  model_corners[0] = cv::Point2f( 0, 0 ); 
-  model_corners[1] = cv::Point2f( (float) model.cols, 0 ); 
-  model_corners[2] = cv::Point2f( (float) model.cols, (float) model.rows ); 
-  model_corners[3] = cv::Point2f( 0, float(model.rows) );
+
+  scoped_timer timer(STAGE_HOMOGRAPHY); 
+  return cv::findHomography(modelpts, scenepts, cv::LMEDS, 3, inliers);
+}
+
+/**
+ * @brief Function to get the rotations and translations of the model from its homography
+ * 
+ * @param homography homography from the model to the scene
+ * @param model_size size of the model image
+ * @param rotations output array of the rotations
+ * @param translations output array of the translations
+ * @param cam_mat camera matrix 
+ * @param dist_coeffs distortion coefficients
+ * @param scene_corners output array of the corners of the surface in the scene
+ */
+void pose_from_homography(const cv::Mat &homography, cv::Size model_size, cv::Mat &rotations, cv::Mat &translations, 
+                          cv::Mat cam_mat, cv::Mat dist_coeffs, std::vector<cv::Point2f> &scene_corners) {
+  // Get the corners from the model, kept on the stack so nothing is allocated 
+  cv::Point2f model_corners[4] = {
+    cv::Point2f( 0, 0 ), 
+    cv::Point2f( (float) model_size.width, 0 ), 
+    cv::Point2f( (float) model_size.width, (float) model_size.height ), 
+    cv::Point2f( 0, (float) model_size.height )
+  }; 
   
-  cv::perspectiveTransform( model_corners, scene_corners, homography); 
+  scene_corners.resize(4); 
+  cv::perspectiveTransform( cv::Mat(4, 1, CV_32FC2, model_corners), scene_corners, homography); 
 
-  std::vector<cv::Vec3f> point_set {
+  static const cv::Vec3f point_set[4] = {
     cv::Vec3f(0, 0, 0),
     cv::Vec3f(0, -1, 0),
     cv::Vec3f(-1, -1, 0),
     cv::Vec3f(-1, 0, 0)
   }; 
 
-  cv::solvePnP(point_set, scene_corners, cam_mat, dist_coeffs, rotations, translations); 
+  // The corners are on a plane so IPPE can solve it in closed form
+  scoped_timer timer(STAGE_PNP); 
+  cv::solvePnP(cv::Mat(4, 1, CV_32FC3, (void *) point_set), scene_corners, cam_mat, dist_coeffs, rotations, translations, false, cv::SOLVEPNP_IPPE); 
+}
+
+/**
+ * @brief Function to get the rotations and translations from the solvePnP opencv function
+ * 
+ * @param matches keypoint matches
+ * @param keypoints_model keypoints in the model
+ * @param keypoints_scene keypoints in the scene
+ * @param model_size size of the model image
+ * @param rotations output array of the rotations
+ * @param translations output array of the translations
+ * @param cam_mat camera matrix 
+ * @param dist_coeffs distortion coefficients
+ * @param scene_corners output array of the corners of the surface in the scene
+ */
+void get_rots_and_trans(const std::vector<cv::DMatch> &matches, const std::vector<cv::KeyPoint> &keypoints_model, const std::vector<cv::KeyPoint> &keypoints_scene, 
+                        cv::Size model_size, cv::Mat &rotations, cv::Mat &translations, cv::Mat cam_mat, cv::Mat dist_coeffs, std::vector<cv::Point2f> &scene_corners) {
+  cv::Mat homography; 
+  std::vector<uchar> inliers; 
+  get_rots_and_trans(matches, keypoints_model, keypoints_scene, model_size, rotations, translations, cam_mat, dist_coeffs, scene_corners, homography, inliers); 
+}
+
+/**
+ * @brief Function to get the rotations and translations from the solvePnP opencv function,
+ * also returning the homography and which matches agreed with it. The homography is found with 
+ * PROSAC and the pose with IPPE, see solve_planar_pose. 
+ * 
+ * @param matches keypoint matches
+ * @param keypoints_model keypoints in the model
+ * @param keypoints_scene keypoints in the scene
+ * @param model_size size of the model image
+ * @param rotations output array of the rotations
+ * @param translations output array of the translations
+ * @param cam_mat camera matrix 
+ * @param dist_coeffs distortion coefficients
+ * @param scene_corners output array of the corners of the surface in the scene, empty if there's no pose
+ * @param homography output homography from the model to the scene
+ * @param inliers output mask of the matches that agree with the homography
+ * @param filter filter that smooths the homography over time, nullptr to use the raw homography
+ * @param ws buffers to reuse, nullptr to allocate them
+ */
+void get_rots_and_trans(const std::vector<cv::DMatch> &matches, const std::vector<cv::KeyPoint> &keypoints_model, const std::vector<cv::KeyPoint> &keypoints_scene, 
+                        cv::Size model_size, cv::Mat &rotations, cv::Mat &translations, cv::Mat cam_mat, cv::Mat dist_coeffs, std::vector<cv::Point2f> &scene_corners, 
+                        cv::Mat &homography, std::vector<uchar> &inliers, pose_filter *filter, pose_workspace *ws) {
+  scene_corners.clear(); 
+  inliers.assign(matches.size(), 0); 
+  pose_workspace local; 
+  pose_workspace &w = ws != nullptr ? *ws : local; 
+  planar_pose &pose = w.pose; 
+  if(!solve_planar_pose(matches, keypoints_model, keypoints_scene, model_size, cam_mat, dist_coeffs, pose, &w)) {
+    homography.release(); 
+    return; 
+  }
+  // Copy rather than share so the workspace can be written again next frame 
+  pose.homography.copyTo(homography); 
+  inliers = pose.inliers; 
+  
+  // Without a filter the IPPE pose from the inliers is used as is. Otherwise smooth the homography 
+  // over the last few frames and get the pose from that. 
+  if(filter == nullptr) {
+    pose.rotations.copyTo(rotations); 
+    pose.translations.copyTo(translations); 
+    scene_corners = pose.scene_corners; 
+    return; 
+  }
 
+  pose_filter_update(*filter, homography, w.smoothed); 
+  pose_from_homography(w.smoothed, model_size, rotations, translations, cam_mat, dist_coeffs, scene_corners); 
 }
 
 /**
@@ -201,3 +312,49 @@ int axes_points(std::vector<cv::Vec3f> &points, cv::Vec3f origin, float scale) {
   points.push_back( cv::Vec3f(0, 0, 0.5) );
   return 0; 
 }
+
+/**
+ * @brief Function to draw the outline of the target and its axes
+ * 
+ * @param dst image to draw on
+ * @param scene_corners corners of the surface in the scene
+ * @param rotations rotations of the target
+ * @param translations translations of the target
+ * @param cam_mat camera matrix 
+ * @param dist_coeffs distortion coefficients
+ */
+void draw_pose(cv::Mat &dst, const std::vector<cv::Point2f> &scene_corners, const cv::Mat &rotations, const cv::Mat &translations, 
+               cv::Mat cam_mat, cv::Mat dist_coeffs) {
+  //Draw the lines betwen the corners (mapped object in the scene)
+  cv::line( dst, scene_corners[0],
+    scene_corners[1], cv::Scalar(0, 255, 0), 4 );
+  cv::line( dst, scene_corners[1],
+    scene_corners[2], cv::Scalar( 0, 255, 0), 4 );
+  cv::line( dst, scene_corners[2],
+    scene_corners[3], cv::Scalar( 0, 255, 0), 4 );
+  cv::line( dst, scene_corners[3],
+    scene_corners[0], cv::Scalar( 0, 255, 0), 4 );
+ 
+  // The axes never change, so build them once. Project them into a buffer on the stack. 
+  static const std::vector<cv::Vec3f> axespoints = []() {
+    std::vector<cv::Vec3f> points; 
+    axes_points(points, cv::Vec3f(0, 0, 0), 1.0); 
+    return points; 
+  }(); 
+
+  cv::Vec2f out_axes_data[4]; 
+  cv::Mat out_axes(4, 1, CV_32FC2, out_axes_data); 
+  cv::projectPoints(axespoints, rotations, translations, cam_mat, dist_coeffs, out_axes); 
+
+  cv::Point oo = cv::Point( out_axes.at<cv::Vec2f>(0,0) );
+  cv::Point ox = cv::Point( out_axes.at<cv::Vec2f>(1,0) );
+  cv::Point oy = cv::Point( out_axes.at<cv::Vec2f>(2,0) );
+  cv::Point oz = cv::Point( out_axes.at<cv::Vec2f>(3,0) );
+  cv::circle( dst, oo, 6, {255, 0, 0} );
+  cv::circle( dst, oo, 8, {255, 0, 0} );
+  cv::circle( dst, ox, 6, {255, 0, 255} );
+  cv::circle( dst, ox, 8, {255, 0, 255} );
+  cv::arrowedLine( dst, oo, ox, { 0, 0, 255 }, 2);
+  cv::arrowedLine( dst, oo, oy, { 0, 255, 0 }, 2 );
+  cv::arrowedLine( dst, oo, oz, { 255, 0, 0 }, 2 );
+}
@@ -12,11 +12,54 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <algorithm>
 #include <dirent.h>
 #include <opencv2/opencv.hpp>
 #include "../include/csv_util.h"
 #include "../include/markerless.h"
+#include "../include/model_db.h"
+#include "../include/tracker.h"
 #include "../include/ar.h"
+#include "../include/alloc_counter.h"
+#include "../include/frame_governor.h"
+#include "../include/metrics.h"
+#include "../include/camera_model.h"
+#include "../include/cal_store.h"
+
+#define ALLOC_REPORT_FRAMES 100 // frames between allocation reports in -a mode
+
+/**
+ * @brief Function to get the camera matrix of frames processed at a smaller resolution
+ * 
+ * @param cam_mat camera matrix at the camera's resolution
+ * @param scale processing resolution as a fraction of the camera's
+ * @param scaled output camera matrix
+ */
+static void scale_camera(const cv::Mat &cam_mat, float scale, cv::Mat &scaled) {
+  cam_mat.copyTo(scaled); 
+  for(int r = 0; r < 2; r++) {
+    for(int c = 0; c < 3; c++) {
+      scaled.at<double>(r, c) *= scale; 
+    }
+  }
+}
+
+/**
+ * @brief Function to get corners found at the processing resolution in the camera's resolution
+ * 
+ * @param corners corners at the processing resolution
+ * @param scale processing resolution as a fraction of the camera's
+ * @param full buffer for the scaled corners
+ * @return const std::vector<cv::Point2f>& corners at the camera's resolution
+ */
+static const std::vector<cv::Point2f> &full_corners(const std::vector<cv::Point2f> &corners, float scale, std::vector<cv::Point2f> &full) {
+  if(scale == 1.0f) return corners; 
+  full.resize(corners.size()); 
+  for(int i = 0; i < corners.size(); i++) {
+    full[i] = corners[i] * (1.0f / scale); 
+  }
+  return full; 
+}
 
 int main(int argc, char *argv[]) {
   cv::VideoCapture *capdev; // open the video device 
@@ -27,12 +70,58 @@ int main(int argc, char *argv[]) {
   }
 
   bool drawkps = false; 
-  if(argc > 1) {
-    if(strcmp(argv[1], "-d") == 0) {
+  bool tracking = false; 
+  bool use_roi = false; 
+  bool count_allocs = false; 
+  int multi_targets = 0; // targets found at once, 0 for the single target loop
+  bool use_grid = false; 
+  bool guided = false; 
+  double budget_ms = 0; // frame time to stay under in -b mode, 0 to always run at full quality
+  std::string metrics_path; // stage timings and counts are appended here every METRICS_FLUSH_FRAMES frames in -p mode
+  std::string trace_path; // timeline written here on exit in -T mode
+  int smoothing = POSE_FILTER_DEFAULT_WINDOW; 
+  std::string camera_id; // camera the calibration is looked up under, the first video device unless set with -i
+  bool rectify = false; // remove the lens distortion from each frame so the pose stages run without it in -R mode
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "-d") == 0) {
       printf("In Draw Keypoints Mode\n"); 
       drawkps = true; 
+    } else if(strcmp(argv[i], "-t") == 0) {
+      printf("In Tracking Mode\n"); 
+      tracking = true; 
+    } else if(strcmp(argv[i], "-r") == 0) {
+      printf("In ROI Detection Mode\n"); 
+      use_roi = true; 
+    } else if(strcmp(argv[i], "-a") == 0) {
+      printf("Counting Allocations\n"); 
+      count_allocs = true; 
+    } else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      smoothing = atoi(argv[++i]); 
+    } else if(strcmp(argv[i], "-g") == 0) {
+      printf("In Grid Detection Mode\n"); 
+      use_grid = true; 
+    } else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      multi_targets = std::max(1, atoi(argv[++i])); 
+      printf("In Multi Target Mode, up to %d targets\n", multi_targets); 
+    } else if(strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      budget_ms = atof(argv[++i]); 
+      printf("In Frame Budget Mode, %.1f ms per frame\n", budget_ms); 
+    } else if(strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+      metrics_path = argv[++i]; 
+      printf("Writing stage metrics to %s\n", metrics_path.c_str()); 
+    } else if(strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+      trace_path = argv[++i]; 
+      printf("Writing a trace to %s\n", trace_path.c_str()); 
+    } else if(strcmp(argv[i], "-u") == 0) {
+      printf("In Guided Matching Mode\n"); 
+      guided = true; 
+    } else if(strcmp(argv[i], "-R") == 0) {
+      printf("In Undistorted Mode\n"); 
+      rectify = true; 
+    } else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      camera_id = argv[++i]; 
     } else {
-      printf("error :: usage : use the flag -d to draw the matching keypoints\n"); 
+      printf("error :: usage : use the flag -d to draw the matching keypoints, -t to track between detections, -r to only detect around the last pose, -a to count allocations per frame, -s N to average the pose over N frames, -m N to find up to N targets at once, -g to detect on a grid in parallel, -u to match around the last pose, -b MS to lower quality to stay under MS per frame, -p FILE to write stage metrics as csv or json, -T FILE to write a chrome trace, -R to undistort each frame first, -i ID to use the calibration stored for camera ID\n"); 
       exit(-1); 
     }
   }
@@ -46,93 +135,160 @@ int main(int argc, char *argv[]) {
   cv::Mat cam_mat(3, 3, CV_64FC1); 
   cv::Mat dist_coef(5, 1, CV_64FC1); 
   
-  read_calibration_data_csv("calibration.csv", cam_mat, dist_coef, 0); 
+  load_camera_calibration(CAL_STORE_NAME, "calibration.csv", camera_id.empty() ? camera_identifier(0) : camera_id, refS, cam_mat, dist_coef); 
+
+  // In -R mode frames are undistorted with tables built once, and everything after works without distortion
+  camera_model cam; 
+  camera_model_init(cam, cam_mat, dist_coef); 
+  cv::Mat pose_dist = rectify ? cv::Mat() : dist_coef; 
 
   std::string winName= "Markerless AR"; 
   cv::namedWindow(winName, 1); 
   cv::Mat frame;
+  cv::Mat rectified; 
+  cv::Mat &view = rectify ? rectified : frame; // frame the pipeline sees
   cv::Mat dst; 
-  cv::Mat gray; 
+  luma_pyramid pyr; // grayscale frame and its pyramids, shared by detection and tracking
 
   cv::Ptr<cv::ORB> orb = cv::ORB::create();  // Create the ORB detector
 
-  // Declare the keypoints and descriptors for the model images
-  cv::Mat model; 
-  std::vector<cv::KeyPoint> keypoints_model; 
-  cv::Mat descriptors_model; 
+  // Load every model image into the target database. The trained index is cached in model_db.idx
+  // so a restart only rebuilds it when the model images change.
+  model_db db; 
+  std::string model_dir = "./model_images/"; 
+  if(load_model_db(orb, model_dir, db, "model_db.idx") != 0) {
+    exit(-1); 
+  }
+  const model_db &models = db; // read only from here on, shared by every frame
+  std::vector<cv::Mat> model_images(models.targets.size()); // model images read for drawing
+  planar_tracker tracker; 
+  pose_filter_init(tracker.filter, smoothing); 
+  tracker.use_roi = use_roi; 
+  tracker.guided = guided; 
+  tiled_orb tiled; // spreads the scene keypoints over the frame in -g mode
+  if(use_grid) {
+    tiled_orb_init(tiled, orb); 
+    tracker.tiled = &tiled; 
+  }
+  multi_tracker trackers; // every target's tracker in -m mode
+  std::vector<target_result> target_results; 
+  if(multi_targets > 0) {
+    if(drawkps) printf("Drawing keypoints isn't supported with several targets, drawing the poses\n"); 
+    drawkps = false; 
+    multi_tracker_init(trackers, models, smoothing, multi_targets); 
+    trackers.guided = guided; 
+    if(use_grid) trackers.tiled = &tiled; 
+  }
+
+  // In -b mode the detector's settings and the processing resolution follow the frame time
+  frame_governor governor; 
+  governor_init(governor, budget_ms, orb); 
+  float scale = 1.0f; 
+  cv::Mat proc_cam = cam_mat.clone(); // camera matrix at the processing resolution
+  std::vector<cv::Point2f> draw_corners; 
 
-  get_model_kp_desc(orb, model, keypoints_model, descriptors_model); 
+  // Everything the loop needs is reused, so after the first few frames it shouldn't allocate
+  frame_result result; 
+  if(count_allocs) alloc_counter_install(); 
+  if(!metrics_path.empty() || !trace_path.empty()) metrics_enable(!trace_path.empty()); 
+  int metrics_frames = 0; 
+  alloc_counts alloc_total; 
+  int alloc_frames = 0; 
 
   for(;;) {
+    scoped_timer frame_timer(STAGE_FRAME); 
+    scoped_timer capture_timer(STAGE_CAPTURE); 
     *capdev >> frame; // get a new frame from the camera, treat as a stream
+    capture_timer.stop(); 
     if( frame.empty() ) {
       printf("frame is empty\n");
       break;
     }  
 
+    alloc_counts before = alloc_counter_read(); 
+    int64 start = cv::getTickCount(); 
+    if(rectify) camera_model_rectify(cam, frame, rectified); 
+
     // Convert to grayscale
-    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY); 
-    std::vector<cv::KeyPoint> keypoints_scene; 
-    cv::Mat descriptors_scene; 
-    orb->detectAndCompute( gray, cv::noArray(), keypoints_scene, descriptors_scene );
-
-    // Match the keypoints
-    cv::Ptr<cv::DescriptorMatcher> matcher = cv::DescriptorMatcher::create(cv::DescriptorMatcher::FLANNBASED);  
-    std::vector<cv::DMatch> acceptable_matches; 
-    bool sufficient_matches = false; 
-    match_kps(matcher, descriptors_scene, descriptors_model, acceptable_matches, sufficient_matches); 
-    frame.copyTo(dst); 
+    luma_pyramid_build(pyr, view, scale); 
+    const cv::Mat &gray = pyr.gray; 
+
+    // Find the target and its pose, tracking it between detections in -t mode
+    result.have_features = false; 
+    if(multi_targets > 0) {
+      locate_targets(trackers, models, orb, pyr, proc_cam, pose_dist, tracking, result, target_results); 
+    } else {
+      locate_target(tracker, models, orb, pyr, proc_cam, pose_dist, tracking && !drawkps, result); 
+    }
+    double frame_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency(); 
+
+    const model_target &target = models.targets[result.target]; 
+    scoped_timer draw_timer(STAGE_DRAW); 
+    view.copyTo(dst); 
     
-    if(drawkps) {
-      cv::drawMatches(model, keypoints_model, gray, keypoints_scene, acceptable_matches, dst, 
+    if(multi_targets > 0) {
+      for(int t = 0; t < target_results.size(); t++) {
+        const target_result &res = target_results[t]; 
+        if(!res.have_pose) continue; 
+        printf("target %s rvec [%.4f %.4f %.4f] tvec [%.4f %.4f %.4f]\n", models.targets[t].name.c_str(), 
+                res.rotations.at<double>(0), res.rotations.at<double>(1), res.rotations.at<double>(2), 
+                res.translations.at<double>(0), res.translations.at<double>(1), res.translations.at<double>(2)); 
+        draw_pose(dst, full_corners(res.scene_corners, scale, draw_corners), res.rotations, res.translations, cam_mat, pose_dist); 
+      }
+    }
+    else if(drawkps) {
+      // Targets loaded from the feature cache don't keep their image, so read it the first time it's drawn
+      cv::Mat &model_image = model_images[result.target]; 
+      if(model_image.empty()) get_model_image(model_dir, target, model_image); 
+      cv::drawMatches(model_image, target.keypoints, gray, result.keypoints_scene, result.matches, dst, 
                         cv::Scalar::all(-1), cv::Scalar::all(-1), std::vector<char>(),
                         cv::DrawMatchesFlags::NOT_DRAW_SINGLE_POINTS);
-      cv::imshow(winName, dst); 
     }
-    else {
-      if(sufficient_matches) {
-        cv::Mat rotations; 
-        cv::Mat translations; 
-        std::vector<cv::Point2f> scene_corners; 
-
-        frame.copyTo(dst); 
-
-        get_rots_and_trans(acceptable_matches, keypoints_model, keypoints_scene, model, rotations, translations, cam_mat, dist_coef, scene_corners); 
-
-        //Draw the lines betwen the corners (mapped object in the scene)
-        cv::line( dst, scene_corners[0],
-          scene_corners[1], cv::Scalar(0, 255, 0), 4 );
-        cv::line( dst, scene_corners[1],
-          scene_corners[2], cv::Scalar( 0, 255, 0), 4 );
-        cv::line( dst, scene_corners[2],
-          scene_corners[3], cv::Scalar( 0, 255, 0), 4 );
-        cv::line( dst, scene_corners[3],
-          scene_corners[0], cv::Scalar( 0, 255, 0), 4 );
-       
-        std::vector<cv::Vec3f> axespoints;  
-        cv::Vec3f origin(0, 0, 0); 
-        axes_points(axespoints, origin, 1.0);
-
-        cv::Mat out_axes; 
-        cv::projectPoints(axespoints, rotations, translations, cam_mat, dist_coef, out_axes); 
-
-        cv::Point oo = cv::Point( out_axes.at<cv::Vec2f>(0,0) );
-        cv::Point ox = cv::Point( out_axes.at<cv::Vec2f>(1,0) );
-        cv::Point oy = cv::Point( out_axes.at<cv::Vec2f>(2,0) );
-        cv::Point oz = cv::Point( out_axes.at<cv::Vec2f>(3,0) );
-        cv::circle( dst, oo, 6, {255, 0, 0} );
-        cv::circle( dst, oo, 8, {255, 0, 0} );
-        cv::circle( dst, ox, 6, {255, 0, 255} );
-        cv::circle( dst, ox, 8, {255, 0, 255} );
-        cv::arrowedLine( dst, oo, ox, { 0, 0, 255 }, 2);
-        cv::arrowedLine( dst, oo, oy, { 0, 255, 0 }, 2 );
-        cv::arrowedLine( dst, oo, oz, { 255, 0, 0 }, 2 );
-
-      } else {
-        frame.copyTo(dst); 
+    else if(result.have_pose) {
+      printf("target %s rvec [%.4f %.4f %.4f] tvec [%.4f %.4f %.4f]\n", target.name.c_str(), 
+              result.rotations.at<double>(0), result.rotations.at<double>(1), result.rotations.at<double>(2), 
+              result.translations.at<double>(0), result.translations.at<double>(1), result.translations.at<double>(2)); 
+      draw_pose(dst, full_corners(result.scene_corners, scale, draw_corners), result.rotations, result.translations, cam_mat, pose_dist); 
+    }
+
+    draw_timer.stop(); 
+
+    // Step the quality down when the frames take too long and back up when there's time to spare. Everything the
+    // trackers remember is at the old resolution, so it's dropped when that changes.
+    if(budget_ms > 0 && governor_update(governor, frame_ms)) {
+      governor_apply(governor, orb, use_grid ? &tiled : nullptr); 
+      const governor_level &level = governor_current(governor); 
+      if(level.scale != scale) {
+        scale = level.scale; 
+        scale_camera(cam_mat, scale, proc_cam); 
+        tracker_clear_history(tracker); 
+        for(int t = 0; t < trackers.trackers.size(); t++) {
+          tracker_clear_history(trackers.trackers[t]); 
+        }
+      }
+      printf("frame time %.1f ms, now %d features, %d pyramid levels, %.2f resolution\n", 
+              governor.avg_ms, level.nfeatures, level.nlevels, level.scale); 
+    }
+
+    // Report the allocations made by everything above, the window and camera aren't counted
+    if(count_allocs) {
+      alloc_counts after = alloc_counter_read(); 
+      alloc_total.heap += after.heap - before.heap; 
+      alloc_total.mats += after.mats - before.mats; 
+      if(++alloc_frames == ALLOC_REPORT_FRAMES) {
+        printf("allocations per frame: operator new %.2f, cv::Mat %.2f\n", 
+                (double) alloc_total.heap / alloc_frames, (double) alloc_total.mats / alloc_frames); 
+        alloc_total = alloc_counts(); 
+        alloc_frames = 0; 
       }
     }
     
+    frame_timer.stop(); 
+    if(!metrics_path.empty() && ++metrics_frames == METRICS_FLUSH_FRAMES) {
+      metrics_flush(metrics_path); 
+      metrics_frames = 0; 
+    }
+
     cv::imshow(winName, dst); 
     char keyEx = cv::waitKeyEx(10); 
     if(keyEx == 'q') {
@@ -147,6 +303,8 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if(!metrics_path.empty()) metrics_flush(metrics_path); 
+  if(!trace_path.empty()) metrics_write_trace(trace_path); 
   printf("Bye!\n"); 
 
   delete capdev;
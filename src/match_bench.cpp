@@ -0,0 +1,138 @@
+/**
+ * @file match_bench.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Program to benchmark the FLANN matcher against the hamming matchers on the sample images
+ * @date 2026-10-17
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <dirent.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <set>
+#include <opencv2/opencv.hpp>
+#include "../include/markerless.h"
+#include "../include/hamming_match.h"
+
+#define BENCH_REPEATS 20
+
+/**
+ * @brief Function to list the files in a directory in sorted order
+ *
+ * @param dirname directory to list
+ * @param paths output vector of the paths of the files
+ * @return int return non-zero value on failure
+ */
+static int list_dir(const std::string &dirname, std::vector<std::string> &paths) {
+  DIR *dp = opendir(dirname.c_str());
+  if(dp == nullptr) {
+    printf("Could not find directory %s\n", dirname.c_str());
+    return -1;
+  }
+  struct dirent *entry = nullptr;
+  while ((entry = readdir(dp))) {
+    std::string name = entry->d_name;
+    if(name.empty() || name[0] == '.') continue; // skip . and .. and the feature cache
+    paths.push_back(dirname + name);
+  }
+  closedir(dp);
+  std::sort(paths.begin(), paths.end());
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  std::string model_dir = "./model_images/";
+  std::string scene_dir = "./out_imgs/";
+  if(argc > 2) {
+    model_dir = argv[1];
+    scene_dir = argv[2];
+  } else if(argc != 1) {
+    printf("error :: usage : %s [model_dir/ scene_dir/]\n", argv[0]);
+    exit(-1);
+  }
+
+  std::vector<std::string> model_paths;
+  std::vector<std::string> scene_paths;
+  if(list_dir(model_dir, model_paths) != 0 || list_dir(scene_dir, scene_paths) != 0) {
+    exit(-1);
+  }
+
+  cv::Ptr<cv::ORB> orb = cv::ORB::create();
+  double tick_ms = 1000.0 / cv::getTickFrequency();
+
+  printf("model,scene,model_kps,scene_kps,flann_ms,bf_ms,lsh_build_ms,lsh_ms,flann_matches,bf_matches,lsh_matches,bf_agree,lsh_agree\n");
+  for(int m = 0; m < model_paths.size(); m++) {
+    cv::Mat model;
+    std::vector<cv::KeyPoint> keypoints_model;
+    cv::Mat descriptors_model;
+    if(get_model_kp_desc(orb, model_paths[m], model, keypoints_model, descriptors_model) != 0) continue;
+
+    for(int s = 0; s < scene_paths.size(); s++) {
+      cv::Mat scene = cv::imread(scene_paths[s], cv::IMREAD_GRAYSCALE);
+      if(scene.empty()) continue;
+      std::vector<cv::KeyPoint> keypoints_scene;
+      cv::Mat descriptors_scene;
+      orb->detectAndCompute(scene, cv::noArray(), keypoints_scene, descriptors_scene);
+      if(descriptors_scene.rows < 2 || descriptors_model.rows < 2) continue;
+
+      // The same direction as the FLANN path so the matches can be compared: model is the query, scene the train set
+      std::vector<cv::DMatch> flann_matches, bf_matches, lsh_matches;
+      bool enough = false;
+
+      int64 t0 = cv::getTickCount();
+      for(int r = 0; r < BENCH_REPEATS; r++) {
+        flann_matches.clear();
+        cv::Ptr<cv::DescriptorMatcher> matcher = cv::DescriptorMatcher::create(cv::DescriptorMatcher::FLANNBASED);
+        match_kps(matcher, descriptors_scene, descriptors_model, flann_matches, enough);
+      }
+      double flann_ms = (cv::getTickCount() - t0) * tick_ms / BENCH_REPEATS;
+
+      hamming_index bf_index;
+      t0 = cv::getTickCount();
+      for(int r = 0; r < BENCH_REPEATS; r++) {
+        bf_matches.clear();
+        build_hamming_index(descriptors_scene, bf_index);
+        hamming_knn2_ratio(bf_index, descriptors_model, 0.75f, bf_matches);
+      }
+      double bf_ms = (cv::getTickCount() - t0) * tick_ms / BENCH_REPEATS;
+
+      hamming_index lsh_index;
+      t0 = cv::getTickCount();
+      for(int r = 0; r < BENCH_REPEATS; r++) {
+        build_hamming_index(descriptors_scene, lsh_index, 0);
+      }
+      double lsh_build_ms = (cv::getTickCount() - t0) * tick_ms / BENCH_REPEATS;
+      t0 = cv::getTickCount();
+      for(int r = 0; r < BENCH_REPEATS; r++) {
+        lsh_matches.clear();
+        hamming_knn2_ratio(lsh_index, descriptors_model, 0.75f, lsh_matches);
+      }
+      double lsh_ms = (cv::getTickCount() - t0) * tick_ms / BENCH_REPEATS;
+
+      // Fraction of the FLANN matches that the hamming matchers also found
+      std::set<std::pair<int, int> > flann_set;
+      for(int i = 0; i < flann_matches.size(); i++) {
+        flann_set.insert(std::make_pair(flann_matches[i].queryIdx, flann_matches[i].trainIdx));
+      }
+      int bf_agree = 0, lsh_agree = 0;
+      for(int i = 0; i < bf_matches.size(); i++) {
+        bf_agree += flann_set.count(std::make_pair(bf_matches[i].queryIdx, bf_matches[i].trainIdx));
+      }
+      for(int i = 0; i < lsh_matches.size(); i++) {
+        lsh_agree += flann_set.count(std::make_pair(lsh_matches[i].queryIdx, lsh_matches[i].trainIdx));
+      }
+      float denom = flann_set.empty() ? 1.0f : (float) flann_set.size();
+
+      printf("%s,%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%d,%d,%d,%.3f,%.3f\n", model_paths[m].c_str(), scene_paths[s].c_str(),
+              (int) keypoints_model.size(), (int) keypoints_scene.size(), flann_ms, bf_ms, lsh_build_ms, lsh_ms,
+              (int) flann_matches.size(), (int) bf_matches.size(), (int) lsh_matches.size(),
+              bf_agree / denom, lsh_agree / denom);
+    }
+  }
+
+  return 0;
+}
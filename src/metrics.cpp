@@ -0,0 +1,309 @@
+/**
+ * @file metrics.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Stage timers and counters aggregated into histograms, written out as CSV, JSON or a Chrome trace
+ * @date 2026-10-17
+ */
+
+#include <atomic>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include "../include/metrics.h"
+
+/**
+ * @brief Histogram of one stage or counter, updated from any thread without a lock
+ */
+struct metric_histogram {
+  std::atomic<int64_t> n;
+  std::atomic<int64_t> sum;
+  std::atomic<int64_t> min;
+  std::atomic<int64_t> max;
+  std::atomic<int64_t> buckets[METRICS_BUCKETS]; // bucket i holds values under 2^i that aren't in the one before
+};
+
+/**
+ * @brief One span or count of the trace timeline
+ */
+struct trace_event {
+  int id; // stage or counter
+  bool counter;
+  int tid; // thread it happened on
+  int64_t ts; // microseconds since metrics_enable
+  int64_t value; // duration in microseconds, or the count
+};
+
+static const char *stage_names[METRIC_STAGES] = {
+  "capture", "grayscale", "detect", "match", "homography", "pnp", "flow", "draw", "frame"
+};
+static const char *count_names[METRIC_COUNTS] = {
+  "keypoints", "matches", "inliers"
+};
+
+static std::atomic<bool> enabled(false);
+static std::atomic<bool> tracing(false);
+static int64 origin = 0; // cv::getTickCount when metrics were enabled
+static int64 window_start = 0; // cv::getTickCount of the last flush
+static metric_histogram stage_hist[METRIC_STAGES];
+static metric_histogram count_hist[METRIC_COUNTS];
+static std::mutex trace_mutex;
+static std::vector<trace_event> trace;
+static std::atomic<int> next_tid(0);
+
+/**
+ * @brief Function to get a small id for the calling thread
+ *
+ * @return int id, 0 for the first thread that asks
+ */
+static int thread_id() {
+  thread_local int tid = next_tid++;
+  return tid;
+}
+
+/**
+ * @brief Function to convert ticks to microseconds
+ *
+ * @param ticks cv::getTickCount ticks
+ * @return int64_t microseconds
+ */
+static int64_t ticks_to_us(int64 ticks) {
+  return (int64_t) (ticks * 1e6 / cv::getTickFrequency());
+}
+
+/**
+ * @brief Function to reset a histogram
+ *
+ * @param h histogram
+ */
+static void reset_histogram(metric_histogram &h) {
+  h.n = 0;
+  h.sum = 0;
+  h.min = INT64_MAX;
+  h.max = INT64_MIN;
+  for(int b = 0; b < METRICS_BUCKETS; b++) h.buckets[b] = 0;
+}
+
+/**
+ * @brief Function to add a value to a histogram
+ *
+ * @param h histogram
+ * @param value value to add
+ */
+static void add_value(metric_histogram &h, int64_t value) {
+  h.n.fetch_add(1, std::memory_order_relaxed);
+  h.sum.fetch_add(value, std::memory_order_relaxed);
+  int64_t cur = h.min.load(std::memory_order_relaxed);
+  while(value < cur && !h.min.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {}
+  cur = h.max.load(std::memory_order_relaxed);
+  while(value > cur && !h.max.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {}
+
+  int b = value <= 0 ? 0 : 64 - __builtin_clzll((unsigned long long) value);
+  h.buckets[std::min(b, METRICS_BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Function to keep an event for the trace if there's room
+ *
+ * @param event event to keep
+ */
+static void add_event(const trace_event &event) {
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  if(trace.size() < METRICS_TRACE_MAX_EVENTS) trace.push_back(event);
+}
+
+/**
+ * @brief Summary of a histogram, taken when it's written out
+ */
+struct histogram_summary {
+  int64_t n = 0;
+  double mean = 0;
+  int64_t min = 0;
+  int64_t max = 0;
+  int64_t p50 = 0;
+  int64_t p90 = 0;
+  int64_t p99 = 0;
+};
+
+/**
+ * @brief Function to summarize a histogram. The percentiles are the top of the bucket they fall in, capped at the max.
+ *
+ * @param h histogram
+ * @return histogram_summary summary
+ */
+static histogram_summary summarize(const metric_histogram &h) {
+  histogram_summary s;
+  s.n = h.n.load();
+  if(s.n == 0) return s;
+  s.mean = (double) h.sum.load() / s.n;
+  s.min = h.min.load();
+  s.max = h.max.load();
+
+  const double quantiles[3] = {0.5, 0.9, 0.99};
+  int64_t *outputs[3] = {&s.p50, &s.p90, &s.p99};
+  for(int q = 0; q < 3; q++) {
+    int64_t rank = (int64_t) std::ceil(quantiles[q] * s.n);
+    int64_t seen = 0;
+    int b = 0;
+    for(; b < METRICS_BUCKETS - 1; b++) {
+      seen += h.buckets[b].load();
+      if(seen >= rank) break;
+    }
+    int64_t top = b == 0 ? 0 : (((int64_t) 1 << b) - 1);
+    *outputs[q] = std::min(std::max(top, s.min), s.max);
+  }
+  return s;
+}
+
+/**
+ * @brief Function to start collecting metrics. Until this is called the timers and counters do nothing.
+ *
+ * @param trace_events also keep every timed span and count for a trace timeline
+ */
+void metrics_enable(bool trace_events) {
+  for(int i = 0; i < METRIC_STAGES; i++) reset_histogram(stage_hist[i]);
+  for(int i = 0; i < METRIC_COUNTS; i++) reset_histogram(count_hist[i]);
+  // Reserve the whole trace up front so push_back never reallocates and copies it while trace_mutex is held mid-frame
+  if(trace_events) trace.reserve(METRICS_TRACE_MAX_EVENTS);
+  origin = cv::getTickCount();
+  window_start = origin;
+  tracing = trace_events;
+  enabled = true;
+}
+
+/**
+ * @brief Function to check whether metrics are being collected
+ *
+ * @return bool true once metrics_enable has been called
+ */
+bool metrics_enabled() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Function to add one timed span of a stage
+ *
+ * @param stage stage that was timed
+ * @param start cv::getTickCount at the start
+ * @param end cv::getTickCount at the end
+ */
+void metrics_record(metric_stage stage, int64 start, int64 end) {
+  if(!metrics_enabled()) return;
+  int64_t us = ticks_to_us(end - start);
+  add_value(stage_hist[stage], us);
+  if(tracing.load(std::memory_order_relaxed)) {
+    add_event({(int) stage, false, thread_id(), ticks_to_us(start - origin), us});
+  }
+}
+
+/**
+ * @brief Function to add one count, for example the keypoints found in a frame
+ *
+ * @param counter what was counted
+ * @param value count
+ */
+void metrics_count(metric_count counter, int64_t value) {
+  if(!metrics_enabled()) return;
+  add_value(count_hist[counter], value);
+  if(tracing.load(std::memory_order_relaxed)) {
+    add_event({(int) counter, true, thread_id(), ticks_to_us(cv::getTickCount() - origin), value});
+  }
+}
+
+/**
+ * @brief Function to append the histograms since the last flush to a file and start new ones. Files
+ * ending in .json get one JSON object per line, anything else gets CSV rows.
+ *
+ * @param path file to append to
+ * @return int return non-zero value if the file couldn't be written
+ */
+int metrics_flush(const std::string &path) {
+  if(!metrics_enabled()) return -1;
+  bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+  bool fresh = !std::ifstream(path).good();
+  FILE *fp = fopen(path.c_str(), "a");
+  if(fp == nullptr) {
+    printf("Unable to open metrics file %s\n", path.c_str());
+    return -1;
+  }
+
+  int64 now = cv::getTickCount();
+  double time_s = (now - origin) / cv::getTickFrequency();
+  double window_s = (now - window_start) / cv::getTickFrequency();
+  histogram_summary stages[METRIC_STAGES];
+  histogram_summary counts[METRIC_COUNTS];
+  for(int i = 0; i < METRIC_STAGES; i++) {
+    stages[i] = summarize(stage_hist[i]);
+    reset_histogram(stage_hist[i]);
+  }
+  for(int i = 0; i < METRIC_COUNTS; i++) {
+    counts[i] = summarize(count_hist[i]);
+    reset_histogram(count_hist[i]);
+  }
+  window_start = now;
+
+  if(json) {
+    fprintf(fp, "{\"time_s\": %.3f, \"window_s\": %.3f, \"stages_us\": {", time_s, window_s);
+    for(int i = 0; i < METRIC_STAGES; i++) {
+      const histogram_summary &s = stages[i];
+      fprintf(fp, "%s\"%s\": {\"count\": %lld, \"mean\": %.1f, \"min\": %lld, \"max\": %lld, \"p50\": %lld, \"p90\": %lld, \"p99\": %lld}",
+              i == 0 ? "" : ", ", stage_names[i], (long long) s.n, s.mean, (long long) s.min, (long long) s.max,
+              (long long) s.p50, (long long) s.p90, (long long) s.p99);
+    }
+    fprintf(fp, "}, \"counts\": {");
+    for(int i = 0; i < METRIC_COUNTS; i++) {
+      const histogram_summary &s = counts[i];
+      fprintf(fp, "%s\"%s\": {\"count\": %lld, \"mean\": %.1f, \"min\": %lld, \"max\": %lld, \"p50\": %lld, \"p90\": %lld, \"p99\": %lld}",
+              i == 0 ? "" : ", ", count_names[i], (long long) s.n, s.mean, (long long) s.min, (long long) s.max,
+              (long long) s.p50, (long long) s.p90, (long long) s.p99);
+    }
+    fprintf(fp, "}}\n");
+  } else {
+    if(fresh) fprintf(fp, "time_s,window_s,name,unit,count,mean,min,max,p50,p90,p99\n");
+    for(int i = 0; i < METRIC_STAGES + METRIC_COUNTS; i++) {
+      bool stage = i < METRIC_STAGES;
+      const histogram_summary &s = stage ? stages[i] : counts[i - METRIC_STAGES];
+      fprintf(fp, "%.3f,%.3f,%s,%s,%lld,%.1f,%lld,%lld,%lld,%lld,%lld\n", time_s, window_s,
+              stage ? stage_names[i] : count_names[i - METRIC_STAGES], stage ? "us" : "count", (long long) s.n, s.mean,
+              (long long) s.min, (long long) s.max, (long long) s.p50, (long long) s.p90, (long long) s.p99);
+    }
+  }
+
+  fclose(fp);
+  return 0;
+}
+
+/**
+ * @brief Function to write the trace timeline in the Chrome trace event format, for chrome://tracing or Perfetto
+ *
+ * @param path file to write
+ * @return int return non-zero value if the file couldn't be written
+ */
+int metrics_write_trace(const std::string &path) {
+  FILE *fp = fopen(path.c_str(), "w");
+  if(fp == nullptr) {
+    printf("Unable to open trace file %s\n", path.c_str());
+    return -1;
+  }
+
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  for(int i = 0; i < trace.size(); i++) {
+    const trace_event &e = trace[i];
+    if(e.counter) {
+      fprintf(fp, "{\"name\": \"%s\", \"ph\": \"C\", \"ts\": %lld, \"pid\": 1, \"tid\": %d, \"args\": {\"value\": %lld}}",
+              count_names[e.id], (long long) e.ts, e.tid, (long long) e.value);
+    } else {
+      fprintf(fp, "{\"name\": \"%s\", \"cat\": \"stage\", \"ph\": \"X\", \"ts\": %lld, \"dur\": %lld, \"pid\": 1, \"tid\": %d}",
+              stage_names[e.id], (long long) e.ts, (long long) e.value, e.tid);
+    }
+    fprintf(fp, i + 1 < trace.size() ? ",\n" : "\n");
+  }
+  fprintf(fp, "]}\n");
+  if(trace.size() >= METRICS_TRACE_MAX_EVENTS) printf("trace was full, events after the first %d were dropped\n", METRICS_TRACE_MAX_EVENTS);
+
+  fclose(fp);
+  return 0;
+}
@@ -0,0 +1,716 @@
+/**
+ * @file model_db.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Database of planar targets with a bag of binary words inverted index
+ * @date 2026-10-17
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cmath>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/markerless.h"
+#include "../include/model_db.h"
+#include "../include/feature_cache.h"
+
+#define VOCAB_ITERATIONS 10 // max k-majority iterations per node
+#define MODEL_DB_MAGIC 0x4244444d // "MDDB"
+#define MODEL_DB_VERSION 1
+
+/**
+ * @brief Function to add a node to the vocabulary tree
+ *
+ * @param vocab vocabulary tree to add the node to
+ * @param centers flat buffer of the node centers
+ * @param center cluster center of the node
+ * @param nbytes number of bytes in a descriptor
+ * @return int index of the new node
+ */
+static int add_node(vocab_tree &vocab, std::vector<uchar> &centers, const uchar *center, int nbytes) {
+  centers.insert(centers.end(), center, center + nbytes);
+  vocab.first_child.push_back(-1);
+  vocab.num_children.push_back(0);
+  vocab.word_id.push_back(-1);
+  return (int) vocab.first_child.size() - 1;
+}
+
+/**
+ * @brief Function to recursively cluster descriptors with k-majority and grow the tree below a node
+ *
+ * @param train all training descriptors, one per row
+ * @param members rows of train that fall into this node
+ * @param node index of the node to split
+ * @param level depth of the node, the root is level 0
+ * @param vocab vocabulary tree being built
+ * @param centers flat buffer of the node centers
+ * @param rng random number generator used for seeding
+ */
+static void cluster_node(const cv::Mat &train, const std::vector<int> &members, int node, int level,
+                         vocab_tree &vocab, std::vector<uchar> &centers, cv::RNG &rng) {
+  const int nbytes = train.cols;
+  const int k = VOCAB_BRANCHING;
+
+  // Leaves become words
+  if(level == VOCAB_DEPTH || (int) members.size() <= k) {
+    vocab.word_id[node] = vocab.num_words++;
+    return;
+  }
+
+  // Seed the centers k-means++ style so they spread out over the node
+  std::vector<int> seeds;
+  seeds.push_back(members[rng.uniform(0, (int) members.size())]);
+  std::vector<int> min_dist(members.size(), INT_MAX);
+  while((int) seeds.size() < k) {
+    const uchar *last = train.ptr<uchar>(seeds.back());
+    double total = 0;
+    for(int i = 0; i < members.size(); i++) {
+      int d = hamming_distance(train.ptr<uchar>(members[i]), last, nbytes);
+      min_dist[i] = std::min(min_dist[i], d);
+      total += (double) min_dist[i] * min_dist[i];
+    }
+    if(total == 0) break; // every descriptor is already on a seed
+
+    double pick = rng.uniform(0.0, total);
+    int chosen = (int) members.size() - 1;
+    for(int i = 0; i < members.size(); i++) {
+      pick -= (double) min_dist[i] * min_dist[i];
+      if(pick <= 0) {
+        chosen = i;
+        break;
+      }
+    }
+    seeds.push_back(members[chosen]);
+  }
+
+  if(seeds.size() < 2) {
+    vocab.word_id[node] = vocab.num_words++;
+    return;
+  }
+
+  int nclusters = (int) seeds.size();
+  cv::Mat cluster_centers(nclusters, nbytes, CV_8U);
+  for(int c = 0; c < nclusters; c++) {
+    train.row(seeds[c]).copyTo(cluster_centers.row(c));
+  }
+
+  // k-majority: assign to the closest center by hamming distance, then take the bitwise majority
+  std::vector<int> assignment(members.size(), -1);
+  for(int iter = 0; iter < VOCAB_ITERATIONS; iter++) {
+    bool changed = false;
+    for(int i = 0; i < members.size(); i++) {
+      const uchar *desc = train.ptr<uchar>(members[i]);
+      int best = 0;
+      int best_dist = INT_MAX;
+      for(int c = 0; c < nclusters; c++) {
+        int d = hamming_distance(cluster_centers.ptr<uchar>(c), desc, nbytes);
+        if(d < best_dist) {
+          best_dist = d;
+          best = c;
+        }
+      }
+      if(assignment[i] != best) {
+        assignment[i] = best;
+        changed = true;
+      }
+    }
+    if(!changed) break;
+
+    std::vector<int> bit_counts(nclusters * nbytes * 8, 0);
+    std::vector<int> sizes(nclusters, 0);
+    for(int i = 0; i < members.size(); i++) {
+      const uchar *desc = train.ptr<uchar>(members[i]);
+      int *counts = &bit_counts[assignment[i] * nbytes * 8];
+      sizes[assignment[i]]++;
+      for(int b = 0; b < nbytes; b++) {
+        for(int bit = 0; bit < 8; bit++) {
+          if(desc[b] & (1 << bit)) counts[b * 8 + bit]++;
+        }
+      }
+    }
+
+    for(int c = 0; c < nclusters; c++) {
+      if(sizes[c] == 0) continue; // keep the old center, it'll be dropped if it stays empty
+      uchar *center = cluster_centers.ptr<uchar>(c);
+      const int *counts = &bit_counts[c * nbytes * 8];
+      for(int b = 0; b < nbytes; b++) {
+        uchar byte = 0;
+        for(int bit = 0; bit < 8; bit++) {
+          if(2 * counts[b * 8 + bit] > sizes[c]) byte |= (uchar) (1 << bit);
+        }
+        center[b] = byte;
+      }
+    }
+  }
+
+  // Split the members by cluster and drop the empty ones
+  std::vector<std::vector<int> > children(nclusters);
+  for(int i = 0; i < members.size(); i++) {
+    children[assignment[i]].push_back(members[i]);
+  }
+
+  std::vector<int> child_nodes;
+  std::vector<int> child_clusters;
+  for(int c = 0; c < nclusters; c++) {
+    if(children[c].empty()) continue;
+    child_nodes.push_back(add_node(vocab, centers, cluster_centers.ptr<uchar>(c), nbytes));
+    child_clusters.push_back(c);
+  }
+
+  if(child_nodes.size() < 2) {
+    // The node didn't split, so it's a word. Remove the child we just added.
+    vocab.first_child.resize(child_nodes.empty() ? vocab.first_child.size() : child_nodes[0]);
+    vocab.num_children.resize(vocab.first_child.size());
+    vocab.word_id.resize(vocab.first_child.size());
+    centers.resize(vocab.first_child.size() * nbytes);
+    vocab.word_id[node] = vocab.num_words++;
+    return;
+  }
+
+  vocab.first_child[node] = child_nodes[0];
+  vocab.num_children[node] = (int) child_nodes.size();
+  for(int i = 0; i < child_nodes.size(); i++) {
+    cluster_node(train, children[child_clusters[i]], child_nodes[i], level + 1, vocab, centers, rng);
+  }
+}
+
+/**
+ * @brief Function to find the word of a descriptor by walking down the vocabulary tree
+ *
+ * @param vocab trained vocabulary tree
+ * @param desc descriptor to quantize
+ * @return int word id of the descriptor
+ */
+static int quantize(const vocab_tree &vocab, const uchar *desc) {
+  const int nbytes = vocab.centers.cols;
+  int node = 0;
+  while(vocab.first_child[node] != -1) {
+    int first = vocab.first_child[node];
+    int best = first;
+    int best_dist = INT_MAX;
+    for(int c = first; c < first + vocab.num_children[node]; c++) {
+      int d = hamming_distance(vocab.centers.ptr<uchar>(c), desc, nbytes);
+      if(d < best_dist) {
+        best_dist = d;
+        best = c;
+      }
+    }
+    node = best;
+  }
+  return vocab.word_id[node];
+}
+
+/**
+ * @brief Function to fill the inverted index from the bag of words of every target
+ *
+ * @param db database whose vocabulary and bags of words are ready
+ */
+static void fill_inverted_index(model_db &db) {
+  db.inverted_index.assign(db.vocab.num_words, std::vector<inverted_entry>());
+  for(int t = 0; t < db.targets.size(); t++) {
+    for(int i = 0; i < db.targets[t].bow.size(); i++) {
+      inverted_entry entry;
+      entry.target = t;
+      entry.weight = db.targets[t].bow[i].second;
+      db.inverted_index[db.targets[t].bow[i].first].push_back(entry);
+    }
+  }
+}
+
+/**
+ * @brief Function to hash the names and descriptors of the targets so a saved index can be checked against them
+ *
+ * @param db database of targets
+ * @return uint64_t FNV-1a hash of the targets
+ */
+static uint64_t hash_targets(const model_db &db) {
+  uint64_t hash = 14695981039346656037ULL;
+  for(int t = 0; t < db.targets.size(); t++) {
+    const model_target &target = db.targets[t];
+    for(int i = 0; i < target.name.size(); i++) {
+      hash = (hash ^ (uchar) target.name[i]) * 1099511628211ULL;
+    }
+    for(int r = 0; r < target.descriptors.rows; r++) {
+      const uchar *row = target.descriptors.ptr<uchar>(r);
+      for(int c = 0; c < target.descriptors.cols; c++) {
+        hash = (hash ^ row[c]) * 1099511628211ULL;
+      }
+    }
+  }
+  return hash;
+}
+
+/**
+ * @brief Function to write a vector to a binary file as its length followed by its elements
+ *
+ * @param fp file to write to
+ * @param vec vector to write
+ * @return bool true if it was all written
+ */
+template <typename T>
+static bool write_vec(FILE *fp, const std::vector<T> &vec) {
+  uint64_t n = vec.size();
+  if(std::fwrite(&n, sizeof(n), 1, fp) != 1) return false;
+  return n == 0 || std::fwrite(vec.data(), sizeof(T), n, fp) == n;
+}
+
+/**
+ * @brief Function to read a vector written by write_vec
+ *
+ * @param fp file to read from
+ * @param file_size size of the file, a length that runs past its end is rejected before anything is allocated
+ * @param vec output vector
+ * @return int return non-zero value on failure
+ */
+template <typename T>
+static int read_vec(FILE *fp, uint64_t file_size, std::vector<T> &vec) {
+  uint64_t n = 0;
+  if(std::fread(&n, sizeof(n), 1, fp) != 1) return -1;
+  long pos = ftell(fp);
+  if(pos < 0 || (uint64_t) pos > file_size || n > (file_size - (uint64_t) pos) / sizeof(T)) return -1;
+  vec.resize(n);
+  if(n > 0 && std::fread(vec.data(), sizeof(T), n, fp) != n) return -1;
+  return 0;
+}
+
+/**
+ * @brief Function to check a vocabulary tree read from a file, so walking it stays inside its arrays
+ * and always reaches a word
+ *
+ * @param vocab vocabulary tree
+ * @return bool true if every node and word is in range
+ */
+static bool valid_vocab(const vocab_tree &vocab) {
+  const int nodes = vocab.centers.rows;
+  if(vocab.num_words <= 0 || vocab.first_child.size() != (size_t) nodes || vocab.num_children.size() != (size_t) nodes ||
+     vocab.word_id.size() != (size_t) nodes || vocab.idf.size() != (size_t) vocab.num_words) return false;
+  for(int n = 0; n < nodes; n++) {
+    if(vocab.first_child[n] == -1) {
+      if(vocab.word_id[n] < 0 || vocab.word_id[n] >= vocab.num_words) return false;
+      continue;
+    }
+    // Children come after their parent, so the walk down can't loop
+    if(vocab.first_child[n] <= n || vocab.num_children[n] <= 0 ||
+       (int64_t) vocab.first_child[n] + vocab.num_children[n] > nodes) return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Function to check a matcher index read from a file against the descriptors it's over
+ *
+ * @param index matcher index
+ * @return bool true if every key bit, bucket and item is in range
+ */
+static bool valid_hamming_index(const hamming_index &index) {
+  const int nbuckets = 1 << HAMMING_LSH_KEY_BITS;
+  const int nbits = index.descriptors.cols * 8;
+  for(int t = 0; t < index.key_bits.size(); t++) {
+    const std::vector<int> &bits = index.key_bits[t];
+    const std::vector<int> &start = index.bucket_start[t];
+    const std::vector<int> &items = index.bucket_items[t];
+    if(bits.size() != HAMMING_LSH_KEY_BITS || start.size() != (size_t) nbuckets + 1 ||
+       start[0] != 0 || start[nbuckets] != (int) items.size()) return false;
+    for(int i = 0; i < bits.size(); i++) {
+      if(bits[i] < 0 || bits[i] >= nbits) return false;
+    }
+    for(int b = 0; b < nbuckets; b++) {
+      if(start[b + 1] < start[b]) return false;
+    }
+    for(int i = 0; i < items.size(); i++) {
+      if(items[i] < 0 || items[i] >= index.descriptors.rows) return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Function to save the trained vocabulary, bags of words and matcher indices to a binary file
+ *
+ * @param db database with a built index
+ * @param filename file to write
+ * @return int return non-zero value on failure
+ */
+int save_model_db_index(const model_db &db, const std::string &filename) {
+  // Written next to the old file and renamed over it, so a crash never leaves half an index behind
+  std::string tmp_name = filename + ".tmp." + std::to_string((long) getpid());
+  FILE *fp = fopen(tmp_name.c_str(), "wb");
+  if(!fp) {
+    printf("Unable to open output file %s\n", tmp_name.c_str());
+    return -1;
+  }
+
+  uint32_t header[2] = { MODEL_DB_MAGIC, MODEL_DB_VERSION };
+  uint64_t hash = hash_targets(db);
+  uint64_t ntargets = db.targets.size();
+  bool ok = std::fwrite(header, sizeof(header), 1, fp) == 1 && std::fwrite(&hash, sizeof(hash), 1, fp) == 1 &&
+            std::fwrite(&ntargets, sizeof(ntargets), 1, fp) == 1;
+
+  // Vocabulary tree
+  const vocab_tree &vocab = db.vocab;
+  int32_t dims[3] = { vocab.centers.rows, vocab.centers.cols, vocab.num_words };
+  cv::Mat centers = vocab.centers.isContinuous() ? vocab.centers : vocab.centers.clone();
+  size_t center_bytes = centers.total() * centers.elemSize();
+  ok = ok && std::fwrite(dims, sizeof(dims), 1, fp) == 1 && std::fwrite(centers.data, 1, center_bytes, fp) == center_bytes &&
+       write_vec(fp, vocab.first_child) && write_vec(fp, vocab.num_children) &&
+       write_vec(fp, vocab.word_id) && write_vec(fp, vocab.idf);
+
+  // Bag of words and matcher index of every target
+  for(int t = 0; ok && t < db.targets.size(); t++) {
+    const model_target &target = db.targets[t];
+    uint8_t use_lsh = target.index.use_lsh ? 1 : 0;
+    uint64_t ntables = target.index.key_bits.size();
+    ok = write_vec(fp, target.bow) && std::fwrite(&use_lsh, sizeof(use_lsh), 1, fp) == 1 &&
+         std::fwrite(&ntables, sizeof(ntables), 1, fp) == 1;
+    for(int i = 0; ok && i < ntables; i++) {
+      ok = write_vec(fp, target.index.key_bits[i]) && write_vec(fp, target.index.bucket_start[i]) &&
+           write_vec(fp, target.index.bucket_items[i]);
+    }
+  }
+
+  ok = std::ferror(fp) == 0 && ok;
+  ok = fclose(fp) == 0 && ok;
+  if(!ok || rename(tmp_name.c_str(), filename.c_str()) != 0) {
+    printf("Unable to write index %s\n", filename.c_str());
+    unlink(tmp_name.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Function to load the trained index saved by save_model_db_index. The targets must already
+ * be loaded and match the ones the index was trained on.
+ *
+ * @param db database whose targets have been loaded
+ * @param filename file to read
+ * @return int return non-zero value if the file is missing, corrupt or out of date
+ */
+int load_model_db_index(model_db &db, const std::string &filename) {
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if(!fp) return -1;
+  struct stat st;
+  if(fstat(fileno(fp), &st) != 0) {
+    fclose(fp);
+    return -1;
+  }
+  uint64_t file_size = (uint64_t) st.st_size;
+
+  uint32_t header[2] = { 0, 0 };
+  uint64_t hash = 0;
+  uint64_t ntargets = 0;
+  int32_t dims[3] = { 0, 0, 0 };
+  if(std::fread(header, sizeof(header), 1, fp) != 1 || header[0] != MODEL_DB_MAGIC || header[1] != MODEL_DB_VERSION ||
+     std::fread(&hash, sizeof(hash), 1, fp) != 1 || hash != hash_targets(db) ||
+     std::fread(&ntargets, sizeof(ntargets), 1, fp) != 1 || ntargets != db.targets.size() ||
+     std::fread(dims, sizeof(dims), 1, fp) != 1 || dims[0] <= 0 || dims[1] <= 0 ||
+     (uint64_t) dims[0] * dims[1] > file_size) {
+    printf("Index %s is out of date, rebuilding it\n", filename.c_str());
+    fclose(fp);
+    return -1;
+  }
+
+  vocab_tree vocab;
+  vocab.centers.create(dims[0], dims[1], CV_8U);
+  vocab.num_words = dims[2];
+  std::vector<model_target> &targets = db.targets;
+  std::vector<std::vector<std::pair<int, float> > > bows(targets.size());
+  std::vector<hamming_index> indices(targets.size());
+  bool ok = std::fread(vocab.centers.data, 1, vocab.centers.total(), fp) == vocab.centers.total() &&
+            read_vec(fp, file_size, vocab.first_child) == 0 && read_vec(fp, file_size, vocab.num_children) == 0 &&
+            read_vec(fp, file_size, vocab.word_id) == 0 && read_vec(fp, file_size, vocab.idf) == 0 &&
+            valid_vocab(vocab);
+
+  for(int t = 0; ok && t < targets.size(); t++) {
+    uint8_t use_lsh = 0;
+    uint64_t ntables = 0;
+    ok = read_vec(fp, file_size, bows[t]) == 0 && std::fread(&use_lsh, sizeof(use_lsh), 1, fp) == 1 &&
+         std::fread(&ntables, sizeof(ntables), 1, fp) == 1 && ntables <= HAMMING_LSH_TABLES;
+    // Model descriptors are compared against the centers byte for byte
+    ok = ok && (targets[t].descriptors.empty() || targets[t].descriptors.cols == dims[1]);
+    for(int i = 0; ok && i < bows[t].size(); i++) {
+      ok = bows[t][i].first >= 0 && bows[t][i].first < vocab.num_words;
+    }
+    if(!ok) break;
+
+    hamming_index &index = indices[t];
+    index.descriptors = targets[t].descriptors;
+    index.use_lsh = use_lsh != 0;
+    index.key_bits.resize(ntables);
+    index.bucket_start.resize(ntables);
+    index.bucket_items.resize(ntables);
+    for(int i = 0; ok && i < ntables; i++) {
+      ok = read_vec(fp, file_size, index.key_bits[i]) == 0 && read_vec(fp, file_size, index.bucket_start[i]) == 0 &&
+           read_vec(fp, file_size, index.bucket_items[i]) == 0;
+    }
+    ok = ok && valid_hamming_index(index);
+  }
+  fclose(fp);
+
+  if(!ok) {
+    printf("Index %s is corrupt, rebuilding it\n", filename.c_str());
+    return -1;
+  }
+
+  db.vocab = vocab;
+  for(int t = 0; t < targets.size(); t++) {
+    targets[t].bow = bows[t];
+    targets[t].index = indices[t];
+  }
+  fill_inverted_index(db);
+  return 0;
+}
+
+/**
+ * @brief Function to load every model image in a directory into the database and build the inverted index.
+ * Keypoints and descriptors come from the feature cache in the directory for images that haven't changed.
+ *
+ * @param detector ORB detector
+ * @param dirname directory that holds the model images
+ * @param db output database of targets
+ * @param index_path file to load the trained index from and save it to, empty to always rebuild it
+ * @return int return non-zero value on failure
+ */
+int load_model_db(cv::Ptr<cv::ORB> detector, const std::string &dirname, model_db &db, const std::string &index_path) {
+  DIR *dp = opendir(dirname.c_str());
+  if(dp == nullptr) {
+    printf("Could not find directory %s\n", dirname.c_str());
+    return -1;
+  }
+
+  // Sort the names so target ids don't depend on the order of the directory. Hidden files like the cache are skipped.
+  std::vector<std::string> names;
+  struct dirent *entry = nullptr;
+  while ((entry = readdir(dp))) {
+    std::string name = entry->d_name;
+    if(name.empty() || name[0] == '.') continue;
+    names.push_back(name);
+  }
+  closedir(dp);
+  std::sort(names.begin(), names.end());
+
+  std::string cache_path = dirname + FEATURE_CACHE_NAME;
+  feature_cache cache;
+  bool have_cache = open_feature_cache(cache_path, detector, cache) == 0;
+  bool cache_stale = !have_cache;
+  int num_cached = 0;
+
+  db.targets.clear();
+  for(int i = 0; i < names.size(); i++) {
+    model_target target;
+    target.name = names[i];
+    std::string path = dirname + names[i];
+    struct stat st;
+    if(stat(path.c_str(), &st) == 0) {
+      // Keep the nanoseconds so an image re-exported within the same second at the same size is still seen as changed
+      target.mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+      target.file_size = (int64_t) st.st_size;
+    }
+
+    // Only decode the image and run ORB on it if the cache doesn't have it
+    if(have_cache && read_cached_features(cache, target)) {
+      num_cached++;
+      db.targets.push_back(target);
+      continue;
+    }
+    if(get_model_kp_desc(detector, path, target.model, target.keypoints, target.descriptors) != 0) {
+      continue;
+    }
+    if(target.descriptors.empty()) {
+      printf("no descriptors in model %s\n", names[i].c_str());
+      continue;
+    }
+    target.size = target.model.size();
+    db.targets.push_back(target);
+    cache_stale = true;
+  }
+
+  if(db.targets.empty()) {
+    printf("No model images found in %s\n", dirname.c_str());
+    return -1;
+  }
+
+  // Keep the mapping alive as long as the cached descriptors are in use, and rewrite the cache if anything changed
+  if(num_cached > 0) db.feature_mapping = cache.mapping;
+  if(cache_stale || num_cached != cache.entries.size()) {
+    if(save_feature_cache(cache_path, detector, db.targets) == 0) {
+      printf("Saved features of %d targets to %s\n", (int) db.targets.size(), cache_path.c_str());
+    }
+  }
+
+  printf("Loaded %d targets (%d from the feature cache)\n", (int) db.targets.size(), num_cached);
+  if(!index_path.empty() && load_model_db_index(db, index_path) == 0) {
+    printf("Loaded trained index from %s\n", index_path.c_str());
+    return 0;
+  }
+
+  if(build_model_db_index(db) != 0) return -1;
+  if(!index_path.empty()) save_model_db_index(db, index_path);
+  return 0;
+}
+
+/**
+ * @brief Function to get the resized model image of a target, reading it again if its features came from the cache
+ *
+ * @param dirname directory that holds the model images
+ * @param target target
+ * @param model output model image
+ * @return int return non-zero value if the image could not be read
+ */
+int get_model_image(const std::string &dirname, const model_target &target, cv::Mat &model) {
+  if(!target.model.empty()) {
+    model = target.model;
+    return 0;
+  }
+  cv::Mat model_raw = cv::imread(dirname + target.name, cv::IMREAD_GRAYSCALE);
+  if(model_raw.empty()) {
+    printf("Could not read model image %s\n", target.name.c_str());
+    return -1;
+  }
+  cv::resize(model_raw, model, target.size);
+  return 0;
+}
+
+/**
+ * @brief Function to train the vocabulary tree on the descriptors of every target and fill the inverted index
+ *
+ * @param db database whose targets have already been loaded
+ * @return int return non-zero value on failure
+ */
+int build_model_db_index(model_db &db) {
+  if(db.targets.empty()) return -1;
+
+  std::vector<cv::Mat> all_desc;
+  for(int t = 0; t < db.targets.size(); t++) {
+    all_desc.push_back(db.targets[t].descriptors);
+  }
+  cv::Mat train;
+  cv::vconcat(all_desc, train);
+  const int nbytes = train.cols;
+
+  // Grow the tree from the root
+  vocab_tree &vocab = db.vocab;
+  vocab = vocab_tree();
+  std::vector<uchar> centers;
+  std::vector<uchar> zero(nbytes, 0);
+  add_node(vocab, centers, zero.data(), nbytes);
+
+  std::vector<int> members(train.rows);
+  for(int i = 0; i < train.rows; i++) members[i] = i;
+  cv::RNG rng(0x5eed);
+  cluster_node(train, members, 0, 0, vocab, centers, rng);
+  vocab.centers = cv::Mat((int) vocab.first_child.size(), nbytes, CV_8U, centers.data()).clone();
+
+  // Inverse document frequency of each word over the targets
+  std::vector<int> doc_freq(vocab.num_words, 0);
+  for(int t = 0; t < db.targets.size(); t++) {
+    const cv::Mat &desc = db.targets[t].descriptors;
+    std::vector<bool> seen(vocab.num_words, false);
+    for(int i = 0; i < desc.rows; i++) {
+      int w = quantize(vocab, desc.ptr<uchar>(i));
+      if(!seen[w]) {
+        seen[w] = true;
+        doc_freq[w]++;
+      }
+    }
+  }
+
+  // log(1 + N/n) instead of log(N/n) so a database with one target still scores
+  const float ntargets = (float) db.targets.size();
+  vocab.idf.assign(vocab.num_words, 0.0f);
+  for(int w = 0; w < vocab.num_words; w++) {
+    if(doc_freq[w] > 0) vocab.idf[w] = std::log(1.0f + ntargets / (float) doc_freq[w]);
+  }
+
+  // Bag of words and matcher index for each target
+  for(int t = 0; t < db.targets.size(); t++) {
+    build_hamming_index(db.targets[t].descriptors, db.targets[t].index);
+    compute_bow(vocab, db.targets[t].descriptors, db.targets[t].bow);
+  }
+  fill_inverted_index(db);
+
+  printf("Vocabulary has %d words\n", vocab.num_words);
+  return 0;
+}
+
+/**
+ * @brief Function to turn a set of descriptors into a normalized tf-idf bag of words
+ *
+ * @param vocab trained vocabulary tree
+ * @param descriptors input array of descriptors
+ * @param bow output bag of words sorted by word id
+ * @param ws buffers to reuse, nullptr to allocate them
+ */
+void compute_bow(const vocab_tree &vocab, const cv::Mat &descriptors, std::vector<std::pair<int, float> > &bow,
+                 query_workspace *ws) {
+  bow.clear();
+  if(descriptors.empty() || vocab.num_words == 0) return;
+
+  // Accumulate into a dense array of words so nothing is allocated per descriptor
+  query_workspace local;
+  query_workspace &w = ws != nullptr ? *ws : local;
+  w.word_weight.resize(vocab.num_words, 0.0f);
+  w.words.clear();
+  for(int i = 0; i < descriptors.rows; i++) {
+    int word = quantize(vocab, descriptors.ptr<uchar>(i));
+    if(w.word_weight[word] == 0) w.words.push_back(word);
+    w.word_weight[word] += vocab.idf[word];
+  }
+  std::sort(w.words.begin(), w.words.end());
+
+  float total = 0;
+  for(int i = 0; i < w.words.size(); i++) {
+    total += w.word_weight[w.words[i]];
+  }
+
+  for(int i = 0; i < w.words.size(); i++) {
+    float weight = w.word_weight[w.words[i]];
+    if(total > 0 && weight > 0) bow.push_back(std::make_pair(w.words[i], weight / total));
+    w.word_weight[w.words[i]] = 0; // leave the array clear for the next call
+  }
+}
+
+/**
+ * @brief Function to find the targets that are most likely in the scene
+ *
+ * @param db database of targets
+ * @param desc_scene input array of descriptors of keypoints in the scene
+ * @param max_candidates maximum number of candidates to return
+ * @param candidates output vector of (target index, score) sorted by best score first
+ * @param ws buffers to reuse, nullptr to allocate them
+ */
+void query_model_db(const model_db &db, const cv::Mat &desc_scene, int max_candidates, std::vector<std::pair<int, float> > &candidates,
+                    query_workspace *ws) {
+  candidates.clear();
+  if(db.targets.empty() || desc_scene.empty()) return;
+
+  query_workspace local;
+  query_workspace &w = ws != nullptr ? *ws : local;
+  compute_bow(db.vocab, desc_scene, w.bow, &w);
+
+  // L1 score, for normalized vectors this is the sum of the smaller weight of every shared word.
+  // Only the targets that share a word with the scene are touched.
+  w.score.resize(db.targets.size(), 0.0f);
+  w.touched.clear();
+  for(int i = 0; i < w.bow.size(); i++) {
+    const std::vector<inverted_entry> &entries = db.inverted_index[w.bow[i].first];
+    for(int e = 0; e < entries.size(); e++) {
+      int t = entries[e].target;
+      if(w.score[t] == 0) w.touched.push_back(t);
+      w.score[t] += std::min(w.bow[i].second, entries[e].weight);
+    }
+  }
+
+  for(int i = 0; i < w.touched.size(); i++) {
+    candidates.push_back(std::make_pair(w.touched[i], w.score[w.touched[i]]));
+    w.score[w.touched[i]] = 0;
+  }
+
+  int n = std::min(max_candidates, (int) candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end(),
+                    [](const std::pair<int, float> &a, const std::pair<int, float> &b) {
+                      return a.second > b.second || (a.second == b.second && a.first < b.first);
+                    });
+  candidates.resize(n);
+}
@@ -0,0 +1,197 @@
+/**
+ * @file pipeline_main.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Markerless AR split into capture, feature, pose and render stages that run on their own threads
+ * @date 2026-10-17
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <dirent.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <opencv2/opencv.hpp>
+#include "../include/csv_util.h"
+#include "../include/markerless.h"
+#include "../include/model_db.h"
+#include "../include/tracker.h"
+#include "../include/frame_queue.h"
+#include "../include/cal_store.h"
+
+#define PIPELINE_QUEUE_SIZE 4 // frames each queue holds before it drops the oldest
+
+/**
+ * @brief A frame on its way through the pipeline
+ */
+struct frame_packet {
+  int64 id = 0; // frame number
+  int64 capture_tick = 0; // tick count when the frame was captured
+  cv::Mat frame; // color frame from the camera
+  cv::Mat gray; // grayscale frame
+  frame_result result; // features and pose found in the frame
+};
+
+static std::atomic<bool> running(true);
+
+/**
+ * @brief Function to wait a little when a stage has nothing to do
+ */
+static void idle() {
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+int main(int argc, char *argv[]) {
+  bool tracking = false;
+  bool use_roi = false;
+  int smoothing = POSE_FILTER_DEFAULT_WINDOW;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "-t") == 0) {
+      printf("In Tracking Mode\n");
+      tracking = true;
+    } else if(strcmp(argv[i], "-r") == 0) {
+      printf("In ROI Detection Mode\n");
+      use_roi = true;
+    } else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      smoothing = atoi(argv[++i]);
+    } else {
+      printf("error :: usage : use the flag -t to track between detections, -r to only detect around the last pose, -s N to average the pose over N frames\n");
+      exit(-1);
+    }
+  }
+
+  cv::VideoCapture *capdev; // open the video device
+  capdev = new cv::VideoCapture(0);
+  if( !capdev->isOpened() ) {
+    printf("Unable to open video device\n");
+    return(-1);
+  }
+
+  // get some properties of the image
+  cv::Size refS( (int) capdev->get(cv::CAP_PROP_FRAME_WIDTH ),
+                  (int) capdev->get(cv::CAP_PROP_FRAME_HEIGHT));
+  printf("Expected size: %d %d\n", refS.width, refS.height);
+
+  // Delcare calibration data
+  cv::Mat cam_mat(3, 3, CV_64FC1);
+  cv::Mat dist_coef(5, 1, CV_64FC1);
+
+  load_camera_calibration(CAL_STORE_NAME, "calibration.csv", camera_identifier(0), refS, cam_mat, dist_coef);
+
+  // Each stage that detects gets its own ORB detector
+  cv::Ptr<cv::ORB> orb_features = cv::ORB::create();
+  cv::Ptr<cv::ORB> orb_pose = cv::ORB::create();
+
+  model_db db;
+  if(load_model_db(orb_features, "./model_images/", db, "model_db.idx") != 0) {
+    exit(-1);
+  }
+  const model_db &models = db;
+
+  frame_queue<frame_packet> captured(PIPELINE_QUEUE_SIZE);
+  frame_queue<frame_packet> featured(PIPELINE_QUEUE_SIZE);
+  frame_queue<frame_packet> posed(PIPELINE_QUEUE_SIZE);
+  std::atomic<bool> locked(false); // the pose stage is tracking, so the feature stage can skip ORB
+  std::atomic<bool> have_roi(false); // the pose stage will detect around the last pose itself
+
+  // Capture stage
+  std::thread capture_thread([&]() {
+    int64 id = 0;
+    while(running.load()) {
+      frame_packet packet;
+      *capdev >> packet.frame; // get a new frame from the camera, treat as a stream
+      if( packet.frame.empty() ) {
+        printf("frame is empty\n");
+        running.store(false);
+        break;
+      }
+      packet.id = id++;
+      packet.capture_tick = cv::getTickCount();
+      captured.push(packet);
+    }
+  });
+
+  // Feature stage: grayscale and ORB
+  std::thread feature_thread([&]() {
+    frame_packet packet;
+    while(running.load()) {
+      if(!captured.pop(packet)) {
+        idle();
+        continue;
+      }
+      luma_from_bgr(packet.frame, packet.gray);
+      if(!(tracking && locked.load()) && !(use_roi && have_roi.load())) {
+        extract_features(orb_features, packet.gray, packet.result);
+      }
+      featured.push(packet);
+    }
+  });
+
+  // Pose stage: database query, matching, homography and solvePnP, or optical flow while tracking.
+  // In ROI mode this stage also runs ORB around the last pose.
+  std::thread pose_thread([&]() {
+    planar_tracker tracker;
+    pose_filter_init(tracker.filter, smoothing);
+    tracker.use_roi = use_roi;
+    frame_packet packet;
+    while(running.load()) {
+      if(!featured.pop(packet)) {
+        idle();
+        continue;
+      }
+      locate_target(tracker, models, orb_pose, packet.gray, cam_mat, dist_coef, tracking, packet.result);
+      locked.store(tracker.locked);
+      have_roi.store(!tracker.roi_corners.empty());
+      posed.push(packet);
+    }
+  });
+
+  // Render stage stays on the main thread since that's where the window lives
+  std::string winName = "Markerless AR Pipeline";
+  cv::namedWindow(winName, 1);
+  double tick_ms = 1000.0 / cv::getTickFrequency();
+  int64 report_tick = cv::getTickCount();
+  int frames = 0;
+  double latency_ms = 0;
+  frame_packet packet;
+  while(running.load()) {
+    if(posed.pop(packet)) {
+      if(packet.result.have_pose) {
+        draw_pose(packet.frame, packet.result.scene_corners, packet.result.rotations, packet.result.translations, cam_mat, dist_coef);
+      }
+      cv::imshow(winName, packet.frame);
+      frames++;
+      latency_ms += (cv::getTickCount() - packet.capture_tick) * tick_ms;
+    }
+
+    // Report the throughput and how full each queue is once a second
+    double elapsed_ms = (cv::getTickCount() - report_tick) * tick_ms;
+    if(elapsed_ms >= 1000.0) {
+      printf("fps %.1f latency %.1f ms | capture->features %d (dropped %d) | features->pose %d (dropped %d) | pose->render %d (dropped %d)\n",
+              frames * 1000.0 / elapsed_ms, frames > 0 ? latency_ms / frames : 0.0,
+              (int) captured.depth(), (int) captured.dropped(), (int) featured.depth(), (int) featured.dropped(),
+              (int) posed.depth(), (int) posed.dropped());
+      frames = 0;
+      latency_ms = 0;
+      report_tick = cv::getTickCount();
+    }
+
+    char keyEx = cv::waitKeyEx(1);
+    if(keyEx == 'q') {
+      running.store(false);
+    }
+  }
+
+  capture_thread.join();
+  feature_thread.join();
+  pose_thread.join();
+
+  printf("Bye!\n");
+
+  delete capdev;
+  return 0;
+}
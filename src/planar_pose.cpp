@@ -0,0 +1,387 @@
+/**
+ * @file planar_pose.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Pose of a planar target from its matches with PROSAC and IPPE
+ * @date 2026-10-17
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "../include/planar_pose.h"
+#include "../include/metrics.h"
+
+/**
+ * @brief Function to get twice the signed area of a triangle
+ *
+ * @param a first point
+ * @param b second point
+ * @param c third point
+ * @return double cross product of b - a and c - a
+ */
+static double cross(const cv::Point2f &a, const cv::Point2f &b, const cv::Point2f &c) {
+  return (double) (b.x - a.x) * (c.y - a.y) - (double) (b.y - a.y) * (c.x - a.x);
+}
+
+/**
+ * @brief Function to check that a sample can give a sensible homography. No three model points can be
+ * on a line, and every triangle has to keep its orientation in the scene since a plane can't be flipped.
+ *
+ * @param model four model points
+ * @param scene four matching scene points
+ * @return bool true if the sample is usable
+ */
+static bool sample_ok(const cv::Point2f model[4], const cv::Point2f scene[4]) {
+  static const int triples[4][3] = { { 0, 1, 2 }, { 0, 1, 3 }, { 0, 2, 3 }, { 1, 2, 3 } };
+  for(int i = 0; i < 4; i++) {
+    double m = cross(model[triples[i][0]], model[triples[i][1]], model[triples[i][2]]);
+    double s = cross(scene[triples[i][0]], scene[triples[i][1]], scene[triples[i][2]]);
+    if(std::fabs(m) < 1.0 || m * s <= 0) return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Function to count the points a homography maps within thresh of their match
+ *
+ * @param h homography, row major
+ * @param model_pts points in the model
+ * @param scene_pts matching points in the scene
+ * @param thresh2 squared distance threshold
+ * @param mask output mask of the inliers
+ * @return int number of inliers
+ */
+static int count_inliers(const double h[9], const std::vector<cv::Point2f> &model_pts, const std::vector<cv::Point2f> &scene_pts,
+                         double thresh2, std::vector<uchar> &mask) {
+  int count = 0;
+  for(int i = 0; i < model_pts.size(); i++) {
+    double x = model_pts[i].x, y = model_pts[i].y;
+    double w = h[6] * x + h[7] * y + h[8];
+    bool in = false;
+    if(std::fabs(w) > 1e-12) {
+      double dx = (h[0] * x + h[1] * y + h[2]) / w - scene_pts[i].x;
+      double dy = (h[3] * x + h[4] * y + h[5]) / w - scene_pts[i].y;
+      in = dx * dx + dy * dy < thresh2;
+    }
+    mask[i] = in ? 1 : 0;
+    count += in ? 1 : 0;
+  }
+  return count;
+}
+
+/**
+ * @brief Function to pick distinct random indices below n
+ *
+ * @param rng random number generator
+ * @param n size of the pool
+ * @param k number of indices to pick
+ * @param sample output array of indices, the first k are filled in
+ */
+static void pick_distinct(cv::RNG &rng, int n, int k, int *sample) {
+  for(int i = 0; i < k; i++) {
+    bool repeat = true;
+    while(repeat) {
+      sample[i] = rng.uniform(0, n);
+      repeat = false;
+      for(int j = 0; j < i; j++) {
+        if(sample[j] == sample[i]) repeat = true;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Function to get the homography that maps four points exactly onto four others, with h22 = 1
+ *
+ * @param src four model points
+ * @param dst four matching scene points
+ * @param h output homography, row major
+ * @return bool false if the points don't give a homography
+ */
+static bool homography_4pt(const cv::Point2f src[4], const cv::Point2f dst[4], double h[9]) {
+  cv::Matx<double, 8, 8> A;
+  cv::Matx<double, 8, 1> b;
+  for(int i = 0; i < 4; i++) {
+    double x = src[i].x, y = src[i].y, u = dst[i].x, v = dst[i].y;
+    double r0[8] = { x, y, 1, 0, 0, 0, -x * u, -y * u };
+    double r1[8] = { 0, 0, 0, x, y, 1, -x * v, -y * v };
+    for(int j = 0; j < 8; j++) {
+      A(2 * i, j) = r0[j];
+      A(2 * i + 1, j) = r1[j];
+    }
+    b(2 * i) = u;
+    b(2 * i + 1) = v;
+  }
+
+  // Matx solves on the stack, unlike getPerspectiveTransform which returns a new Mat
+  cv::Matx<double, 8, 1> x = A.solve(b, cv::DECOMP_LU);
+  bool nonzero = false;
+  for(int i = 0; i < 8; i++) {
+    if(!std::isfinite(x(i))) return false;
+    if(x(i) != 0) nonzero = true;
+    h[i] = x(i);
+  }
+  h[8] = 1;
+  return nonzero;
+}
+
+/**
+ * @brief Function to get the similarity that moves a set of points to the origin with a mean distance of sqrt(2)
+ *
+ * @param pts points
+ * @param mask mask of the points to use
+ * @param T output 3x3 normalizing transform
+ */
+static void normalizing_transform(const std::vector<cv::Point2f> &pts, const std::vector<uchar> &mask, cv::Matx33d &T) {
+  double cx = 0, cy = 0;
+  int n = 0;
+  for(int i = 0; i < pts.size(); i++) {
+    if(!mask[i]) continue;
+    cx += pts[i].x;
+    cy += pts[i].y;
+    n++;
+  }
+  cx /= n;
+  cy /= n;
+
+  double dist = 0;
+  for(int i = 0; i < pts.size(); i++) {
+    if(!mask[i]) continue;
+    dist += std::sqrt((pts[i].x - cx) * (pts[i].x - cx) + (pts[i].y - cy) * (pts[i].y - cy));
+  }
+  double scale = dist > 0 ? std::sqrt(2.0) * n / dist : 1.0;
+  T = cv::Matx33d(scale, 0, -scale * cx, 0, scale, -scale * cy, 0, 0, 1);
+}
+
+/**
+ * @brief Function to fit a homography to every inlier by least squares on normalized points
+ *
+ * @param model_pts points in the model
+ * @param scene_pts matching points in the scene
+ * @param mask mask of the points to fit
+ * @param h output homography, row major
+ * @return bool false if the fit failed
+ */
+static bool refine_homography(const std::vector<cv::Point2f> &model_pts, const std::vector<cv::Point2f> &scene_pts,
+                              const std::vector<uchar> &mask, double h[9]) {
+  cv::Matx33d Tm, Ts;
+  normalizing_transform(model_pts, mask, Tm);
+  normalizing_transform(scene_pts, mask, Ts);
+
+  // Normal equations of the linear system, accumulated one point at a time
+  cv::Matx<double, 8, 8> AtA = cv::Matx<double, 8, 8>::zeros();
+  cv::Matx<double, 8, 1> Atb = cv::Matx<double, 8, 1>::zeros();
+  for(int i = 0; i < model_pts.size(); i++) {
+    if(!mask[i]) continue;
+    double x = Tm(0, 0) * model_pts[i].x + Tm(0, 2), y = Tm(1, 1) * model_pts[i].y + Tm(1, 2);
+    double u = Ts(0, 0) * scene_pts[i].x + Ts(0, 2), v = Ts(1, 1) * scene_pts[i].y + Ts(1, 2);
+    double r0[8] = { x, y, 1, 0, 0, 0, -x * u, -y * u };
+    double r1[8] = { 0, 0, 0, x, y, 1, -x * v, -y * v };
+    for(int j = 0; j < 8; j++) {
+      for(int k = 0; k < 8; k++) AtA(j, k) += r0[j] * r0[k] + r1[j] * r1[k];
+      Atb(j) += r0[j] * u + r1[j] * v;
+    }
+  }
+
+  // Matx returns zeros if the system can't be solved
+  cv::Matx<double, 8, 1> x = AtA.solve(Atb, cv::DECOMP_CHOLESKY);
+  bool nonzero = false;
+  for(int i = 0; i < 8; i++) nonzero = nonzero || x(i) != 0;
+  if(!nonzero) return false;
+  cv::Matx33d Hn(x(0), x(1), x(2), x(3), x(4), x(5), x(6), x(7), 1);
+  cv::Matx33d H = Ts.inv() * Hn * Tm;
+  if(!std::isfinite(H(2, 2)) || std::fabs(H(2, 2)) < 1e-12) return false;
+  for(int i = 0; i < 9; i++) {
+    h[i] = H(i / 3, i % 3) / H(2, 2);
+    if(!std::isfinite(h[i])) return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Function to get the point on the target's plane for a pixel of the model image. The model's
+ * corners land on (0,0), (0,-1), (-1,-1) and (-1,0) so the pose matches the one from pose_from_homography.
+ *
+ * @param pt pixel in the model image
+ * @param model_size size of the model image
+ * @return cv::Point3f point on the target's plane, z is 0
+ */
+cv::Point3f model_to_object(const cv::Point2f &pt, cv::Size model_size) {
+  return cv::Point3f(-pt.y / model_size.height, -pt.x / model_size.width, 0);
+}
+
+/**
+ * @brief Function to find a homography with PROSAC. Samples are drawn from the best matches first and the
+ * pool grows towards the rest, so a good hypothesis is usually found in the first few tries.
+ *
+ * @param model_pts points in the model, sorted best match first
+ * @param scene_pts matching points in the scene
+ * @param thresh largest distance in pixels for a point to be an inlier
+ * @param homography output 3x3 homography refined on the inliers
+ * @param inliers output mask of the points that agree with the homography
+ * @param iterations output number of hypotheses tried
+ * @param ws buffers to reuse, nullptr to allocate them
+ * @return bool true if a homography was found
+ */
+bool find_homography_prosac(const std::vector<cv::Point2f> &model_pts, const std::vector<cv::Point2f> &scene_pts, float thresh,
+                            cv::Mat &homography, std::vector<uchar> &inliers, int &iterations, pose_workspace *ws) {
+  scoped_timer timer(STAGE_HOMOGRAPHY);
+  pose_workspace local;
+  std::vector<uchar> &mask = ws != nullptr ? ws->mask : local.mask;
+  const int m = 4;
+  const int N = (int) model_pts.size();
+  inliers.assign(N, 0);
+  iterations = 0;
+  if(N < m) return false;
+
+  // Growth function of the sampling pool (Chum and Matas). T_n is how many of PROSAC_MAX_ITERS
+  // plain RANSAC samples would be drawn only from the top n points.
+  double T_n = PROSAC_MAX_ITERS;
+  for(int i = 0; i < m; i++) T_n *= (double) (m - i) / (N - i);
+  int T_n_prime = 1;
+  int n = m;
+
+  const double thresh2 = (double) thresh * thresh;
+  const double log_fail = std::log(1.0 - PROSAC_CONFIDENCE);
+  int max_iters = PROSAC_MAX_ITERS;
+  int best_count = 0;
+  double best_h[9];
+  double h[9];
+  mask.resize(N);
+  cv::RNG rng(0x5eed); // fixed seed so a frame always gives the same pose
+
+  int t = 0;
+  while(t < max_iters) {
+    t++;
+    if(t > T_n_prime && n < N) {
+      double T_next = T_n * (n + 1) / (n + 1 - m);
+      T_n_prime += (int) std::ceil(T_next - T_n);
+      T_n = T_next;
+      n++;
+    }
+
+    // Draw from the top n, always including the n-th point until the pool has grown past its schedule
+    int sample[m];
+    if(T_n_prime < t) {
+      pick_distinct(rng, n, m, sample);
+    } else {
+      pick_distinct(rng, n - 1, m - 1, sample);
+      sample[m - 1] = n - 1;
+    }
+
+    cv::Point2f src[m], dst[m];
+    for(int i = 0; i < m; i++) {
+      src[i] = model_pts[sample[i]];
+      dst[i] = scene_pts[sample[i]];
+    }
+    if(!sample_ok(src, dst) || !homography_4pt(src, dst, h)) continue;
+
+    int count = count_inliers(h, model_pts, scene_pts, thresh2, mask);
+    if(count <= best_count) continue;
+
+    best_count = count;
+    std::copy(h, h + 9, best_h);
+    inliers.swap(mask);
+    mask.resize(N);
+
+    // Stop once it's unlikely that a better hypothesis is still to be drawn
+    double w = (double) best_count / N;
+    double p_bad = 1.0 - w * w * w * w;
+    if(p_bad <= 0) break;
+    double needed = log_fail / std::log(p_bad);
+    if(needed < max_iters) max_iters = std::max(t, (int) std::ceil(needed));
+  }
+  iterations = t;
+  if(best_count < m) {
+    inliers.assign(N, 0);
+    return false;
+  }
+
+  // Refine with least squares on every inlier, keeping it only if it doesn't lose any
+  if(refine_homography(model_pts, scene_pts, inliers, h) &&
+     count_inliers(h, model_pts, scene_pts, thresh2, mask) >= best_count) {
+    std::copy(h, h + 9, best_h);
+    inliers.swap(mask);
+  }
+
+  homography.create(3, 3, CV_64F);
+  for(int i = 0; i < 9; i++) homography.at<double>(i / 3, i % 3) = best_h[i];
+  return true;
+}
+
+/**
+ * @brief Function to get the pose of a planar target from its matches. The homography comes from PROSAC
+ * ordered by match distance, then the pose is solved in closed form with IPPE on the inliers.
+ *
+ * @param matches keypoint matches, queryIdx is the model and trainIdx the scene
+ * @param keypoints_model keypoints in the model
+ * @param keypoints_scene keypoints in the scene
+ * @param model_size size of the model image
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param pose output pose
+ * @param ws buffers to reuse, nullptr to allocate them
+ * @return bool true if a pose was found
+ */
+bool solve_planar_pose(const std::vector<cv::DMatch> &matches, const std::vector<cv::KeyPoint> &keypoints_model,
+                       const std::vector<cv::KeyPoint> &keypoints_scene, cv::Size model_size,
+                       cv::Mat cam_mat, cv::Mat dist_coeffs, planar_pose &pose, pose_workspace *ws) {
+  pose_workspace local;
+  pose_workspace &w = ws != nullptr ? *ws : local;
+  pose.inliers.assign(matches.size(), 0);
+  pose.num_inliers = 0;
+  pose.iterations = 0;
+  pose.reproj_err = 0;
+  pose.scene_corners.clear();
+  if(matches.size() < 4) return false;
+
+  // PROSAC wants the most likely inliers first, and the closest descriptors are the best bet
+  w.order.resize(matches.size());
+  for(int i = 0; i < w.order.size(); i++) w.order[i] = i;
+  std::sort(w.order.begin(), w.order.end(), [&](int a, int b) {
+    return matches[a].distance < matches[b].distance || (matches[a].distance == matches[b].distance && a < b);
+  });
+
+  w.model_pts.resize(w.order.size());
+  w.scene_pts.resize(w.order.size());
+  for(int i = 0; i < w.order.size(); i++) {
+    w.model_pts[i] = keypoints_model[matches[w.order[i]].queryIdx].pt;
+    w.scene_pts[i] = keypoints_scene[matches[w.order[i]].trainIdx].pt;
+  }
+
+  if(!find_homography_prosac(w.model_pts, w.scene_pts, PROSAC_REPROJ_THRESH, pose.homography, w.sorted_inliers, pose.iterations, &w)) {
+    return false;
+  }
+
+  // Closed-form planar pose from the inliers themselves rather than four corners made up from the homography
+  w.object_pts.clear();
+  w.image_pts.clear();
+  for(int i = 0; i < w.order.size(); i++) {
+    if(!w.sorted_inliers[i]) continue;
+    pose.inliers[w.order[i]] = 1;
+    w.object_pts.push_back(model_to_object(w.model_pts[i], model_size));
+    w.image_pts.push_back(w.scene_pts[i]);
+  }
+  pose.num_inliers = (int) w.object_pts.size();
+  metrics_count(COUNT_INLIERS, pose.num_inliers);
+  scoped_timer pnp_timer(STAGE_PNP);
+  if(!cv::solvePnP(w.object_pts, w.image_pts, cam_mat, dist_coeffs, pose.rotations, pose.translations, false, cv::SOLVEPNP_IPPE)) {
+    return false;
+  }
+  pnp_timer.stop();
+
+  cv::projectPoints(w.object_pts, pose.rotations, pose.translations, cam_mat, dist_coeffs, w.projected);
+  double total = 0;
+  for(int i = 0; i < w.projected.size(); i++) {
+    cv::Point2f d = w.projected[i] - w.image_pts[i];
+    total += std::sqrt(d.x * d.x + d.y * d.y);
+  }
+  pose.reproj_err = (float) (total / w.projected.size());
+
+  w.model_corners.resize(4);
+  w.model_corners[0] = cv::Point2f( 0, 0 );
+  w.model_corners[1] = cv::Point2f( (float) model_size.width, 0 );
+  w.model_corners[2] = cv::Point2f( (float) model_size.width, (float) model_size.height );
+  w.model_corners[3] = cv::Point2f( 0, (float) model_size.height );
+  cv::perspectiveTransform(w.model_corners, pose.scene_corners, pose.homography);
+  return true;
+}
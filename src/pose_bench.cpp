@@ -0,0 +1,182 @@
+/**
+ * @file pose_bench.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Program to benchmark the LMEDS homography and solvePnP pose against PROSAC and IPPE on the sample images
+ * @date 2026-10-17
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include "../include/csv_util.h"
+#include "../include/markerless.h"
+#include "../include/hamming_match.h"
+#include "../include/planar_pose.h"
+#include "../include/frame_source.h"
+#include "../include/cal_store.h"
+
+#define BENCH_REPEATS 20
+
+/**
+ * @brief Function to measure how well a pose explains a set of matches
+ *
+ * @param matches keypoint matches, queryIdx is the model and trainIdx the scene
+ * @param keypoints_model keypoints in the model
+ * @param keypoints_scene keypoints in the scene
+ * @param mask mask of the matches to measure
+ * @param model_size size of the model image
+ * @param rotations rotations of the pose
+ * @param translations translations of the pose
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @return double mean distance in pixels between the scene points and the model points projected with the pose
+ */
+static double pose_error(const std::vector<cv::DMatch> &matches, const std::vector<cv::KeyPoint> &keypoints_model,
+                         const std::vector<cv::KeyPoint> &keypoints_scene, const std::vector<uchar> &mask, cv::Size model_size,
+                         const cv::Mat &rotations, const cv::Mat &translations, cv::Mat cam_mat, cv::Mat dist_coeffs) {
+  std::vector<cv::Point3f> object_pts;
+  std::vector<cv::Point2f> image_pts;
+  for(int i = 0; i < matches.size(); i++) {
+    if(!mask[i]) continue;
+    object_pts.push_back(model_to_object(keypoints_model[matches[i].queryIdx].pt, model_size));
+    image_pts.push_back(keypoints_scene[matches[i].trainIdx].pt);
+  }
+  if(object_pts.empty() || rotations.empty()) return -1;
+
+  std::vector<cv::Point2f> projected;
+  cv::projectPoints(object_pts, rotations, translations, cam_mat, dist_coeffs, projected);
+  double total = 0;
+  for(int i = 0; i < projected.size(); i++) {
+    cv::Point2f d = projected[i] - image_pts[i];
+    total += std::sqrt(d.x * d.x + d.y * d.y);
+  }
+  return total / projected.size();
+}
+
+int main(int argc, char *argv[]) {
+  std::string model_dir = "./model_images/";
+  std::string scene_dir = "./out_imgs/";
+  std::string camera_id; // camera the calibration is looked up under, the first video device unless set with -i
+  std::vector<std::string> dirs;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      camera_id = argv[++i];
+    } else if(argv[i][0] != '-' && dirs.size() < 2) {
+      dirs.push_back(argv[i]);
+    } else {
+      printf("error :: usage : %s [model_dir/ scene_dir/] [-i camera_id]\n", argv[0]);
+      exit(-1);
+    }
+  }
+  if(dirs.size() == 1) {
+    printf("error :: usage : %s [model_dir/ scene_dir/] [-i camera_id]\n", argv[0]);
+    exit(-1);
+  } else if(dirs.size() == 2) {
+    model_dir = dirs[0];
+    scene_dir = dirs[1];
+  }
+
+  frame_source models;
+  frame_source scenes;
+  if(open_frame_source(model_dir, models) != 0 || !models.is_dir ||
+     open_frame_source(scene_dir, scenes) != 0 || !scenes.is_dir) {
+    printf("Could not list %s and %s\n", model_dir.c_str(), scene_dir.c_str());
+    exit(-1);
+  }
+  const std::vector<std::string> &model_paths = models.paths;
+  const std::vector<std::string> &scene_paths = scenes.paths;
+
+  // Use the calibration at the size of the first scene if there is one, otherwise a pinhole camera guessed from each scene's size
+  cv::Mat cam_mat;
+  cv::Mat dist_coef;
+  cv::Mat first_scene;
+  bool calibrated = next_frame(scenes, first_scene) &&
+                    load_camera_calibration(CAL_STORE_NAME, "calibration.csv", camera_id.empty() ? camera_identifier(0) : camera_id,
+                                            first_scene.size(), cam_mat, dist_coef) == 0;
+
+  cv::Ptr<cv::ORB> orb = cv::ORB::create();
+  double tick_ms = 1000.0 / cv::getTickFrequency();
+
+  printf("model,scene,matches,lmeds_ms,prosac_ippe_ms,lmeds_inliers,prosac_inliers,prosac_iters,lmeds_err,prosac_err,corner_diff\n");
+  for(int m = 0; m < model_paths.size(); m++) {
+    cv::Mat model;
+    std::vector<cv::KeyPoint> keypoints_model;
+    cv::Mat descriptors_model;
+    if(get_model_kp_desc(orb, model_paths[m], model, keypoints_model, descriptors_model) != 0) continue;
+    hamming_index index_model;
+    build_hamming_index(descriptors_model, index_model);
+
+    for(int s = 0; s < scene_paths.size(); s++) {
+      cv::Mat scene = cv::imread(scene_paths[s], cv::IMREAD_GRAYSCALE);
+      if(scene.empty()) continue;
+      if(!calibrated) {
+        cam_mat = (cv::Mat_<double>(3, 3) << scene.cols, 0, scene.cols / 2.0, 0, scene.cols, scene.rows / 2.0, 0, 0, 1);
+        dist_coef = cv::Mat::zeros(5, 1, CV_64FC1);
+      }
+
+      std::vector<cv::KeyPoint> keypoints_scene;
+      cv::Mat descriptors_scene;
+      orb->detectAndCompute(scene, cv::noArray(), keypoints_scene, descriptors_scene);
+      std::vector<cv::DMatch> matches;
+      bool enough = false;
+      match_kps(index_model, descriptors_scene, matches, enough);
+      if(!enough) continue;
+
+      // The old path: LMEDS homography, then solvePnP on the four corners it maps
+      cv::Mat lmeds_h, lmeds_rot, lmeds_trans;
+      std::vector<uchar> lmeds_inliers;
+      std::vector<cv::Point2f> lmeds_corners;
+      int64 t0 = cv::getTickCount();
+      for(int r = 0; r < BENCH_REPEATS; r++) {
+        lmeds_h = get_homography(matches, keypoints_model, keypoints_scene, lmeds_inliers);
+        if(lmeds_h.empty()) break;
+        std::vector<cv::Point2f> model_corners(4);
+        model_corners[0] = cv::Point2f( 0, 0 );
+        model_corners[1] = cv::Point2f( (float) model.cols, 0 );
+        model_corners[2] = cv::Point2f( (float) model.cols, (float) model.rows );
+        model_corners[3] = cv::Point2f( 0, (float) model.rows );
+        cv::perspectiveTransform(model_corners, lmeds_corners, lmeds_h);
+        std::vector<cv::Vec3f> point_set { cv::Vec3f(0, 0, 0), cv::Vec3f(0, -1, 0), cv::Vec3f(-1, -1, 0), cv::Vec3f(-1, 0, 0) };
+        cv::solvePnP(point_set, lmeds_corners, cam_mat, dist_coef, lmeds_rot, lmeds_trans);
+      }
+      double lmeds_ms = (cv::getTickCount() - t0) * tick_ms / BENCH_REPEATS;
+
+      // The new path: PROSAC ordered by match distance, then IPPE on the inliers
+      planar_pose pose;
+      bool have_pose = false;
+      t0 = cv::getTickCount();
+      for(int r = 0; r < BENCH_REPEATS; r++) {
+        have_pose = solve_planar_pose(matches, keypoints_model, keypoints_scene, model.size(), cam_mat, dist_coef, pose);
+      }
+      double prosac_ms = (cv::getTickCount() - t0) * tick_ms / BENCH_REPEATS;
+
+      int lmeds_count = 0;
+      for(int i = 0; i < lmeds_inliers.size(); i++) lmeds_count += lmeds_inliers[i] ? 1 : 0;
+      double lmeds_err = lmeds_h.empty() ? -1 : pose_error(matches, keypoints_model, keypoints_scene, lmeds_inliers, model.size(),
+                                                           lmeds_rot, lmeds_trans, cam_mat, dist_coef);
+      double prosac_err = have_pose ? pose_error(matches, keypoints_model, keypoints_scene, pose.inliers, model.size(),
+                                                 pose.rotations, pose.translations, cam_mat, dist_coef) : -1;
+
+      // How far apart the two methods put the corners of the target
+      double corner_diff = -1;
+      if(have_pose && lmeds_corners.size() == 4) {
+        corner_diff = 0;
+        for(int i = 0; i < 4; i++) {
+          cv::Point2f d = pose.scene_corners[i] - lmeds_corners[i];
+          corner_diff += std::sqrt(d.x * d.x + d.y * d.y) / 4;
+        }
+      }
+
+      printf("%s,%s,%d,%.3f,%.3f,%d,%d,%d,%.3f,%.3f,%.3f\n", model_paths[m].c_str(), scene_paths[s].c_str(), (int) matches.size(),
+              lmeds_ms, prosac_ms, lmeds_count, pose.num_inliers, pose.iterations, lmeds_err, prosac_err, corner_diff);
+    }
+  }
+
+  return 0;
+}
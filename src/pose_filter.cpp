@@ -0,0 +1,67 @@
+/**
+ * @file pose_filter.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Fixed size moving average filter for homographies
+ * @date 2026-10-17
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "../include/pose_filter.h"
+
+/**
+ * @brief Function to set how many homographies the filter averages and clear its history
+ *
+ * @param filter filter to configure
+ * @param window number of homographies to average, clamped to [1, POSE_FILTER_MAX_WINDOW]
+ */
+void pose_filter_init(pose_filter &filter, int window) {
+  filter.window = std::max(1, std::min(window, POSE_FILTER_MAX_WINDOW));
+  pose_filter_reset(filter);
+}
+
+/**
+ * @brief Function to add a homography to the filter and get the smoothed homography
+ *
+ * @param filter filter to update
+ * @param homography newest 3x3 homography
+ * @param smoothed output 3x3 CV_64F average of the homographies in the window
+ */
+void pose_filter_update(pose_filter &filter, const cv::Mat &homography, cv::Mat &smoothed) {
+  // Convert into a buffer on the stack so nothing is allocated
+  double h_data[9];
+  cv::Mat h(3, 3, CV_64F, h_data);
+  homography.convertTo(h, CV_64F);
+
+  // Homographies are only defined up to scale, so scale them to h22 = 1 before averaging
+  double scale = h.at<double>(2, 2);
+  if(std::fabs(scale) < 1e-12) scale = 1.0;
+
+  // Swap the oldest homography out of the running sum
+  double *slot = filter.history[filter.next];
+  bool full = filter.count == filter.window;
+  for(int i = 0; i < 9; i++) {
+    double v = h.at<double>(i / 3, i % 3) / scale;
+    if(full) filter.sum[i] -= slot[i];
+    slot[i] = v;
+    filter.sum[i] += v;
+  }
+  if(!full) filter.count++;
+  filter.next = (filter.next + 1) % filter.window;
+
+  smoothed.create(3, 3, CV_64F);
+  for(int i = 0; i < 9; i++) {
+    smoothed.at<double>(i / 3, i % 3) = filter.sum[i] / filter.count;
+  }
+}
+
+/**
+ * @brief Function to clear the history of the filter, e.g. when the target changes
+ *
+ * @param filter filter to reset
+ */
+void pose_filter_reset(pose_filter &filter) {
+  filter.count = 0;
+  filter.next = 0;
+  for(int i = 0; i < 9; i++) filter.sum[i] = 0;
+}
@@ -0,0 +1,271 @@
+/**
+ * @file replay_bench.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Program to replay a video or image directory through the markerless pipeline without a GUI and report per-stage latency
+ * @date 2026-10-17
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <dirent.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include "../include/csv_util.h"
+#include "../include/markerless.h"
+#include "../include/model_db.h"
+#include "../include/tracker.h"
+#include "../include/frame_source.h"
+#include "../include/alloc_counter.h"
+#include "../include/cal_store.h"
+
+#define REPLAY_WARMUP_FRAMES 10 // frames before allocations are counted, while the buffers grow
+
+/**
+ * @brief Latencies of one stage over every frame
+ */
+struct stage_times {
+  const char *name;
+  std::vector<double> ms;
+};
+
+/**
+ * @brief Function to get a percentile of a set of samples by nearest rank
+ *
+ * @param sorted samples sorted in increasing order
+ * @param p percentile between 0 and 100
+ * @return double the percentile, 0 if there are no samples
+ */
+static double percentile(const std::vector<double> &sorted, double p) {
+  if(sorted.empty()) return 0;
+  size_t rank = (size_t) std::ceil(p / 100.0 * sorted.size());
+  rank = std::max((size_t) 1, std::min(rank, sorted.size()));
+  return sorted[rank - 1];
+}
+
+/**
+ * @brief Function to get the mean of a set of samples
+ *
+ * @param samples samples
+ * @return double the mean, 0 if there are no samples
+ */
+static double mean(const std::vector<double> &samples) {
+  if(samples.empty()) return 0;
+  double total = 0;
+  for(int i = 0; i < samples.size(); i++) total += samples[i];
+  return total / samples.size();
+}
+
+/**
+ * @brief Function to write a string as a quoted JSON string
+ *
+ * @param fp output file
+ * @param str string to write
+ */
+static void write_json_string(FILE *fp, const std::string &str) {
+  fputc('"', fp);
+  for(int i = 0; i < str.size(); i++) {
+    unsigned char c = (unsigned char) str[i];
+    if(c == '"' || c == '\\') {
+      fputc('\\', fp);
+      fputc(c, fp);
+    } else if(c < 0x20) {
+      fprintf(fp, "\\u%04x", c); // control characters can't appear raw in a JSON string
+    } else {
+      fputc(c, fp);
+    }
+  }
+  fputc('"', fp);
+}
+
+int main(int argc, char *argv[]) {
+  std::string source_path = "./out_imgs/";
+  std::string model_dir = "./model_images/";
+  std::string out_path;
+  int repeats = 1;
+  bool use_grid = false;
+  std::string camera_id; // camera the calibration is looked up under, the first video device unless set with -i
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      model_dir = argv[++i];
+      if(model_dir.back() != '/') model_dir += "/";
+    } else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      repeats = std::max(1, atoi(argv[++i]));
+    } else if(strcmp(argv[i], "-g") == 0) {
+      use_grid = true;
+    } else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      camera_id = argv[++i];
+    } else if(argv[i][0] != '-') {
+      source_path = argv[i];
+    } else {
+      printf("error :: usage : %s [video_or_image_dir] [-m model_dir] [-r repeats] [-g] [-o out.json] [-i camera_id]\n", argv[0]);
+      exit(-1);
+    }
+  }
+
+  cv::Ptr<cv::ORB> orb = cv::ORB::create();
+  model_db db;
+  if(load_model_db(orb, model_dir, db) != 0) {
+    exit(-1);
+  }
+
+  // -g detects the scene on a grid in parallel, the models are always found with plain ORB
+  tiled_orb tiled;
+  tiled_orb_init(tiled, orb);
+
+  // Use the calibration at the size of the first frame if there is one, otherwise a pinhole camera guessed from the frame size
+  cv::Mat cam_mat;
+  cv::Mat dist_coef;
+  bool calibrated = false;
+  {
+    frame_source src;
+    cv::Mat frame;
+    if(open_frame_source(source_path, src) == 0 && next_frame(src, frame)) {
+      calibrated = load_camera_calibration(CAL_STORE_NAME, "calibration.csv", camera_id.empty() ? camera_identifier(0) : camera_id,
+                                           frame.size(), cam_mat, dist_coef) == 0;
+    }
+  }
+
+  stage_times gray_t = { "gray", std::vector<double>() };
+  stage_times detect_t = { "detect", std::vector<double>() };
+  stage_times match_t = { "match", std::vector<double>() };
+  stage_times pose_t = { "pose", std::vector<double>() };
+  stage_times total_t = { "total", std::vector<double>() };
+  std::vector<double> keypoints, matches, inliers;
+  std::vector<double> heap_allocs, mat_allocs;
+  int frames = 0;
+  int poses = 0;
+
+  // Buffers reused every frame, like the tracker's
+  tracker_workspace ws;
+  std::vector<cv::KeyPoint> keypoints_scene;
+  cv::Mat descriptors_scene;
+  std::vector<cv::DMatch> acceptable_matches;
+  cv::Mat rotations, translations, homography;
+  std::vector<cv::Point2f> scene_corners;
+  alloc_counter_install();
+
+  double tick_ms = 1000.0 / cv::getTickFrequency();
+  int64 wall_start = cv::getTickCount();
+  for(int r = 0; r < repeats; r++) {
+    frame_source src;
+    if(open_frame_source(source_path, src) != 0) {
+      printf("Unable to open frame source %s\n", source_path.c_str());
+      exit(-1);
+    }
+
+    cv::Mat frame;
+    luma_pyramid pyr;
+    while(next_frame(src, frame)) {
+      if(!calibrated) {
+        cam_mat = (cv::Mat_<double>(3, 3) << frame.cols, 0, frame.cols / 2.0, 0, frame.cols, frame.rows / 2.0, 0, 0, 1);
+        dist_coef = cv::Mat::zeros(5, 1, CV_64FC1);
+      }
+
+      alloc_counts before = alloc_counter_read();
+      int64 t0 = cv::getTickCount();
+      luma_pyramid_build(pyr, frame);
+      int64 t1 = cv::getTickCount();
+
+      if(use_grid) {
+        tiled_orb_detect_and_compute(tiled, pyr, keypoints_scene, descriptors_scene);
+      } else {
+        orb->detectAndCompute(pyr.gray, cv::noArray(), keypoints_scene, descriptors_scene);
+      }
+      int64 t2 = cv::getTickCount();
+
+      query_model_db(db, descriptors_scene, 3, ws.candidates, &ws.query);
+      acceptable_matches.clear();
+      bool sufficient_matches = false;
+      int target_id = 0;
+      for(int c = 0; c < ws.candidates.size() && !sufficient_matches; c++) {
+        acceptable_matches.clear();
+        target_id = ws.candidates[c].first;
+        match_kps(db.targets[target_id].index, descriptors_scene, acceptable_matches, sufficient_matches, &ws.visited);
+      }
+      int64 t3 = cv::getTickCount();
+
+      int num_inliers = 0;
+      if(sufficient_matches) {
+        const model_target &target = db.targets[target_id];
+        get_rots_and_trans(acceptable_matches, target.keypoints, keypoints_scene, target.size, rotations, translations,
+                           cam_mat, dist_coef, scene_corners, homography, ws.inliers, nullptr, &ws.pose);
+        for(int i = 0; i < ws.inliers.size(); i++) num_inliers += ws.inliers[i] ? 1 : 0;
+        if(scene_corners.size() == 4) poses++;
+      }
+      int64 t4 = cv::getTickCount();
+      alloc_counts after = alloc_counter_read();
+
+      gray_t.ms.push_back((t1 - t0) * tick_ms);
+      detect_t.ms.push_back((t2 - t1) * tick_ms);
+      match_t.ms.push_back((t3 - t2) * tick_ms);
+      pose_t.ms.push_back((t4 - t3) * tick_ms);
+      total_t.ms.push_back((t4 - t0) * tick_ms);
+      keypoints.push_back((double) keypoints_scene.size());
+      matches.push_back((double) acceptable_matches.size());
+      inliers.push_back((double) num_inliers);
+      if(frames >= REPLAY_WARMUP_FRAMES) {
+        heap_allocs.push_back((double) (after.heap - before.heap));
+        mat_allocs.push_back((double) (after.mats - before.mats));
+      }
+      frames++;
+    }
+  }
+  double wall_ms = (cv::getTickCount() - wall_start) * tick_ms;
+
+  if(frames == 0) {
+    printf("No frames in %s\n", source_path.c_str());
+    exit(-1);
+  }
+
+  // Write the report as JSON
+  FILE *fp = stdout;
+  if(!out_path.empty()) {
+    fp = fopen(out_path.c_str(), "w");
+    if(!fp) {
+      printf("Unable to open output file %s\n", out_path.c_str());
+      exit(-1);
+    }
+  }
+
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"source\": ");
+  write_json_string(fp, source_path);
+  fprintf(fp, ",\n");
+  fprintf(fp, "  \"targets\": %d,\n", (int) db.targets.size());
+  fprintf(fp, "  \"extractor\": \"%s\",\n", use_grid ? "tiled" : "orb");
+  fprintf(fp, "  \"frames\": %d,\n", frames);
+  fprintf(fp, "  \"wall_ms\": %.3f,\n", wall_ms);
+  fprintf(fp, "  \"fps\": %.3f,\n", frames * 1000.0 / wall_ms);
+  fprintf(fp, "  \"stages_ms\": {\n");
+  stage_times *stages[] = { &gray_t, &detect_t, &match_t, &pose_t, &total_t };
+  int nstages = sizeof(stages) / sizeof(stages[0]);
+  for(int s = 0; s < nstages; s++) {
+    std::vector<double> sorted = stages[s]->ms;
+    std::sort(sorted.begin(), sorted.end());
+    fprintf(fp, "    \"%s\": { \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f }%s\n",
+            stages[s]->name, mean(sorted), percentile(sorted, 50), percentile(sorted, 95), percentile(sorted, 99),
+            sorted.back(), s + 1 < nstages ? "," : "");
+  }
+  fprintf(fp, "  },\n");
+  fprintf(fp, "  \"keypoints_mean\": %.3f,\n", mean(keypoints));
+  fprintf(fp, "  \"matches_mean\": %.3f,\n", mean(matches));
+  fprintf(fp, "  \"inliers_mean\": %.3f,\n", mean(inliers));
+  std::sort(heap_allocs.begin(), heap_allocs.end());
+  std::sort(mat_allocs.begin(), mat_allocs.end());
+  fprintf(fp, "  \"heap_allocs_per_frame\": { \"mean\": %.3f, \"max\": %.0f },\n", mean(heap_allocs),
+          heap_allocs.empty() ? 0.0 : heap_allocs.back());
+  fprintf(fp, "  \"mat_allocs_per_frame\": { \"mean\": %.3f, \"max\": %.0f },\n", mean(mat_allocs),
+          mat_allocs.empty() ? 0.0 : mat_allocs.back());
+  fprintf(fp, "  \"pose_rate\": %.3f\n", (double) poses / frames);
+  fprintf(fp, "}\n");
+
+  if(fp != stdout) fclose(fp);
+  return 0;
+}
@@ -0,0 +1,315 @@
+/**
+ * @file tiled_orb.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief ORB feature extraction on a grid of cells, in parallel, so the keypoints cover the whole frame
+ * @date 2026-10-17
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "../include/tiled_orb.h"
+
+/**
+ * @brief Function to get the orientation of a keypoint from the intensity centroid of its patch, the same way ORB does
+ *
+ * @param image pyramid level the keypoint was found in
+ * @param pt position of the keypoint in the level
+ * @param umax half width of each row of the circular patch
+ * @return float angle in degrees
+ */
+static float centroid_angle(const cv::Mat &image, cv::Point2f pt, const std::vector<int> &umax) {
+  int half = (int) umax.size() - 2;
+  const uchar *center = image.ptr<uchar>(cvRound(pt.y)) + cvRound(pt.x);
+  int step = (int) image.step;
+
+  int m_01 = 0, m_10 = 0;
+  for(int u = -half; u <= half; u++) {
+    m_10 += u * center[u];
+  }
+  for(int v = 1; v <= half; v++) {
+    int v_sum = 0;
+    int d = umax[v];
+    for(int u = -d; u <= d; u++) {
+      int val_plus = center[u + v * step];
+      int val_minus = center[u - v * step];
+      v_sum += val_plus - val_minus;
+      m_10 += u * (val_plus + val_minus);
+    }
+    m_01 += v * v_sum;
+  }
+  return cv::fastAtan2((float) m_01, (float) m_10);
+}
+
+/**
+ * @brief Function to set up a tiled extractor with the settings of an ORB detector
+ *
+ * @param tiled extractor to set up
+ * @param orb ORB detector whose settings are used
+ */
+void tiled_orb_init(tiled_orb &tiled, cv::Ptr<cv::ORB> orb) {
+  tiled.max_features = orb->getMaxFeatures();
+  tiled.nlevels = std::max(1, orb->getNLevels());
+  tiled.scale_factor = (float) orb->getScaleFactor();
+  tiled.patch_size = orb->getPatchSize();
+  tiled.edge_threshold = std::max(orb->getEdgeThreshold(), tiled.patch_size);
+  tiled.fast_threshold = orb->getFastThreshold();
+  tiled.min_fast_threshold = std::min(TILED_ORB_MIN_FAST_THRESHOLD, tiled.fast_threshold);
+  tiled.wta_k = orb->getWTA_K();
+  tiled.score_type = orb->getScoreType();
+  tiled.frame_size = cv::Size();
+  tiled.cells.clear();
+  tiled.bands.clear();
+  tiled.orbs.clear();
+  luma_pyramid_init(tiled.pyramid, tiled.nlevels, tiled.scale_factor);
+
+  // Rows of the circular patch, made symmetric the same way ORB does
+  int half = tiled.patch_size / 2;
+  tiled.umax.assign(half + 2, 0);
+  int vmax = cvFloor(half * std::sqrt(2.0) / 2 + 1);
+  int vmin = cvCeil(half * std::sqrt(2.0) / 2);
+  for(int v = 0; v <= vmax; v++) {
+    tiled.umax[v] = cvRound(std::sqrt((double) half * half - v * v));
+  }
+  for(int v = half, v0 = 0; v >= vmin; v--) {
+    while(tiled.umax[v0] == tiled.umax[v0 + 1]) v0++;
+    tiled.umax[v] = v0;
+    v0++;
+  }
+}
+
+/**
+ * @brief Function to lay out the pyramid, the grid cells and the description bands for a frame size
+ *
+ * @param tiled extractor
+ * @param frame_size size of the frames
+ */
+static void layout_grid(tiled_orb &tiled, cv::Size frame_size) {
+  tiled.frame_size = frame_size;
+  tiled.cells.clear();
+  tiled.bands.clear();
+
+  // Fewer keypoints on the smaller levels, the same split ORB uses
+  float factor = 1.0f / tiled.scale_factor;
+  float per_level = tiled.max_features * (1 - factor) / (1 - (float) std::pow((double) factor, (double) tiled.nlevels));
+  int assigned = 0;
+
+  float scale = 1;
+  for(int level = 0; level < tiled.nlevels; level++, scale *= tiled.scale_factor) {
+    int features = level + 1 < tiled.nlevels ? cvRound(per_level) : std::max(0, tiled.max_features - assigned);
+    assigned += features;
+    per_level *= factor;
+
+    // Keypoints stay far enough from the edge for their patch and for ORB's own border check
+    cv::Size size(cvRound(frame_size.width / scale), cvRound(frame_size.height / scale));
+    int x0 = tiled.edge_threshold, y0 = tiled.edge_threshold;
+    int area_w = size.width - 2 * tiled.edge_threshold;
+    int area_h = size.height - 2 * tiled.edge_threshold;
+    if(features <= 0 || area_w <= 0 || area_h <= 0) continue;
+
+    // Roughly square cells, enough of them that each one keeps a handful of keypoints
+    int num_cells = std::max(1, features / TILED_ORB_CELL_FEATURES);
+    double side = std::max((double) TILED_ORB_MIN_CELL, std::sqrt((double) area_w * area_h / num_cells));
+    int cols = std::max(1, (int) (area_w / side));
+    int rows = std::max(1, (int) (area_h / side));
+    int quota = (features + cols * rows - 1) / (cols * rows);
+
+    // Bands hold whole rows of cells
+    int cell_h = (area_h + rows - 1) / rows;
+    int rows_per_band = std::max(1, TILED_ORB_BAND_HEIGHT / cell_h);
+    int first_band = (int) tiled.bands.size();
+    for(int r = 0; r < rows; r += rows_per_band) {
+      tiled_orb_band band;
+      band.level = level;
+      int band_y0 = y0 + r * area_h / rows;
+      int band_y1 = y0 + std::min(rows, r + rows_per_band) * area_h / rows;
+      band.top = std::max(0, band_y0 - tiled.edge_threshold);
+      band.bottom = std::min(size.height, band_y1 + tiled.edge_threshold);
+      tiled.bands.push_back(band);
+    }
+
+    for(int r = 0; r < rows; r++) {
+      for(int c = 0; c < cols; c++) {
+        tiled_orb_cell cell;
+        cell.level = level;
+        int cx0 = x0 + c * area_w / cols, cx1 = x0 + (c + 1) * area_w / cols;
+        int cy0 = y0 + r * area_h / rows, cy1 = y0 + (r + 1) * area_h / rows;
+        cell.rect = cv::Rect(cx0, cy0, cx1 - cx0, cy1 - cy0);
+        cell.quota = quota;
+        cell.band = first_band + r / rows_per_band;
+        cell.keypoints.reserve(4 * quota);
+        tiled.cells.push_back(cell);
+      }
+    }
+  }
+
+  // Only ORB's descriptor settings matter, it's handed the keypoints
+  while(tiled.orbs.size() < tiled.bands.size()) {
+    tiled.orbs.push_back(cv::ORB::create(tiled.max_features, tiled.scale_factor, 1, tiled.edge_threshold, 0, tiled.wta_k,
+                                         tiled.score_type, tiled.patch_size, tiled.fast_threshold));
+  }
+}
+
+/**
+ * @brief Function to detect the corners of one cell and keep the best of them
+ *
+ * @param tiled extractor
+ * @param levels scale levels of the frame
+ * @param cell cell to detect in
+ */
+static void detect_cell(const tiled_orb &tiled, const std::vector<cv::Mat> &levels, tiled_orb_cell &cell) {
+  const cv::Mat &image = levels[cell.level];
+
+  // FAST ignores a border around the image it's given, so give it a little more than the cell
+  cv::Rect search(cell.rect.x - TILED_ORB_FAST_BORDER, cell.rect.y - TILED_ORB_FAST_BORDER,
+                  cell.rect.width + 2 * TILED_ORB_FAST_BORDER, cell.rect.height + 2 * TILED_ORB_FAST_BORDER);
+  search &= cv::Rect(0, 0, image.cols, image.rows);
+
+  // Lower the threshold in cells with little texture so they still get keypoints
+  std::vector<cv::KeyPoint> &keypoints = cell.keypoints;
+  int thresholds[] = { tiled.fast_threshold, tiled.min_fast_threshold };
+  for(int t = 0; t < 2; t++) {
+    keypoints.clear();
+    cv::FAST(image(search), keypoints, thresholds[t], true);
+
+    int kept = 0;
+    for(int i = 0; i < keypoints.size(); i++) {
+      cv::Point2f pt = keypoints[i].pt + cv::Point2f((float) search.x, (float) search.y);
+      if(!cell.rect.contains(cv::Point(cvRound(pt.x), cvRound(pt.y)))) continue;
+      keypoints[i].pt = pt;
+      keypoints[kept++] = keypoints[i];
+    }
+    keypoints.resize(kept);
+    if(kept * 2 >= cell.quota || thresholds[t] == tiled.min_fast_threshold) break;
+  }
+
+  // Keep the strongest corners, ties broken by position so the result doesn't depend on FAST's order
+  if(keypoints.size() > cell.quota) {
+    std::nth_element(keypoints.begin(), keypoints.begin() + cell.quota, keypoints.end(),
+                     [](const cv::KeyPoint &a, const cv::KeyPoint &b) {
+                       if(a.response != b.response) return a.response > b.response;
+                       if(a.pt.y != b.pt.y) return a.pt.y < b.pt.y;
+                       return a.pt.x < b.pt.x;
+                     });
+    keypoints.resize(cell.quota);
+  }
+
+  float size = (float) tiled.patch_size;
+  for(int i = 0; i < keypoints.size(); i++) {
+    keypoints[i].angle = centroid_angle(image, keypoints[i].pt, tiled.umax);
+    keypoints[i].octave = 0;
+    keypoints[i].size = size;
+  }
+}
+
+/**
+ * @brief Function to compute the descriptors of a band's keypoints and move them into image coordinates
+ *
+ * @param tiled extractor
+ * @param levels scale levels of the frame
+ * @param band band to describe
+ * @param orb ORB detector only this band uses
+ */
+static void describe_band(const tiled_orb &tiled, const std::vector<cv::Mat> &levels, tiled_orb_band &band, cv::Ptr<cv::ORB> orb) {
+  if(band.keypoints.empty()) {
+    band.descriptors.release();
+    return;
+  }
+
+  // ORB only sees the band, so its keypoints move up by the band's top row
+  const cv::Mat &image = levels[band.level];
+  cv::Mat rows = image.rowRange(band.top, band.bottom);
+  for(int i = 0; i < band.keypoints.size(); i++) {
+    band.keypoints[i].pt.y -= (float) band.top;
+  }
+  orb->compute(rows, band.keypoints, band.descriptors);
+
+  float scale = (float) std::pow((double) tiled.scale_factor, (double) band.level);
+  for(int i = 0; i < band.keypoints.size(); i++) {
+    cv::KeyPoint &kp = band.keypoints[i];
+    kp.pt.y += (float) band.top;
+    kp.pt *= scale;
+    kp.size = tiled.patch_size * scale;
+    kp.octave = band.level;
+  }
+}
+
+/**
+ * @brief Function to detect keypoints and compute their descriptors. Each pyramid level is split into
+ * grid cells that keep their best corners, with a lower FAST threshold where the texture is weak.
+ *
+ * @param tiled extractor
+ * @param gray grayscale image
+ * @param keypoints output keypoints in image coordinates
+ * @param descriptors output descriptors, one row per keypoint
+ */
+void tiled_orb_detect_and_compute(tiled_orb &tiled, const cv::Mat &gray, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors) {
+  luma_pyramid_set_gray(tiled.pyramid, gray);
+  tiled_orb_detect_and_compute(tiled, tiled.pyramid, keypoints, descriptors);
+}
+
+/**
+ * @brief Function to detect keypoints and compute their descriptors on the scale levels of a frame's
+ * shared pyramid, so they aren't built again. The pyramid takes the extractor's scales.
+ *
+ * @param tiled extractor
+ * @param pyr pyramid of the frame
+ * @param keypoints output keypoints in image coordinates
+ * @param descriptors output descriptors, one row per keypoint
+ */
+void tiled_orb_detect_and_compute(tiled_orb &tiled, luma_pyramid &pyr, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors) {
+  keypoints.clear();
+  if(tiled.umax.empty() || pyr.gray.empty()) {
+    descriptors.release();
+    return;
+  }
+  if(pyr.gray.size() != tiled.frame_size) layout_grid(tiled, pyr.gray.size());
+  if(pyr.nlevels != tiled.nlevels || pyr.scale_factor != tiled.scale_factor) {
+    luma_pyramid_init(pyr, tiled.nlevels, tiled.scale_factor);
+  }
+  const std::vector<cv::Mat> &levels = luma_pyramid_levels(pyr);
+
+  // Every cell of every level at once
+  cv::parallel_for_(cv::Range(0, (int) tiled.cells.size()), [&](const cv::Range &range) {
+    for(int c = range.start; c < range.end; c++) {
+      detect_cell(tiled, levels, tiled.cells[c]);
+    }
+  });
+
+  for(int b = 0; b < tiled.bands.size(); b++) {
+    tiled.bands[b].keypoints.clear();
+  }
+  for(int c = 0; c < tiled.cells.size(); c++) {
+    const tiled_orb_cell &cell = tiled.cells[c];
+    std::vector<cv::KeyPoint> &band_kps = tiled.bands[cell.band].keypoints;
+    band_kps.insert(band_kps.end(), cell.keypoints.begin(), cell.keypoints.end());
+  }
+
+  cv::parallel_for_(cv::Range(0, (int) tiled.bands.size()), [&](const cv::Range &range) {
+    for(int b = range.start; b < range.end; b++) {
+      describe_band(tiled, levels, tiled.bands[b], tiled.orbs[b]);
+    }
+  });
+
+  // Gather the bands in order so the output doesn't depend on the thread timing
+  int total = 0;
+  int desc_bytes = 0;
+  for(int b = 0; b < tiled.bands.size(); b++) {
+    total += (int) tiled.bands[b].keypoints.size();
+    if(!tiled.bands[b].descriptors.empty()) desc_bytes = tiled.bands[b].descriptors.cols;
+  }
+  if(total == 0) {
+    descriptors.release();
+    return;
+  }
+
+  keypoints.reserve(total);
+  descriptors.create(total, desc_bytes, CV_8U);
+  int row = 0;
+  for(int b = 0; b < tiled.bands.size(); b++) {
+    const tiled_orb_band &band = tiled.bands[b];
+    keypoints.insert(keypoints.end(), band.keypoints.begin(), band.keypoints.end());
+    for(int i = 0; i < band.keypoints.size(); i++) {
+      memcpy(descriptors.ptr<uchar>(row++), band.descriptors.ptr<uchar>(i), desc_bytes);
+    }
+  }
+}
@@ -0,0 +1,693 @@
+/**
+ * @file tracker.cpp
+ * @author Nate Novak (novak.n@northeastern.edu)
+ * @brief Follows a detected target between frames with pyramidal optical flow
+ * @date 2026-10-17
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "../include/tracker.h"
+#include "../include/metrics.h"
+
+/**
+ * @brief Function to measure how well a homography maps the model points onto the scene points
+ *
+ * @param homography homography from the model to the scene
+ * @param model_pts points in the model
+ * @param scene_pts matching points in the scene
+ * @param mask mask of the points to measure, every point if empty
+ * @param projected buffer for the projected points
+ * @return float mean reprojection error in pixels
+ */
+static float reprojection_error(const cv::Mat &homography, const std::vector<cv::Point2f> &model_pts,
+                                const std::vector<cv::Point2f> &scene_pts, const std::vector<uchar> &mask,
+                                std::vector<cv::Point2f> &projected) {
+  projected.resize(model_pts.size());
+  cv::perspectiveTransform(model_pts, projected, homography);
+
+  double total = 0;
+  int count = 0;
+  for(int i = 0; i < projected.size(); i++) {
+    if(!mask.empty() && !mask[i]) continue;
+    cv::Point2f d = projected[i] - scene_pts[i];
+    total += std::sqrt(d.x * d.x + d.y * d.y);
+    count++;
+  }
+  return count > 0 ? (float) (total / count) : 0.0f;
+}
+
+/**
+ * @brief Function to start tracking a target from the inliers of a detection
+ *
+ * @param tracker tracker to lock
+ * @param target index of the target in the model database
+ * @param pyr pyramid of the frame the detection ran on
+ * @param matches keypoint matches, queryIdx is the model and trainIdx the scene
+ * @param keypoints_model keypoints in the model
+ * @param keypoints_scene keypoints in the scene
+ * @param inliers mask of the matches that agree with the homography
+ * @param homography homography from the model to the scene
+ * @return bool true if there were enough inliers to lock on
+ */
+bool tracker_lock(planar_tracker &tracker, int target, luma_pyramid &pyr, const std::vector<cv::DMatch> &matches,
+                  const std::vector<cv::KeyPoint> &keypoints_model, const std::vector<cv::KeyPoint> &keypoints_scene,
+                  const std::vector<uchar> &inliers, const cv::Mat &homography) {
+  tracker_reset(tracker);
+  if(homography.empty()) return false;
+
+  for(int i = 0; i < matches.size(); i++) {
+    if(i < inliers.size() && !inliers[i]) continue;
+    tracker.model_pts.push_back(keypoints_model[matches[i].queryIdx].pt);
+    tracker.scene_pts.push_back(keypoints_scene[matches[i].trainIdx].pt);
+  }
+
+  if(tracker.model_pts.size() < tracker.min_points) {
+    tracker_reset(tracker);
+    return false;
+  }
+
+  tracker.target = target;
+  tracker.locked = true;
+  copy_flow_pyramid(luma_pyramid_flow(pyr, cv::Size(TRACK_WIN_SIZE, TRACK_WIN_SIZE), TRACK_PYR_LEVELS), tracker.prev_flow);
+  homography.copyTo(tracker.homography);
+  tracker.reproj_err = reprojection_error(homography, tracker.model_pts, tracker.scene_pts, std::vector<uchar>(), tracker.ws.projected);
+  return true;
+}
+
+/**
+ * @brief Function to drop the lock once the target is lost, along with the poses averaged while it was
+ * tracked, so they aren't mixed into the pose when it's found again
+ *
+ * @param tracker tracker that lost its target
+ */
+static void drop_lock(planar_tracker &tracker) {
+  tracker_reset(tracker);
+  pose_filter_reset(tracker.filter);
+}
+
+/**
+ * @brief Function to follow the tracked points into a new frame with pyramidal Lucas-Kanade
+ *
+ * @param tracker locked tracker
+ * @param pyr pyramid of the new frame
+ * @param homography output homography from the model to the new frame
+ * @return bool true if the target is still tracked, false if it needs to be detected again
+ */
+bool tracker_update(planar_tracker &tracker, luma_pyramid &pyr, cv::Mat &homography) {
+  if(!tracker.locked || tracker.prev_flow.empty() || tracker.prev_flow[0].size() != pyr.gray.size()) {
+    drop_lock(tracker);
+    return false;
+  }
+
+  // Both frames' levels are already built, the previous ones were kept from the last call
+  tracker_workspace &ws = tracker.ws;
+  scoped_timer flow_timer(STAGE_FLOW);
+  const std::vector<cv::Mat> &flow = luma_pyramid_flow(pyr, cv::Size(TRACK_WIN_SIZE, TRACK_WIN_SIZE), TRACK_PYR_LEVELS);
+  cv::calcOpticalFlowPyrLK(tracker.prev_flow, flow, tracker.scene_pts, ws.next_pts, ws.status, ws.err,
+                           cv::Size(TRACK_WIN_SIZE, TRACK_WIN_SIZE), TRACK_PYR_LEVELS,
+                           cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 20, 0.03));
+  flow_timer.stop();
+
+  // Keep the points optical flow could follow
+  int kept = 0;
+  for(int i = 0; i < ws.next_pts.size(); i++) {
+    if(!ws.status[i]) continue;
+    tracker.model_pts[kept] = tracker.model_pts[i];
+    tracker.scene_pts[kept] = ws.next_pts[i];
+    kept++;
+  }
+  tracker.model_pts.resize(kept);
+  tracker.scene_pts.resize(kept);
+
+  if(kept < tracker.min_points) {
+    drop_lock(tracker);
+    return false;
+  }
+
+  // The same sampler as detection, it doesn't allocate the way findHomography does
+  int iterations = 0;
+  if(!find_homography_prosac(tracker.model_pts, tracker.scene_pts, 3, ws.homography, ws.inliers, iterations, &ws.pose)) {
+    drop_lock(tracker);
+    return false;
+  }
+
+  float reproj_err = reprojection_error(ws.homography, tracker.model_pts, tracker.scene_pts, ws.inliers, ws.projected);
+
+  // Drop the points that drifted off the plane
+  kept = 0;
+  for(int i = 0; i < ws.inliers.size(); i++) {
+    if(!ws.inliers[i]) continue;
+    tracker.model_pts[kept] = tracker.model_pts[i];
+    tracker.scene_pts[kept] = tracker.scene_pts[i];
+    kept++;
+  }
+  tracker.model_pts.resize(kept);
+  tracker.scene_pts.resize(kept);
+
+  if(kept < tracker.min_points || reproj_err > tracker.max_reproj_err) {
+    drop_lock(tracker);
+    return false;
+  }
+
+  copy_flow_pyramid(flow, tracker.prev_flow);
+  ws.homography.copyTo(tracker.homography);
+  ws.homography.copyTo(homography);
+  tracker.reproj_err = reproj_err;
+  return true;
+}
+
+/**
+ * @brief Function to drop the tracked target
+ *
+ * @param tracker tracker to reset
+ */
+void tracker_reset(planar_tracker &tracker) {
+  tracker.locked = false;
+  tracker.target = -1;
+  tracker.model_pts.clear();
+  tracker.scene_pts.clear();
+  tracker.reproj_err = 0;
+}
+
+/**
+ * @brief Function to drop everything the tracker remembers in frame coordinates, for when the
+ * processing resolution changes
+ *
+ * @param tracker tracker to clear
+ */
+void tracker_clear_history(planar_tracker &tracker) {
+  tracker_reset(tracker);
+  tracker.prev_flow.clear();
+  tracker.roi_corners.clear();
+  tracker.predicted_target = -1;
+  pose_filter_reset(tracker.filter);
+}
+
+/**
+ * @brief Function to detect the keypoints and descriptors of a frame
+ *
+ * @param orb ORB detector
+ * @param gray grayscale frame
+ * @param result result whose scene features are filled in
+ * @param tiled tiled extractor to use instead of the ORB detector, nullptr to use ORB
+ */
+void extract_features(cv::Ptr<cv::ORB> orb, const cv::Mat &gray, frame_result &result, tiled_orb *tiled) {
+  scoped_timer timer(STAGE_DETECT);
+  result.keypoints_scene.clear();
+  if(tiled != nullptr) {
+    tiled_orb_detect_and_compute(*tiled, gray, result.keypoints_scene, result.descriptors_scene);
+  } else {
+    orb->detectAndCompute(gray, cv::noArray(), result.keypoints_scene, result.descriptors_scene);
+  }
+  result.roi = cv::Rect(0, 0, gray.cols, gray.rows);
+  result.have_features = true;
+  result.have_grid = false;
+  metrics_count(COUNT_KEYPOINTS, (int64_t) result.keypoints_scene.size());
+}
+
+/**
+ * @brief Function to detect the keypoints and descriptors of a frame from its shared pyramid. The tiled
+ * extractor reads the pyramid's scale levels, ORB builds its own from the full size level.
+ *
+ * @param orb ORB detector
+ * @param pyr pyramid of the frame
+ * @param result result whose scene features are filled in
+ * @param tiled tiled extractor to use instead of the ORB detector, nullptr to use ORB
+ */
+void extract_features(cv::Ptr<cv::ORB> orb, luma_pyramid &pyr, frame_result &result, tiled_orb *tiled) {
+  if(tiled == nullptr) {
+    extract_features(orb, pyr.gray, result);
+    return;
+  }
+  scoped_timer timer(STAGE_DETECT);
+  result.keypoints_scene.clear();
+  tiled_orb_detect_and_compute(*tiled, pyr, result.keypoints_scene, result.descriptors_scene);
+  result.roi = cv::Rect(0, 0, pyr.gray.cols, pyr.gray.rows);
+  result.have_features = true;
+  result.have_grid = false;
+  metrics_count(COUNT_KEYPOINTS, (int64_t) result.keypoints_scene.size());
+}
+
+/**
+ * @brief Function to detect the keypoints and descriptors in one region of a frame. ORB only runs
+ * on the region, and the keypoints are moved back into frame coordinates.
+ *
+ * @param orb ORB detector
+ * @param gray grayscale frame
+ * @param roi region of the frame to detect in
+ * @param result result whose scene features are filled in
+ * @param tiled tiled extractor to use instead of the ORB detector, nullptr to use ORB
+ */
+void extract_features(cv::Ptr<cv::ORB> orb, const cv::Mat &gray, const cv::Rect &roi, frame_result &result,
+                      tiled_orb *tiled) {
+  scoped_timer timer(STAGE_DETECT);
+  result.keypoints_scene.clear();
+  if(tiled != nullptr) {
+    tiled_orb_detect_and_compute(*tiled, gray(roi), result.keypoints_scene, result.descriptors_scene);
+  } else {
+    orb->detectAndCompute(gray(roi), cv::noArray(), result.keypoints_scene, result.descriptors_scene);
+  }
+  cv::Point2f offset((float) roi.x, (float) roi.y);
+  for(int i = 0; i < result.keypoints_scene.size(); i++) {
+    result.keypoints_scene[i].pt += offset;
+  }
+  result.roi = roi;
+  result.have_features = true;
+  result.have_grid = false;
+  metrics_count(COUNT_KEYPOINTS, (int64_t) result.keypoints_scene.size());
+}
+
+/**
+ * @brief Function to get the region to detect a target in from where it was in the last frame
+ *
+ * @param corners corners of the target in the last frame
+ * @param frame_size size of the frame
+ * @param roi output region, the target's bounding box grown by ROI_MARGIN and clipped to the frame
+ * @return bool false if the region isn't worth using, because the corners are missing or it covers most of the frame
+ */
+bool predict_roi(const std::vector<cv::Point2f> &corners, cv::Size frame_size, cv::Rect &roi) {
+  if(corners.size() != 4) return false;
+  for(int i = 0; i < corners.size(); i++) {
+    if(!std::isfinite(corners[i].x) || !std::isfinite(corners[i].y)) return false;
+  }
+
+  float min_x = corners[0].x, max_x = corners[0].x;
+  float min_y = corners[0].y, max_y = corners[0].y;
+  for(int i = 1; i < corners.size(); i++) {
+    min_x = std::min(min_x, corners[i].x);
+    max_x = std::max(max_x, corners[i].x);
+    min_y = std::min(min_y, corners[i].y);
+    max_y = std::max(max_y, corners[i].y);
+  }
+
+  // Grow the box by a fraction of its size for motion, plus a border since ORB skips the edges of the image
+  float margin = ROI_MARGIN * std::max(max_x - min_x, max_y - min_y) + ROI_BORDER;
+  float w = (float) frame_size.width, h = (float) frame_size.height;
+  int x0 = (int) std::min(w, std::max(0.0f, std::floor(min_x - margin)));
+  int y0 = (int) std::min(h, std::max(0.0f, std::floor(min_y - margin)));
+  int x1 = (int) std::min(w, std::max(0.0f, std::ceil(max_x + margin)));
+  int y1 = (int) std::min(h, std::max(0.0f, std::ceil(max_y + margin)));
+  if(x1 <= x0 || y1 <= y0) return false;
+  roi = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+
+  if(roi.width <= 2 * ROI_BORDER || roi.height <= 2 * ROI_BORDER) return false;
+  return roi.area() <= ROI_MAX_AREA * frame_size.area();
+}
+
+/**
+ * @brief Function to get the pose of a target from its matches, locking the tracker onto it in tracking mode
+ *
+ * @param tracker tracker of the target, also owns the pose filter
+ * @param db database of targets
+ * @param target index of the target in the model database
+ * @param pyr pyramid of the frame
+ * @param keypoints_scene keypoints in the scene
+ * @param matches keypoint matches, queryIdx is the model and trainIdx the scene
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param tracking whether to track between detections
+ * @param homography output homography from the model to the scene
+ * @param rotations output rotations
+ * @param translations output translations
+ * @param scene_corners output corners of the target in the scene
+ * @param num_inliers output number of matches that agree with the homography
+ * @return bool true if a pose was found
+ */
+static bool pose_from_matches(planar_tracker &tracker, const model_db &db, int target, luma_pyramid &pyr,
+                              const std::vector<cv::KeyPoint> &keypoints_scene, const std::vector<cv::DMatch> &matches,
+                              cv::Mat cam_mat, cv::Mat dist_coeffs, bool tracking, cv::Mat &homography, cv::Mat &rotations,
+                              cv::Mat &translations, std::vector<cv::Point2f> &scene_corners, int &num_inliers) {
+  // Don't average the pose of one target into another
+  if(target != tracker.filter_target) {
+    pose_filter_reset(tracker.filter);
+    tracker.filter_target = target;
+  }
+
+  const model_target &model = db.targets[target];
+  std::vector<uchar> &inliers = tracker.ws.inliers;
+  get_rots_and_trans(matches, model.keypoints, keypoints_scene, model.size, rotations, translations,
+                     cam_mat, dist_coeffs, scene_corners, homography, inliers, &tracker.filter, &tracker.ws.pose);
+  bool have_pose = scene_corners.size() == 4;
+  num_inliers = 0;
+  for(int i = 0; i < inliers.size(); i++) {
+    if(inliers[i]) num_inliers++;
+  }
+
+  if(have_pose && tracking) {
+    tracker_lock(tracker, target, pyr, matches, model.keypoints, keypoints_scene, inliers, homography);
+  }
+  return have_pose;
+}
+
+/**
+ * @brief Function to follow a locked target into a new frame and get its smoothed pose
+ *
+ * @param tracker locked tracker of the target
+ * @param db database of targets
+ * @param pyr pyramid of the new frame
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param homography output homography from the model to the new frame
+ * @param rotations output rotations
+ * @param translations output translations
+ * @param scene_corners output corners of the target in the new frame
+ * @param num_inliers output number of points still tracked
+ * @return bool true if the target is still tracked
+ */
+static bool follow_target(planar_tracker &tracker, const model_db &db, luma_pyramid &pyr, cv::Mat cam_mat, cv::Mat dist_coeffs,
+                          cv::Mat &homography, cv::Mat &rotations, cv::Mat &translations,
+                          std::vector<cv::Point2f> &scene_corners, int &num_inliers) {
+  int target = tracker.target;
+  if(!tracker_update(tracker, pyr, homography)) return false;
+
+  cv::Mat &smoothed = tracker.ws.smoothed;
+  pose_filter_update(tracker.filter, homography, smoothed);
+  pose_from_homography(smoothed, db.targets[target].size, rotations, translations, cam_mat, dist_coeffs, scene_corners);
+  num_inliers = (int) tracker.scene_pts.size();
+  return true;
+}
+
+/**
+ * @brief Function to get the grid over the frame's scene keypoints, building it the first time it's needed
+ *
+ * @param result result with the scene features filled in
+ * @return const keypoint_grid& grid over keypoints_scene
+ */
+static const keypoint_grid &scene_grid(frame_result &result) {
+  if(!result.have_grid) {
+    build_keypoint_grid(result.keypoints_scene, GUIDED_RADIUS, result.grid);
+    result.have_grid = true;
+  }
+  return result.grid;
+}
+
+/**
+ * @brief Function to remember where a target was so the next frame's matching can be guided by it
+ *
+ * @param tracker tracker of the target
+ * @param target index of the target in the model database
+ * @param have_pose whether the target was found
+ * @param homography homography from the model to the frame, if it was found
+ */
+static void set_prediction(planar_tracker &tracker, int target, bool have_pose, const cv::Mat &homography) {
+  if(!have_pose || homography.empty()) {
+    tracker.predicted_target = -1;
+    return;
+  }
+  homography.copyTo(tracker.predicted);
+  tracker.predicted_target = target;
+}
+
+/**
+ * @brief Function to match the frame's features against the database and get the pose of the best target
+ *
+ * @param tracker tracker of the target, also owns the pose filter
+ * @param db database of targets
+ * @param pyr pyramid of the frame
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param tracking whether to track between detections
+ * @param result result with the scene features filled in, the pose is written to it
+ * @return bool true if a pose was found
+ */
+static bool detect_target(planar_tracker &tracker, const model_db &db, luma_pyramid &pyr,
+                          cv::Mat cam_mat, cv::Mat dist_coeffs, bool tracking, frame_result &result) {
+  result.matches.clear();
+  result.sufficient_matches = false;
+  result.num_inliers = 0;
+  result.scene_corners.clear();
+
+  // Try the target from the last frame first, only comparing against the scene keypoints near where it should be
+  tracker_workspace &ws = tracker.ws;
+  if(tracker.guided && tracker.predicted_target >= 0 && tracker.predicted_target < db.targets.size()) {
+    result.target = tracker.predicted_target;
+    const model_target &model = db.targets[result.target];
+    match_kps_guided(model.keypoints, model.descriptors, tracker.predicted, result.descriptors_scene, scene_grid(result),
+                     GUIDED_RADIUS, result.matches, result.sufficient_matches, &ws.projected);
+    if(result.sufficient_matches) {
+      result.have_pose = pose_from_matches(tracker, db, result.target, pyr, result.keypoints_scene, result.matches, cam_mat,
+                                           dist_coeffs, tracking, result.homography, result.rotations, result.translations,
+                                           result.scene_corners, result.num_inliers);
+      if(result.have_pose) return true;
+    }
+
+    // It moved too far or isn't there, fall back to matching every keypoint
+    result.matches.clear();
+    result.sufficient_matches = false;
+    result.num_inliers = 0;
+    result.scene_corners.clear();
+  }
+
+  // Find the targets that are likely in view
+  std::vector<std::pair<int, float> > &candidates = ws.candidates;
+  query_model_db(db, result.descriptors_scene, 3, candidates, &ws.query);
+
+  // Match the keypoints against the candidates, best score first
+  if(!candidates.empty()) result.target = candidates[0].first;
+  for(int c = 0; c < candidates.size() && !result.sufficient_matches; c++) {
+    result.matches.clear();
+    result.target = candidates[c].first;
+    match_kps(db.targets[result.target].index, result.descriptors_scene, result.matches, result.sufficient_matches, &ws.visited);
+  }
+  if(!result.sufficient_matches) return false;
+
+  result.have_pose = pose_from_matches(tracker, db, result.target, pyr, result.keypoints_scene, result.matches, cam_mat, dist_coeffs,
+                                       tracking, result.homography, result.rotations, result.translations, result.scene_corners,
+                                       result.num_inliers);
+  return result.have_pose;
+}
+
+/**
+ * @brief Function to find a target and its pose in a frame. A locked tracker is followed with
+ * optical flow, otherwise the frame's features are matched against the database. With use_roi set,
+ * features are only detected around where the target was in the last frame until it's lost.
+ *
+ * @param tracker tracker of the target, also owns the pose filter
+ * @param db database of targets
+ * @param orb ORB detector, used if result doesn't have features yet and detection is needed
+ * @param gray grayscale frame
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param tracking whether to track between detections
+ * @param result output result of the frame
+ * @return bool true if a pose was found
+ */
+bool locate_target(planar_tracker &tracker, const model_db &db, cv::Ptr<cv::ORB> orb, const cv::Mat &gray,
+                   cv::Mat cam_mat, cv::Mat dist_coeffs, bool tracking, frame_result &result) {
+  luma_pyramid &pyr = tracker.ws.pyramid;
+  luma_pyramid_set_gray(pyr, gray);
+  return locate_target(tracker, db, orb, pyr, cam_mat, dist_coeffs, tracking, result);
+}
+
+/**
+ * @brief Function to find a target and its pose in a frame from the frame's shared pyramid, so
+ * detection and optical flow don't build their own
+ *
+ * @param tracker tracker of the target, also owns the pose filter
+ * @param db database of targets
+ * @param orb ORB detector, used if result doesn't have features yet and detection is needed
+ * @param pyr pyramid of the frame
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param tracking whether to track between detections
+ * @param result output result of the frame
+ * @return bool true if a pose was found
+ */
+bool locate_target(planar_tracker &tracker, const model_db &db, cv::Ptr<cv::ORB> orb, luma_pyramid &pyr,
+                   cv::Mat cam_mat, cv::Mat dist_coeffs, bool tracking, frame_result &result) {
+  const cv::Mat &gray = pyr.gray;
+  result.matches.clear();
+  result.sufficient_matches = false;
+  result.have_pose = false;
+  result.tracked = false;
+  result.num_inliers = 0;
+  result.scene_corners.clear();
+
+  // Follow the locked target with optical flow and only detect again once it's lost
+  if(tracking && tracker.locked) {
+    result.target = tracker.target;
+    if(follow_target(tracker, db, pyr, cam_mat, dist_coeffs, result.homography, result.rotations, result.translations,
+                     result.scene_corners, result.num_inliers)) {
+      result.have_pose = true;
+      result.tracked = true;
+      tracker.roi_corners = result.scene_corners;
+      set_prediction(tracker, result.target, true, result.homography);
+      return true;
+    }
+  }
+
+  // Look around where the target was first, then search the whole frame if it isn't there
+  cv::Rect roi;
+  if(!result.have_features && tracker.use_roi && predict_roi(tracker.roi_corners, gray.size(), roi)) {
+    extract_features(orb, gray, roi, result, tracker.tiled);
+    if(detect_target(tracker, db, pyr, cam_mat, dist_coeffs, tracking, result)) {
+      tracker.roi_corners = result.scene_corners;
+      set_prediction(tracker, result.target, true, result.homography);
+      return true;
+    }
+    result.have_features = false;
+  }
+  tracker.roi_corners.clear();
+
+  if(!result.have_features) {
+    extract_features(orb, pyr, result, tracker.tiled);
+  }
+  if(detect_target(tracker, db, pyr, cam_mat, dist_coeffs, tracking, result)) {
+    tracker.roi_corners = result.scene_corners;
+  } else {
+    pose_filter_reset(tracker.filter); // lost, don't average old poses into the next detection
+  }
+  set_prediction(tracker, result.target, result.have_pose, result.homography);
+  return result.have_pose;
+}
+
+/**
+ * @brief Function to set up a tracker for every target in the database
+ *
+ * @param tracker trackers to set up
+ * @param db database of targets
+ * @param smoothing frames the pose of each target is averaged over
+ * @param max_targets most targets to find in one frame
+ */
+void multi_tracker_init(multi_tracker &tracker, const model_db &db, int smoothing, int max_targets) {
+  tracker.trackers.clear();
+  tracker.trackers.resize(db.targets.size());
+  for(int t = 0; t < tracker.trackers.size(); t++) {
+    pose_filter_init(tracker.trackers[t].filter, smoothing);
+    tracker.trackers[t].filter_target = t;
+  }
+  tracker.max_targets = std::max(1, max_targets);
+  tracker.candidates.reserve(tracker.max_targets + MULTI_EXTRA_CANDIDATES);
+  tracker.jobs.reserve(db.targets.size());
+}
+
+/**
+ * @brief Function to find several targets and their poses in a frame. Locked targets are followed with
+ * optical flow, then if fewer than max_targets were found the frame's features are extracted once and
+ * matched against the best candidates from the database. The pose of each target is estimated in parallel.
+ *
+ * @param tracker trackers of the targets
+ * @param db database of targets
+ * @param orb ORB detector, used if features doesn't have them yet and detection is needed
+ * @param pyr pyramid of the frame
+ * @param cam_mat camera matrix
+ * @param dist_coeffs distortion coefficients
+ * @param tracking whether to track between detections
+ * @param features scene features of the frame, extracted if they're needed and missing
+ * @param results output poses, one per target in the order of the database
+ * @return int number of targets with a pose
+ */
+int locate_targets(multi_tracker &tracker, const model_db &db, cv::Ptr<cv::ORB> orb, luma_pyramid &pyr,
+                   cv::Mat cam_mat, cv::Mat dist_coeffs, bool tracking, frame_result &features,
+                   std::vector<target_result> &results) {
+  results.resize(db.targets.size());
+  for(int t = 0; t < results.size(); t++) {
+    results[t].have_pose = false;
+    results[t].tracked = false;
+    results[t].num_inliers = 0;
+    results[t].matches.clear();
+    results[t].scene_corners.clear();
+  }
+  if(tracker.trackers.size() != db.targets.size()) return 0;
+
+  // The trackers all read the same optical flow levels, so build them before the threads start
+  if(tracking) luma_pyramid_flow(pyr, cv::Size(TRACK_WIN_SIZE, TRACK_WIN_SIZE), TRACK_PYR_LEVELS);
+
+  // Follow every locked target with optical flow, each one only touches its own tracker
+  std::vector<int> &jobs = tracker.jobs;
+  jobs.clear();
+  if(tracking) {
+    for(int t = 0; t < tracker.trackers.size(); t++) {
+      if(tracker.trackers[t].locked) jobs.push_back(t);
+    }
+  }
+  cv::parallel_for_(cv::Range(0, (int) jobs.size()), [&](const cv::Range &range) {
+    for(int j = range.start; j < range.end; j++) {
+      int t = jobs[j];
+      target_result &res = results[t];
+      res.have_pose = follow_target(tracker.trackers[t], db, pyr, cam_mat, dist_coeffs, res.homography, res.rotations,
+                                    res.translations, res.scene_corners, res.num_inliers);
+      res.tracked = res.have_pose;
+    }
+  });
+
+  int found = 0;
+  for(int t = 0; t < results.size(); t++) {
+    if(results[t].have_pose) found++;
+  }
+  if(found >= tracker.max_targets) return found;
+
+  // Extract the frame's features once and only match the likeliest targets that aren't tracked yet
+  if(!features.have_features) {
+    extract_features(orb, pyr, features, tracker.tiled);
+  }
+  int wanted = tracker.max_targets - found + MULTI_EXTRA_CANDIDATES;
+  query_model_db(db, features.descriptors_scene, wanted + found, tracker.candidates, &tracker.query);
+  jobs.clear();
+  for(int c = 0; c < tracker.candidates.size() && jobs.size() < wanted; c++) {
+    int t = tracker.candidates[c].first;
+    if(!results[t].have_pose) jobs.push_back(t);
+  }
+
+  // Targets that were found in the last frame are matched even if the database doesn't rank them, guided by where they were
+  bool any_guided = false;
+  if(tracker.guided) {
+    for(int t = 0; t < tracker.trackers.size(); t++) {
+      if(tracker.trackers[t].predicted_target != t || results[t].have_pose) continue;
+      if(std::find(jobs.begin(), jobs.end(), t) == jobs.end()) jobs.push_back(t);
+      any_guided = true;
+    }
+  }
+  if(any_guided) scene_grid(features); // every job reads the same grid, so build it before the threads start
+
+  // Match and solve every candidate in parallel, each one with its own tracker's buffers
+  cv::parallel_for_(cv::Range(0, (int) jobs.size()), [&](const cv::Range &range) {
+    for(int j = range.start; j < range.end; j++) {
+      int t = jobs[j];
+      planar_tracker &target_tracker = tracker.trackers[t];
+      target_result &res = results[t];
+      bool sufficient_matches = false;
+      if(any_guided && target_tracker.predicted_target == t) {
+        const model_target &model = db.targets[t];
+        match_kps_guided(model.keypoints, model.descriptors, target_tracker.predicted, features.descriptors_scene, features.grid,
+                         GUIDED_RADIUS, res.matches, sufficient_matches, &target_tracker.ws.projected);
+        if(!sufficient_matches) res.matches.clear();
+      }
+      if(!sufficient_matches) {
+        match_kps(db.targets[t].index, features.descriptors_scene, res.matches, sufficient_matches, &target_tracker.ws.visited);
+      }
+      if(!sufficient_matches) continue;
+      res.have_pose = pose_from_matches(target_tracker, db, t, pyr, features.keypoints_scene, res.matches, cam_mat, dist_coeffs,
+                                        tracking, res.homography, res.rotations, res.translations, res.scene_corners,
+                                        res.num_inliers);
+    }
+  });
+
+  // Targets that weren't found start their smoothing over when they come back
+  found = 0;
+  for(int t = 0; t < results.size(); t++) {
+    if(results[t].have_pose) found++;
+    else pose_filter_reset(tracker.trackers[t].filter);
+  }
+
+  // More candidates than needed were matched, keep the ones with the most inliers
+  while(found > tracker.max_targets) {
+    int worst = -1;
+    for(int j = 0; j < jobs.size(); j++) {
+      int t = jobs[j];
+      if(!results[t].have_pose) continue;
+      if(worst < 0 || results[t].num_inliers < results[worst].num_inliers) worst = t;
+    }
+    if(worst < 0) break;
+    results[worst].have_pose = false;
+    tracker_reset(tracker.trackers[worst]);
+    pose_filter_reset(tracker.trackers[worst].filter);
+    found--;
+  }
+
+  for(int t = 0; t < results.size(); t++) {
+    set_prediction(tracker.trackers[t], t, results[t].have_pose, results[t].homography);
+  }
+  return found;
+}